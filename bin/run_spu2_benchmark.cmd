@@ -0,0 +1 @@
+%systemroot%\syswow64\rundll32 plugins\SPU2-X-dev.dll,_s2r_benchmark_cmd@16 replay_dump.s2r
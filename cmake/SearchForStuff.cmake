@@ -103,6 +103,8 @@ if(OPENCL_API)
 endif()
 check_lib(PORTAUDIO portaudio portaudio.h pa_linux_alsa.h)
 check_lib(SOUNDTOUCH SoundTouch soundtouch/SoundTouch.h)
+# Optional, for zstd compressed ISOs
+check_lib(ZSTD zstd zstd.h)
 
 if(SDL2_API)
     check_lib(SDL2 SDL2 SDL.h PATH_SUFFIXES SDL2)
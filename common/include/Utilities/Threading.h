@@ -18,6 +18,8 @@
 #include <semaphore.h>
 #include <errno.h> // EBUSY
 #include <pthread.h>
+#include <algorithm>
+#include <atomic>
 
 #ifdef __APPLE__
 #include <mach/semaphore.h>
@@ -255,10 +257,108 @@ public:
     void WaitNoCancel(const wxTimeSpan &timeout);
     int Count();
 
+    // Consumes a post if one is pending, never blocks.
+    bool TryWait();
+
     void Wait();
     bool Wait(const wxTimeSpan &timeout);
 };
 
+// --------------------------------------------------------------------------------------
+//  SpinWaitPolicy
+// --------------------------------------------------------------------------------------
+// Wait strategy for handoffs between threads where the other side usually answers within
+// a few microseconds: spin on the condition (with pause) for a while, then yield a few
+// timeslices, and only then let the caller sleep in the kernel.
+//
+// The spin is adaptive: its length is halved each time it doesn't catch the condition
+// (the host is likely oversubscribed, the spin only wastes cycles) and doubled each time
+// it does, up to the configured maximum.
+//
+struct SpinWaitStats
+{
+    u64 waits;       // total waits
+    u64 spins;       // waits satisfied while spinning
+    u64 yields;      // waits satisfied while yielding
+    u64 sleeps;      // waits which went to sleep in the kernel
+    u64 wakes;       // waits whose wake latency was measured
+    u64 latency;     // sum of the post to wake latencies, in GetCPUTicks() units
+    u64 latency_max; // worst post to wake latency
+
+    SpinWaitStats() { Reset(); }
+    void Reset() { waits = spins = yields = sleeps = wakes = latency = latency_max = 0; }
+    void AddLatency(u64 ticks);
+    void Print(const wxChar *name) const;
+};
+
+class SpinWaitPolicy
+{
+protected:
+    int m_spin_max;  // pause iterations before yielding
+    int m_yield_max; // timeslices yielded before sleeping
+    int m_spin;      // current (adaptive) spin length
+    std::atomic<u64> m_post_time; // GetCPUTicks() of the oldest unconsumed post (0 = none)
+
+public:
+    SpinWaitStats stats; // only updated by the waiting thread
+
+    SpinWaitPolicy() : m_post_time(0) { SetLimits(1000, 4); }
+    void SetLimits(int spin, int yield);
+
+    // Spins then yields until done() returns true. Returns false if done() is still
+    // false afterwards, in which case the caller should block.
+    template <typename Fn>
+    bool Wait(Fn done)
+    {
+        stats.waits++;
+        for (int i = 0; i < m_spin; i++) {
+            if (done()) {
+                stats.spins++;
+                m_spin = std::min(m_spin * 2, m_spin_max);
+                return true;
+            }
+            SpinWait();
+        }
+
+        m_spin = std::max(m_spin / 2, std::min(m_spin_max, 16));
+        for (int i = 0; i < m_yield_max; i++) {
+            Timeslice();
+            if (done()) {
+                stats.yields++;
+                return true;
+            }
+        }
+
+        stats.sleeps++;
+        return false;
+    }
+
+    // Semaphore handoff: the posting thread calls Posted() right before posting (for the
+    // wake latency stats), the waiting thread calls WaitOn() instead of WaitWithoutYield().
+    void Posted();
+    void WaitOn(Semaphore &sema);
+};
+
+// --------------------------------------------------------------------------------------
+//  SpinSemaphore
+// --------------------------------------------------------------------------------------
+// Semaphore whose WaitWithoutYield goes through a SpinWaitPolicy. Only one thread may
+// wait on it.
+//
+class SpinSemaphore : public Semaphore
+{
+public:
+    SpinWaitPolicy policy;
+
+    void Post()
+    {
+        policy.Posted();
+        Semaphore::Post();
+    }
+
+    void WaitWithoutYield() { policy.WaitOn(*this); }
+};
+
 class Mutex
 {
 protected:
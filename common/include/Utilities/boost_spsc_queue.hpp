@@ -58,6 +58,8 @@ class ringbuffer_base
 
     size_t pending_pop_read_index;
 
+    size_t capacity_; /* max_size unless resized */
+
     T *buffer;
 
     ringbuffer_base(ringbuffer_base const &) = delete;
@@ -66,7 +68,7 @@ class ringbuffer_base
 
 public:
     ringbuffer_base(void):
-        write_index_(0), read_index_(0), pending_pop_read_index(0)
+        write_index_(0), read_index_(0), pending_pop_read_index(0), capacity_(max_size)
     {
         // Use dynamically allocation here with no T object dependency
         // Otherwise the ringbuffer_base destructor will call the destructor
@@ -85,16 +87,12 @@ public:
     }
 
 
-    static size_t next_index(size_t arg)
+    size_t next_index(size_t arg) const
     {
         size_t ret = arg + 1;
-#if 0
-        // Initial boost code
-        while (unlikely(ret >= max_size))
-            ret -= max_size;
-#else
-        ret %= max_size;
-#endif
+        // Initial boost code, a compare is cheaper than a % by a runtime capacity
+        if (ret >= capacity_)
+            ret -= capacity_;
         return ret;
     }
 
@@ -170,6 +168,29 @@ public:
         read_index_.store(0, std::memory_order_release);
     }
 
+    /** Reallocate the ringbuffer for n elements, at most max_size
+     *
+     * \note Not thread-safe, the queued elements are dropped
+     * */
+    void resize(size_t n)
+    {
+        if (n < 2)
+            n = 2;
+        if (n > max_size)
+            n = max_size;
+
+        if (n != capacity_) {
+            T out;
+            while (pop(out)) {};
+
+            _aligned_free(buffer);
+            capacity_ = n;
+            buffer = (T*)_aligned_malloc(sizeof(T)*capacity_, 32);
+        }
+
+        reset();
+    }
+
     /** Check if the ringbuffer is empty
      *
      * \return true, if the ringbuffer is empty, false otherwise
@@ -194,7 +215,7 @@ public:
         const size_t write_index =  write_index_.load(std::memory_order_relaxed);
         const size_t read_index = read_index_.load(std::memory_order_relaxed);
         if (read_index > write_index) {
-            return (write_index + max_size) - read_index;
+            return (write_index + capacity_) - read_index;
         } else {
             return write_index - read_index;
         }
@@ -148,6 +148,16 @@ bool Threading::Semaphore::WaitWithoutYield(const wxTimeSpan &timeout)
     return true;
 }
 
+bool Threading::Semaphore::TryWait()
+{
+    mach_timespec_t ts = {0, 0};
+    if (semaphore_timedwait(m_sema, ts) != KERN_SUCCESS)
+        return false;
+
+    __atomic_sub_fetch(&m_counter, 1, __ATOMIC_SEQ_CST);
+    return true;
+}
+
 // This is a wxApp-safe implementation of Wait, which makes sure and executes the App's
 // pending messages *if* the Wait is performed on the Main/GUI thread. This ensures that
 // user input continues to be handled and that windows continue to repaint. If the Wait is
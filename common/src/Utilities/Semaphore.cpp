@@ -73,6 +73,11 @@ bool Threading::Semaphore::WaitWithoutYield(const wxTimeSpan &timeout)
 }
 
 
+bool Threading::Semaphore::TryWait()
+{
+    return sem_trywait(&m_sema) == 0;
+}
+
 // This is a wxApp-safe implementation of Wait, which makes sure and executes the App's
 // pending messages *if* the Wait is performed on the Main/GUI thread.  This ensures that
 // user input continues to be handled and that windoes continue to repaint.  If the Wait is
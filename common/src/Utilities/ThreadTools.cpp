@@ -161,6 +161,53 @@ __fi void Threading::Timeslice()
     sched_yield();
 }
 
+// --------------------------------------------------------------------------------------
+//  SpinWaitPolicy / SpinSemaphore Implementations
+// --------------------------------------------------------------------------------------
+
+void Threading::SpinWaitStats::AddLatency(u64 ticks)
+{
+    wakes++;
+    latency += ticks;
+    latency_max = std::max(latency_max, ticks);
+}
+
+void Threading::SpinWaitStats::Print(const wxChar *name) const
+{
+    if (!waits)
+        return;
+
+    const double us = 1000000.0 / GetTickFrequency();
+    Console.WriteLn(L"(%s) %llu waits: %.1f%% spin, %.1f%% yield, %.1f%% sleep; wake latency avg %.1fus, max %.1fus",
+                    name, waits, 100.0 * spins / waits, 100.0 * yields / waits, 100.0 * sleeps / waits,
+                    wakes ? us * latency / wakes : 0.0, us * latency_max);
+}
+
+void Threading::SpinWaitPolicy::SetLimits(int spin, int yield)
+{
+    m_spin_max = std::max(spin, 0);
+    m_yield_max = std::max(yield, 0);
+    m_spin = m_spin_max;
+}
+
+void Threading::SpinWaitPolicy::Posted()
+{
+    if (!m_post_time.load(std::memory_order_relaxed)) {
+        u64 none = 0;
+        m_post_time.compare_exchange_strong(none, GetCPUTicks());
+    }
+}
+
+void Threading::SpinWaitPolicy::WaitOn(Semaphore &sema)
+{
+    if (!Wait([&sema] { return sema.TryWait(); }))
+        sema.WaitWithoutYield();
+
+    const u64 posted = m_post_time.exchange(0);
+    if (posted)
+        stats.AddLatency(GetCPUTicks() - posted);
+}
+
 void Threading::pxThread::_pt_callback_cleanup(void *handle)
 {
     ((pxThread *)handle)->_ThreadCleanup();
@@ -76,6 +76,8 @@ class FlatFileReader : public AsyncFileReader
 #elif defined(__linux__)
 	int m_fd; // FIXME don't know if overlap as an equivalent on linux
 	io_context_t m_aio_context;
+	// io_uring backend, libaio is only used when it isn't available.
+	class IoUringFileReader* m_uring;
 #elif defined(__POSIX__)
 	int m_fd; // TODO OSX don't know if overlap as an equivalent on OSX
 	struct aiocb m_aiocb;
@@ -83,9 +85,10 @@ class FlatFileReader : public AsyncFileReader
 #endif
 
 	bool shareWrite;
+	bool directIO; // bypasses the page cache (Linux io_uring backend only)
 
 public:
-	FlatFileReader(bool shareWrite = false);
+	FlatFileReader(bool shareWrite = false, bool directIO = false);
 	virtual ~FlatFileReader(void);
 
 	virtual bool Open(const wxString& fileName);
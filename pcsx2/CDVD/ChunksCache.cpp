@@ -21,32 +21,77 @@ void ChunksCache::SetLimit(uint megabytes) {
 	MatchLimit();
 }
 
+void ChunksCache::Remove(EntryIt it) {
+	CacheEntry* e = *it;
+	for (PX_off_t b = FirstBucket(e); b <= LastBucket(e); b++) {
+		auto bucket = m_buckets.find(b);
+		std::vector<EntryIt>& list = bucket->second;
+		list.erase(std::find(list.begin(), list.end(), it));
+		if (list.empty())
+			m_buckets.erase(bucket);
+	}
+	m_size -= e->size;
+	delete e;
+	m_entries.erase(it);
+}
+
 void ChunksCache::MatchLimit(bool removeAll) {
-	std::list<CacheEntry*>::reverse_iterator rit;
 	while (!m_entries.empty() && (removeAll || m_size > m_limit)) {
-		rit = m_entries.rbegin();
-		m_size -= (*rit)->size;
-		delete(*rit);
-		m_entries.pop_back();
+		Remove(std::prev(m_entries.end()));
+		if (!removeAll)
+			m_evictions++;
 	}
 }
 
 void ChunksCache::Take(void* pMallocedSrc, PX_off_t offset, int length, int coverage) {
+	if (length > m_limit) {
+		// Would evict everything else, and then itself.
+		free(pMallocedSrc);
+		m_evictions++;
+		return;
+	}
+
 	m_entries.push_front(new CacheEntry(pMallocedSrc, offset, length, coverage));
 	m_size += length;
+	for (PX_off_t b = FirstBucket(m_entries.front()); b <= LastBucket(m_entries.front()); b++)
+		m_buckets[b].push_back(m_entries.begin());
 	MatchLimit();
 }
 
 // By design, succeed only if the entire request is in a single cached chunk
 int ChunksCache::Read(void* pDest, PX_off_t offset, int length) {
-	for (auto it = m_entries.begin(); it != m_entries.end(); it++) {
-		CacheEntry* e = *it;
-		if (e && offset >= e->offset && (offset + length) <= (e->offset + e->coverage)) {
-			if (it != m_entries.begin())
-				m_entries.splice(m_entries.begin(), m_entries, it); // Move to top (MRU)
-			return CopyAvailable(e->data, e->offset, e->size, pDest, offset, length);
+	auto bucket = m_buckets.find(offset >> BUCKET_SHIFT);
+	if (bucket != m_buckets.end()) {
+		for (EntryIt it : bucket->second) {
+			CacheEntry* e = *it;
+			if (offset >= e->offset && (offset + length) <= (e->offset + e->coverage)) {
+				if (it != m_entries.begin())
+					m_entries.splice(m_entries.begin(), m_entries, it); // Move to top (MRU), iterators stay valid
+				m_hits++;
+				return CopyAvailable(e->data, e->offset, e->size, pDest, offset, length);
+			}
 		}
 	}
+	m_misses++;
 	return -1;
 }
 
+ChunksCache::Stats ChunksCache::GetStats() const {
+	Stats stats;
+	stats.hits = m_hits;
+	stats.misses = m_misses;
+	stats.evictions = m_evictions;
+	stats.size = m_size;
+	stats.entries = (int)m_entries.size();
+	return stats;
+}
+
+void ChunksCache::LogStats(const char* name) const {
+	const u64 lookups = m_hits + m_misses;
+	if (!lookups)
+		return;
+
+	Console.WriteLn(Color_Gray, "%s cache: %llu/%llu hits (%.1f%%), %llu evictions, %d chunks, %.1f/%.1f MB",
+		name, m_hits, lookups, 100.0 * m_hits / lookups, m_evictions, (int)m_entries.size(),
+		m_size / 1048576.0, m_limit / 1048576.0);
+}
@@ -16,12 +16,26 @@
 #pragma once
 
 #include "zlib_indexed.h"
+#include <unordered_map>
 
 #define CLAMP(val, minval, maxval) (std::min(maxval, std::max(minval, val)))
 
+// LRU cache of extracted chunks of a compressed file.
+//
+// Chunks are found in O(1) through a hash of fixed size "buckets" of the
+// (uncompressed) file: every chunk is listed in the buckets it overlaps, which
+// is at most a handful of them for the chunk sizes the readers use (64K-4MB).
 class ChunksCache {
 public:
-	ChunksCache(uint initialLimitMb) : m_entries(0), m_size(0), m_limit(initialLimitMb * 1024 * 1024) {};
+	struct Stats {
+		u64 hits;
+		u64 misses;
+		u64 evictions;
+		PX_off_t size;  // bytes currently cached
+		int entries;
+	};
+
+	ChunksCache(uint initialLimitMb) : m_size(0), m_limit((PX_off_t)initialLimitMb * 1024 * 1024) { ResetStats(); };
 	~ChunksCache() { Clear(); };
 	void SetLimit(uint megabytes);
 	void Clear() { MatchLimit(true); };
@@ -29,6 +43,11 @@ public:
 	void Take(void* pMallocedSrc, PX_off_t offset, int length, int coverage);
 	int  Read(void* pDest,        PX_off_t offset, int length);
 
+	Stats GetStats() const;
+	void ResetStats() { m_hits = m_misses = m_evictions = 0; }
+	// Prints the stats to the console, if the cache was used at all.
+	void LogStats(const char* name) const;
+
 	static int CopyAvailable(void* pSrc, PX_off_t srcOffset, int srcSize,
 							 void* pDst, PX_off_t dstOffset, int maxCopySize) {
 		int available = CLAMP(maxCopySize, 0, (int)(srcOffset + srcSize - dstOffset));
@@ -54,10 +73,23 @@ private:
 		int size;
 	};
 
-	std::list<CacheEntry*> m_entries;
+	typedef std::list<CacheEntry*>::iterator EntryIt;
+
+	static const int BUCKET_SHIFT = 16;
+	static PX_off_t FirstBucket(const CacheEntry* e) { return e->offset >> BUCKET_SHIFT; }
+	static PX_off_t LastBucket(const CacheEntry* e) { return (e->offset + std::max(e->coverage, 1) - 1) >> BUCKET_SHIFT; }
+
+	void Remove(EntryIt it);
 	void MatchLimit(bool removeAll = false);
+
+	std::list<CacheEntry*> m_entries; // MRU first
+	std::unordered_map<PX_off_t, std::vector<EntryIt>> m_buckets;
 	PX_off_t m_size;
 	PX_off_t m_limit;
+
+	u64 m_hits;
+	u64 m_misses;
+	u64 m_evictions;
 };
 
 #undef CLAMP
@@ -18,6 +18,7 @@
 #include "CompressedFileReaderUtils.h"
 #include "CsoFileReader.h"
 #include "Pcsx2Types.h"
+#include "Utilities/PersistentThread.h"
 #ifdef __POSIX__
 #include <zlib.h>
 #else
@@ -38,6 +39,111 @@ struct CsoHeader {
 
 static const u32 CSO_READ_BUFFER_SIZE = 256 * 1024;
 
+// A prefetch worker has its own file handle and zlib stream, so it never touches
+// the reader's. The only shared state is the queue and the cache of decompressed
+// frames, both behind the reader's m_prefetchLock.
+class CsoPrefetchThread : public pxThread
+{
+	CsoFileReader& m_reader;
+	FILE* m_src;
+	z_stream m_z_stream;
+	bool m_z_init;
+	u8* m_readBuffer;
+
+public:
+	CsoPrefetchThread(CsoFileReader& reader, int id) :
+		m_reader(reader), m_src(NULL), m_z_init(false), m_readBuffer(NULL)
+	{
+		m_name = wxsFormat(L"CSO Prefetch %d", id);
+	}
+
+	virtual ~CsoPrefetchThread()
+	{
+		try {
+			pxThread::Cancel();
+		}
+		DESTRUCTOR_CATCHALL
+
+		if (m_src)
+			fclose(m_src);
+		if (m_z_init)
+			inflateEnd(&m_z_stream);
+		delete[] m_readBuffer;
+	}
+
+	bool Init()
+	{
+		m_src = PX_fopen_rb(m_reader.m_filename);
+		if (!m_src)
+			return false;
+
+		m_readBuffer = new u8[m_reader.m_frameSize + (1 << m_reader.m_indexShift)];
+
+		m_z_stream.zalloc = Z_NULL;
+		m_z_stream.zfree = Z_NULL;
+		m_z_stream.opaque = Z_NULL;
+		m_z_init = inflateInit2(&m_z_stream, -15) == Z_OK;
+		return m_z_init;
+	}
+
+protected:
+	void ExecuteTaskInThread()
+	{
+		while (true) {
+			m_reader.m_prefetchSema.WaitWithoutYield();
+
+			u32 frame;
+			{
+				ScopedLock lock(m_reader.m_prefetchLock);
+				if (m_reader.m_prefetchQueue.empty())
+					continue;
+				frame = m_reader.m_prefetchQueue.front();
+				m_reader.m_prefetchQueue.pop_front();
+			}
+
+			void* data = Decompress(frame);
+
+			ScopedLock lock(m_reader.m_prefetchLock);
+			m_reader.m_prefetchPending.erase(frame);
+			if (data) {
+				const u32 size = m_reader.m_frameSize;
+				m_reader.m_prefetchCache.Take(data, (PX_off_t)frame << m_reader.m_frameShift, size, size);
+				m_reader.m_prefetchStats.prefetched++;
+			}
+		}
+	}
+
+	// Returns a malloced frame ready to be handed over to the ChunksCache, or NULL.
+	void* Decompress(u32 frame)
+	{
+		const u32 index0 = m_reader.m_index[frame + 0] & 0x7FFFFFFF;
+		const u32 index1 = m_reader.m_index[frame + 1] & 0x7FFFFFFF;
+		const u64 frameRawPos = (u64)index0 << m_reader.m_indexShift;
+		const u64 frameRawSize = (u64)(index1 - index0) << m_reader.m_indexShift;
+
+		if (PX_fseeko(m_src, m_reader.m_dataoffset + frameRawPos, SEEK_SET) != 0)
+			return NULL;
+		const u32 readRawBytes = fread(m_readBuffer, 1, frameRawSize, m_src);
+
+		void* data = malloc(m_reader.m_frameSize);
+		m_z_stream.next_in = m_readBuffer;
+		m_z_stream.avail_in = readRawBytes;
+		m_z_stream.next_out = (Bytef*)data;
+		m_z_stream.avail_out = m_reader.m_frameSize;
+
+		int status = inflate(&m_z_stream, Z_FINISH);
+		bool success = status == Z_STREAM_END && m_z_stream.total_out == m_reader.m_frameSize;
+		inflateReset(&m_z_stream);
+
+		if (!success) {
+			// Leave it to the reader, which will report the error if it happens again.
+			free(data);
+			return NULL;
+		}
+		return data;
+	}
+};
+
 bool CsoFileReader::CanHandle(const wxString& fileName) {
 	bool supported = false;
 	if (wxFileName::FileExists(fileName) && fileName.Lower().EndsWith(L".cso")) {
@@ -89,6 +195,8 @@ bool CsoFileReader::Open(const wxString& fileName) {
 		Close();
 		return false;
 	}
+
+	StartPrefetch();
 	return true;
 }
 
@@ -154,9 +262,60 @@ bool CsoFileReader::InitializeBuffers() {
 	return true;
 }
 
+void CsoFileReader::StartPrefetch() {
+	for (int i = 0; i < CSO_PREFETCH_THREADS; i++) {
+		CsoPrefetchThread* thread = new CsoPrefetchThread(*this, i);
+		if (!thread->Init()) {
+			Console.Warning(L"CSO: unable to start the prefetch threads, reading synchronously.");
+			delete thread;
+			StopPrefetch();
+			return;
+		}
+		thread->Start();
+		m_prefetch.push_back(thread);
+	}
+}
+
+void CsoFileReader::StopPrefetch() {
+	// The workers are cancelled while waiting on the semaphore (or reading the file),
+	// never while holding the lock for longer than a cache insertion.
+	for (CsoPrefetchThread* thread : m_prefetch)
+		delete thread;
+	m_prefetch.clear();
+
+	m_prefetchQueue.clear();
+	m_prefetchPending.clear();
+	m_prefetchCache.Clear();
+	m_prefetchCache.ResetStats();
+	m_prefetchSema.Reset();
+	m_prefetchLast = 0;
+	m_prefetchAhead = 0;
+	m_prefetchStreak = 0;
+}
+
+CsoPrefetchStats CsoFileReader::GetPrefetchStats() {
+	ScopedLock lock(m_prefetchLock);
+	return m_prefetchStats;
+}
+
 void CsoFileReader::Close() {
+	// The workers are stopped first, so that they're done updating the stats.
+	const bool prefetched = !m_prefetch.empty();
+	StopPrefetch();
+
+	if (prefetched) {
+		CsoPrefetchStats stats = GetPrefetchStats();
+		u64 total = stats.hits + stats.misses;
+		if (total) {
+			Console.WriteLn(Color_Gray, "CSO prefetch: %llu/%llu frames hit (%.1f%%), %llu late, %llu prefetched",
+				stats.hits, total, 100.0 * stats.hits / total, stats.late, stats.prefetched);
+		}
+	}
+	memzero(m_prefetchStats);
+
 	m_filename.Empty();
 #if CSO_USE_CHUNKSCACHE
+	m_cache.LogStats("CSO");
 	m_cache.Clear();
 #endif
 
@@ -257,7 +416,7 @@ int CsoFileReader::ReadFromFrame(u8 *dest, u64 pos, int maxBytes) {
 		return fread(dest, 1, bytes, m_src);
 	} else {
 		// We don't need to decompress if we already did this same frame last time.
-		if (m_zlibBufferFrame != frame) {
+		if (m_zlibBufferFrame != frame && !ReadPrefetched(frame)) {
 			if (PX_fseeko(m_src, m_dataoffset + frameRawPos, SEEK_SET) != 0) {
 				Console.Error("Unable to seek to compressed CSO data.");
 				return 0;
@@ -270,6 +429,8 @@ int CsoFileReader::ReadFromFrame(u8 *dest, u64 pos, int maxBytes) {
 			}
 		}
 
+		QueuePrefetch(frame);
+
 		// Now we just copy the offset data from the cache.
 		memcpy(dest, m_zlibBuffer + offset, bytes);
 	}
@@ -297,6 +458,67 @@ bool CsoFileReader::DecompressFrame(u32 frame, u32 readBufferSize) {
 	return success;
 }
 
+bool CsoFileReader::ReadPrefetched(u32 frame) {
+	if (m_prefetch.empty()) {
+		return false;
+	}
+
+	ScopedLock lock(m_prefetchLock);
+	if (m_prefetchCache.Read(m_zlibBuffer, (PX_off_t)frame << m_frameShift, m_frameSize) == (int)m_frameSize) {
+		m_zlibBufferFrame = frame;
+		m_prefetchStats.hits++;
+		return true;
+	}
+
+	// Decompressing it here is no slower than waiting for the worker to finish.
+	if (m_prefetchPending.count(frame)) {
+		m_prefetchStats.late++;
+	}
+	m_prefetchStats.misses++;
+	return false;
+}
+
+void CsoFileReader::QueuePrefetch(u32 frame) {
+	if (m_prefetch.empty() || frame == m_prefetchLast) {
+		return;
+	}
+
+	// Only prefetch once the reads look sequential, random access would just
+	// waste the workers' time and evict useful frames.
+	if (frame == m_prefetchLast + 1) {
+		m_prefetchStreak++;
+	} else {
+		m_prefetchStreak = 0;
+		m_prefetchAhead = frame;
+	}
+	m_prefetchLast = frame;
+	if (m_prefetchStreak < 2) {
+		return;
+	}
+
+	const u32 numFrames = (u32)((m_totalSize + m_frameSize - 1) / m_frameSize);
+	const u32 window = std::max<u32>(1, CSO_PREFETCH_BYTES >> m_frameShift);
+	const u32 last = std::min(frame + window, numFrames - 1);
+	if (m_prefetchAhead < frame) {
+		m_prefetchAhead = frame;
+	}
+
+	int queued = 0;
+	ScopedLock lock(m_prefetchLock);
+	for (u32 f = m_prefetchAhead + 1; f <= last; f++) {
+		if (IsFrameCompressed(f) && m_prefetchPending.insert(f).second) {
+			m_prefetchQueue.push_back(f);
+			queued++;
+		}
+	}
+	m_prefetchAhead = std::max(m_prefetchAhead, last);
+	lock.Release();
+
+	if (queued) {
+		m_prefetchSema.Post(queued);
+	}
+}
+
 void CsoFileReader::BeginRead(void* pBuffer, uint sector, uint count) {
 	// TODO: No async support yet, implement as sync.
 	m_bytesRead = ReadSync(pBuffer, sector, count);
@@ -22,15 +22,35 @@
 // Cache overhead added 35% to the overall read time.
 //
 // For this reason, it's currently disabled.
+// (Those numbers predate the hashed lookup of ChunksCache, which used to scan all its entries.)
 #define CSO_USE_CHUNKSCACHE 0
 
+// Number of background threads which decompress the frames ahead of a sequential
+// read (streaming FMVs/audio, loading screens). 0 disables the prefetch entirely.
+#define CSO_PREFETCH_THREADS 2
+
 #include "AsyncFileReader.h"
 #include "ChunksCache.h"
+#include "Utilities/Threading.h"
+#include <deque>
+#include <set>
 
 struct CsoHeader;
 typedef struct z_stream_s z_stream;
+class CsoPrefetchThread;
 
 static const uint CSO_CHUNKCACHE_SIZE_MB = 200;
+// Decompressed frames which were prefetched but not consumed yet.
+static const uint CSO_PREFETCH_CACHE_SIZE_MB = 16;
+// How far ahead of a sequential read the prefetch goes.
+static const uint CSO_PREFETCH_BYTES = 256 * 1024;
+
+struct CsoPrefetchStats {
+	u64 hits;       // frames served from the prefetch cache
+	u64 misses;     // frames decompressed inline by the reader
+	u64 late;       // misses on a frame a worker was still decompressing
+	u64 prefetched; // frames decompressed by the workers
+};
 
 class CsoFileReader : public AsyncFileReader
 {
@@ -50,8 +70,13 @@ public:
 #if CSO_USE_CHUNKSCACHE
 		m_cache(CSO_CHUNKCACHE_SIZE_MB),
 #endif
+		m_prefetchCache(CSO_PREFETCH_CACHE_SIZE_MB),
+		m_prefetchLast(0),
+		m_prefetchAhead(0),
+		m_prefetchStreak(0),
 		m_bytesRead(0) {
 		m_blocksize = 2048;
+		memzero(m_prefetchStats);
 	};
 
 	virtual ~CsoFileReader(void) { Close(); };
@@ -74,12 +99,22 @@ public:
 	virtual void SetBlockSize(uint bytes) { m_blocksize = bytes; }
 	virtual void SetDataOffset(int bytes) { m_dataoffset = bytes; }
 
+	CsoPrefetchStats GetPrefetchStats();
+
 private:
+	friend class CsoPrefetchThread;
+
 	static bool ValidateHeader(const CsoHeader& hdr);
 	bool ReadFileHeader();
 	bool InitializeBuffers();
 	int ReadFromFrame(u8 *dest, u64 pos, int maxBytes);
 	bool DecompressFrame(u32 frame, u32 readBufferSize);
+	bool IsFrameCompressed(u32 frame) const { return (m_index[frame] & 0x80000000) == 0; }
+
+	void StartPrefetch();
+	void StopPrefetch();
+	bool ReadPrefetched(u32 frame);
+	void QueuePrefetch(u32 frame);
 
 	u32 m_frameSize;
 	u8 m_frameShift;
@@ -97,6 +132,20 @@ private:
 	ChunksCache m_cache;
 #endif
 
+	// Background decompression of the frames following a sequential read.
+	// Everything below (but the thread pointers) is protected by m_prefetchLock.
+	std::vector<CsoPrefetchThread*> m_prefetch;
+	Threading::Mutex m_prefetchLock;
+	Threading::Semaphore m_prefetchSema;
+	std::deque<u32> m_prefetchQueue;
+	std::set<u32> m_prefetchPending;
+	ChunksCache m_prefetchCache;
+	CsoPrefetchStats m_prefetchStats;
+	// Only touched by the reader thread.
+	u32 m_prefetchLast;
+	u32 m_prefetchAhead;
+	int m_prefetchStreak;
+
 	// The result of a read is stored here between BeginRead() and FinishRead().
 	int m_bytesRead;
 };
@@ -15,12 +15,14 @@
 
 #include "PrecompiledHeader.h"
 #include <fstream>
+#include <stddef.h>
 #include <wx/stdpaths.h>
 #include "AppConfig.h"
 #include "ChunksCache.h"
 #include "CompressedFileReaderUtils.h"
 #include "GzippedFileReader.h"
 #include "zlib_indexed.h"
+#include "Utilities/PersistentThread.h"
 
 #define CLAMP(val, minval, maxval) (std::min(maxval, std::max(minval, val)))
 
@@ -43,37 +45,49 @@ static s64 fsize(const wxString& filename) {
 // - [GZIP_ID_LEN] GZIP_ID (no \0)
 // - [sizeof(Access)] index (should be allocated, contains various sizes)
 // - [rest] the indexed data points (should be allocated, index->list should then point to it)
-static Access* ReadIndexFromFile(const wxString& filename) {
+//
+// Only the offsets of the access points are read here, which is all extract() needs to
+// locate them. Their 32K windows are read on first use (see LoadIndexWindow), so that even
+// a big index opens instantly. *pSrc is left open for that purpose.
+static const PX_off_t INDEX_POINTS_OFFSET = GZIP_ID_LEN + sizeof(Access);
+
+static Access* ReadIndexFromFile(const wxString& filename, FILE** pSrc) {
 	s64 size = fsize(filename);
-	if (size <= 0) {
+	FILE* infile = size > 0 ? PX_fopen_rb(filename) : NULL;
+	if (!infile) {
 		Console.Error(L"Error: Can't open index file: '%s'", WX_STR(filename));
 		return 0;
 	}
-	std::ifstream infile(PX_wfilename(filename), std::ifstream::binary);
 
 	char fileId[GZIP_ID_LEN + 1] = { 0 };
-	infile.read(fileId, GZIP_ID_LEN);
-	if (wxString::From8BitData(GZIP_ID) != wxString::From8BitData(fileId)) {
+	if (fread(fileId, 1, GZIP_ID_LEN, infile) != GZIP_ID_LEN || wxString::From8BitData(GZIP_ID) != wxString::From8BitData(fileId)) {
 		Console.Error(L"Error: Incompatible gzip index, please delete it manually: '%s'", WX_STR(filename));
-		infile.close();
+		fclose(infile);
 		return 0;
 	}
 
 	Access* index = (Access*)malloc(sizeof(Access));
-	infile.read((char*)index, sizeof(Access));
-
-	s64 datasize = size - GZIP_ID_LEN - sizeof(Access);
-	if (datasize != (s64)index->have * sizeof(Point)) {
+	s64 datasize = size - INDEX_POINTS_OFFSET;
+	if (fread(index, 1, sizeof(Access), infile) != sizeof(Access) || datasize != (s64)index->have * sizeof(Point)) {
 		Console.Error(L"Error: unexpected size of gzip index, please delete it manually: '%s'.", WX_STR(filename));
-		infile.close();
+		fclose(infile);
 		free(index);
 		return 0;
 	}
 
-	char* buffer = (char*)malloc(datasize);
-	infile.read(buffer, datasize);
-	infile.close();
-	index->list = (Point*)buffer; // adjust list pointer
+	// calloc'ed pages are only committed once a window is actually loaded into them
+	index->list = (Point*)calloc(index->have, sizeof(Point));
+	for (int i = 0; i < index->have; i++) {
+		PX_fseeko(infile, INDEX_POINTS_OFFSET + (PX_off_t)i * sizeof(Point), SEEK_SET);
+		if (fread(&index->list[i], 1, offsetof(Point, window), infile) != offsetof(Point, window)) {
+			Console.Error(L"Error: Can't read gzip index, please delete it manually: '%s'.", WX_STR(filename));
+			fclose(infile);
+			free_index(index);
+			return 0;
+		}
+	}
+
+	*pSrc = infile;
 	return index;
 }
 
@@ -102,6 +116,107 @@ static void WriteIndexToFile(Access* index, const wxString filename) {
 	}
 }
 
+// Each member of a bgzf file is independent, and its compressed and uncompressed sizes are
+// in its header and trailer. So the index is laid out from the member sizes alone, and
+// the actual decompression (only needed to verify the data, which build_index does as
+// a side effect) is split between all the cores.
+class GzipVerifyThread : public pxThread
+{
+	wxString m_filename;
+	PX_off_t m_pos;
+	int m_count;
+
+public:
+	int result;
+
+	GzipVerifyThread(const wxString& filename, PX_off_t pos, int count) :
+		m_filename(filename), m_pos(pos), m_count(count), result(Z_ERRNO)
+	{
+		m_name = L"gzip index";
+	}
+
+	virtual ~GzipVerifyThread()
+	{
+		try {
+			pxThread::Cancel();
+		}
+		DESTRUCTOR_CATCHALL
+	}
+
+protected:
+	void ExecuteTaskInThread()
+	{
+		FILE* in = PX_fopen_rb(m_filename);
+		if (in) {
+			result = inflate_members(in, m_pos, m_count);
+			fclose(in);
+		}
+	}
+};
+
+// Returns the number of access points (> 0) on success, 0 if this isn't a bgzf file
+// (build_index should be used instead), or a zlib error.
+static int BuildBgzfIndex(FILE* in, const wxString& filename, PX_off_t span, Access** built) {
+	static const unsigned char window[WINSIZE] = {}; // a member never refers to data before it
+
+	unsigned size, head, out;
+	if (!bgzf_member(in, 0, &size, &head, &out))
+		return 0;
+
+	std::vector<PX_off_t> members;
+	Access* index = NULL;
+	PX_off_t pos = 0, totout = 0, last = 0;
+	while (bgzf_member(in, pos, &size, &head, &out)) {
+		if (index == NULL || totout - last > span) {
+			index = addpoint(index, 0, pos + head, totout, 0, (unsigned char*)window);
+			if (index == NULL)
+				return Z_MEM_ERROR;
+			last = totout;
+		}
+		members.push_back(pos);
+		pos += size;
+		totout += out;
+	}
+
+	if (pos != fsize(filename)) {
+		// Only the start of the file is bgzf, let build_index deal with the rest.
+		free_index(index);
+		return 0;
+	}
+
+	const int threads = std::max<int>(1, std::min<int>(x86caps.LogicalCores, members.size()));
+	Console.WriteLn(Color_Gray, L"bgzf layout detected, verifying %d blocks on %d threads...", (int)members.size(), threads);
+
+	std::vector<GzipVerifyThread*> workers;
+	int first = 0;
+	for (int i = 0; i < threads; i++) {
+		int count = (members.size() - first) / (threads - i);
+		workers.push_back(new GzipVerifyThread(filename, members[first], count));
+		workers.back()->Start();
+		first += count;
+	}
+
+	int ret = Z_OK;
+	for (GzipVerifyThread* worker : workers) {
+		worker->Block();
+		if (worker->result != Z_OK)
+			ret = worker->result;
+		delete worker;
+	}
+
+	if (ret != Z_OK) {
+		free_index(index);
+		return ret;
+	}
+
+	index->list = (Point*)realloc(index->list, sizeof(struct point) * index->have);
+	index->size = index->have;
+	index->span = span;
+	index->uncompressed_size = totout;
+	*built = index;
+	return index->have;
+}
+
 static wxString INDEX_TEMPLATE_KEY(L"$(f)");
 // template:
 // must contain one and only one instance of '$(f)' (without the quotes)
@@ -182,6 +297,7 @@ GzippedFileReader::GzippedFileReader(void) :
 	m_pIndex(0),
 	m_zstates(0),
 	m_src(0),
+	m_indexSrc(0),
 	m_cache(GZFILE_CACHE_SIZE_MB) {
 	m_blocksize = 2048;
 	AsyncPrefetchReset();
@@ -291,7 +407,8 @@ bool GzippedFileReader::OkIndex() {
 	if (indexfile.length() == 0)
 		return false; // iso2indexname(...) will print errors if it can't apply the template
 
-	if (wxFileName::FileExists(indexfile) && (m_pIndex = ReadIndexFromFile(indexfile))) {
+	if (wxFileName::FileExists(indexfile) && (m_pIndex = ReadIndexFromFile(indexfile, &m_indexSrc))) {
+		m_indexLoaded.assign(m_pIndex->have, false);
 		Console.WriteLn(Color_Green, L"OK: Gzip quick access index read from disk: '%s'", WX_STR(indexfile));
 		if (m_pIndex->span != GZFILE_SPAN_DEFAULT) {
 			Console.Warning(L"Note: This index has %1.1f MB intervals, while the current default for new indexes is %1.1f MB.",
@@ -306,10 +423,14 @@ bool GzippedFileReader::OkIndex() {
 	// No valid index file. Generate an index
 	Console.Warning(L"This may take a while (but only once). Scanning compressed file to generate a quick access index...");
 
-	Access *index;
+	Access *index = NULL;
 	FILE* infile = PX_fopen_rb(m_filename);
-	int len = build_index(infile, GZFILE_SPAN_DEFAULT, &index);
-	printf("\n"); // build_index prints progress without \n's
+	int len = BuildBgzfIndex(infile, m_filename, GZFILE_SPAN_DEFAULT, &index);
+	if (len == 0) {
+		PX_fseeko(infile, 0, SEEK_SET);
+		len = build_index(infile, GZFILE_SPAN_DEFAULT, &index);
+		printf("\n"); // build_index prints progress without \n's
+	}
 	fclose(infile);
 
 	if (len >= 0) {
@@ -334,6 +455,8 @@ bool GzippedFileReader::Open(const wxString& fileName) {
 		return false;
 	};
 
+	m_cache.SetLimit(std::max(g_Conf->CompressedIsoCacheMB, 1));
+	m_cache.ResetStats();
 	AsyncPrefetchOpen();
 	return true;
 };
@@ -415,6 +538,7 @@ int GzippedFileReader::_ReadSync(void* pBuffer, PX_off_t offset, uint bytesToRea
 	int span = m_pIndex->span;
 	int spanix = extractOffset / span;
 	AsyncPrefetchCancel();
+	LoadIndexWindow(extractOffset);
 	res = extract(m_src, m_pIndex, extractOffset, extracted, size, &(m_zstates[spanix].state));
 	if (res < 0) {
 		free(extracted);
@@ -462,6 +586,22 @@ int GzippedFileReader::_ReadSync(void* pBuffer, PX_off_t offset, uint bytesToRea
 	return copied;
 }
 
+// Access points of an index read from disk get their window on first use.
+// Harmless if the state of the span is used instead of the access point.
+void GzippedFileReader::LoadIndexWindow(PX_off_t offset) {
+	if (!m_indexSrc)
+		return; // built during this session, everything is already in memory
+
+	int point = find_point(m_pIndex, offset);
+	if (m_indexLoaded[point])
+		return;
+
+	PX_off_t pos = INDEX_POINTS_OFFSET + (PX_off_t)point * sizeof(Point) + offsetof(Point, window);
+	if (PX_fseeko(m_indexSrc, pos, SEEK_SET) != 0 || fread(m_pIndex->list[point].window, 1, WINSIZE, m_indexSrc) != WINSIZE)
+		Console.Error(L"Error: Can't read gzip index access point %d.", point);
+	m_indexLoaded[point] = true;
+}
+
 void GzippedFileReader::Close() {
 	m_filename.Empty();
 	if (m_pIndex) {
@@ -469,7 +609,14 @@ void GzippedFileReader::Close() {
 		m_pIndex = 0;
 	}
 
+	if (m_indexSrc) {
+		fclose(m_indexSrc);
+		m_indexSrc = 0;
+	}
+	m_indexLoaded.clear();
+
 	InitZstates(); // results in delete because no index
+	m_cache.LogStats("gzip");
 	m_cache.Clear();
 
 	if (m_src) {
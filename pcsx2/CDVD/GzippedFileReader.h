@@ -23,7 +23,7 @@ typedef struct zstate Zstate;
 
 #define GZFILE_SPAN_DEFAULT (1048576L * 4)   /* distance between direct access points when creating a new index */
 #define GZFILE_READ_CHUNK_SIZE (256 * 1024)  /* zlib extraction chunks size (at 0-based boundaries) */
-#define GZFILE_CACHE_SIZE_MB 200             /* cache size for extracted data. must be at least GZFILE_READ_CHUNK_SIZE (in MB)*/
+#define GZFILE_CACHE_SIZE_MB 200             /* initial cache size for extracted data, see CompressedIsoCacheMB (in MB)*/
 
 class GzippedFileReader : public AsyncFileReader
 {
@@ -69,11 +69,14 @@ private:
 	PX_off_t GetOptimalExtractionStart(PX_off_t offset);
 	int     _ReadSync(void* pBuffer, PX_off_t offset, uint bytesToRead);
 	void	InitZstates();
+	void	LoadIndexWindow(PX_off_t offset);
 
 	int		mBytesRead; // Temp sync read result when simulating async read
 	Access* m_pIndex;   // Quick access index
 	Czstate* m_zstates;
 	FILE*	m_src;
+	FILE*	m_indexSrc;  // Index file, while access points are still loaded lazily
+	std::vector<bool> m_indexLoaded;
 
 	ChunksCache m_cache;
 
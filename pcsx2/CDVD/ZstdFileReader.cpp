@@ -0,0 +1,144 @@
+/*  PCSX2 - PS2 Emulator for PCs
+*  Copyright (C) 2002-2014  PCSX2 Dev Team
+*
+*  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+*  of the GNU Lesser General Public License as published by the Free Software Found-
+*  ation, either version 3 of the License, or (at your option) any later version.
+*
+*  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+*  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+*  PURPOSE.  See the GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License along with PCSX2.
+*  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "PrecompiledHeader.h"
+#include "AppConfig.h"
+#include "AsyncFileReader.h"
+#include "CompressedFileReaderUtils.h"
+#include "ZstdFileReader.h"
+#include <zstd.h>
+
+bool ZstdFileReader::CanHandle(const wxString& fileName) {
+	bool supported = false;
+	if (wxFileName::FileExists(fileName) && fileName.Lower().EndsWith(L".zst")) {
+		FILE* fp = PX_fopen_rb(fileName);
+		if (fp) {
+			// A plain (non seekable) zstd file is valid too, but can't be read randomly.
+			ZstdSeekTable table;
+			supported = ZstdSeekableReadTable(fp, table);
+			if (!supported)
+				Console.Error(L"'%s' has no zstd seek table, please convert it with isozstd.", WX_STR(fileName));
+			fclose(fp);
+		}
+	}
+	return supported;
+}
+
+bool ZstdFileReader::Open(const wxString& fileName) {
+	Close();
+	m_filename = fileName;
+	m_src = PX_fopen_rb(m_filename);
+
+	if (!m_src || !ZstdSeekableReadTable(m_src, m_table)) {
+		Console.Error(L"Unable to read the zstd seek table.");
+		Close();
+		return false;
+	}
+
+	m_dctx = ZSTD_createDCtx();
+	m_readBuffer = new u8[m_table.maxCompressedSize];
+	m_cache.SetLimit(std::max(g_Conf->CompressedIsoCacheMB, 1));
+	m_cache.ResetStats();
+	return true;
+}
+
+void ZstdFileReader::Close() {
+	m_filename.Empty();
+	m_cache.LogStats("zstd");
+	m_cache.Clear();
+	m_table.Clear();
+
+	if (m_src) {
+		fclose(m_src);
+		m_src = NULL;
+	}
+	if (m_dctx) {
+		ZSTD_freeDCtx(m_dctx);
+		m_dctx = NULL;
+	}
+	if (m_readBuffer) {
+		delete[] m_readBuffer;
+		m_readBuffer = NULL;
+	}
+}
+
+int ZstdFileReader::ReadSync(void* pBuffer, uint sector, uint count) {
+	if (!m_src) {
+		return 0;
+	}
+
+	u8* dest = (u8*)pBuffer;
+	PX_off_t pos = (PX_off_t)sector * m_blocksize + m_dataoffset;
+	int remaining = count * m_blocksize;
+	int bytes = 0;
+
+	while (remaining > 0) {
+		int readBytes = ReadFromFrame(dest + bytes, pos + bytes, remaining);
+		if (readBytes <= 0) {
+			// EOF or error.
+			break;
+		}
+		bytes += readBytes;
+		remaining -= readBytes;
+	}
+
+	return bytes;
+}
+
+// Reads as much as possible of [pos, pos + maxBytes) from a single frame.
+int ZstdFileReader::ReadFromFrame(u8* dest, PX_off_t pos, int maxBytes) {
+	if (pos >= m_table.UncompressedSize()) {
+		return 0;
+	}
+
+	const int frame = m_table.FindFrame(pos);
+	const PX_off_t frameOut = m_table.out[frame];
+	const u32 frameSize = (u32)(m_table.out[frame + 1] - frameOut);
+	const int bytes = (int)std::min<PX_off_t>(maxBytes, frameOut + frameSize - pos);
+
+	int res = m_cache.Read(dest, pos, bytes);
+	if (res >= 0) {
+		return res;
+	}
+
+	const u32 compressedSize = (u32)(m_table.in[frame + 1] - m_table.in[frame]);
+	if (PX_fseeko(m_src, m_table.in[frame], SEEK_SET) != 0 || fread(m_readBuffer, 1, compressedSize, m_src) != compressedSize) {
+		Console.Error("Unable to read zstd frame %d.", frame);
+		return -1;
+	}
+
+	void* decompressed = malloc(frameSize);
+	size_t size = ZSTD_decompressDCtx(m_dctx, decompressed, frameSize, m_readBuffer, compressedSize);
+	if (ZSTD_isError(size) || size != frameSize) {
+		Console.Error("Unable to decompress zstd frame %d: %s", frame, ZSTD_isError(size) ? ZSTD_getErrorName(size) : "bad size");
+		free(decompressed);
+		return -1;
+	}
+
+	ChunksCache::CopyAvailable(decompressed, frameOut, frameSize, dest, pos, bytes);
+	m_cache.Take(decompressed, frameOut, frameSize, frameSize);
+	return bytes;
+}
+
+void ZstdFileReader::BeginRead(void* pBuffer, uint sector, uint count) {
+	// No async support yet, implement as sync.
+	m_bytesRead = ReadSync(pBuffer, sector, count);
+}
+
+int ZstdFileReader::FinishRead() {
+	int res = m_bytesRead;
+	m_bytesRead = -1;
+	return res;
+}
@@ -0,0 +1,73 @@
+/*  PCSX2 - PS2 Emulator for PCs
+*  Copyright (C) 2002-2014  PCSX2 Dev Team
+*
+*  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+*  of the GNU Lesser General Public License as published by the Free Software Found-
+*  ation, either version 3 of the License, or (at your option) any later version.
+*
+*  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+*  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+*  PURPOSE.  See the GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License along with PCSX2.
+*  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "AsyncFileReader.h"
+#include "ChunksCache.h"
+#include "zstd_seekable.h"
+
+typedef struct ZSTD_DCtx_s ZSTD_DCtx;
+
+// Default size of the cache of decompressed frames, until the user setting is applied
+// by Open(). Frames are cached whole, typically 256KB (see tools/isozstd).
+static const uint ZSTD_CHUNKCACHE_SIZE_MB = 64;
+
+// Reader for ISOs compressed with the zstd seekable format (.zst, see zstd_seekable.h).
+class ZstdFileReader : public AsyncFileReader
+{
+	DeclareNoncopyableObject(ZstdFileReader);
+public:
+	ZstdFileReader(void) :
+		m_src(0),
+		m_dctx(0),
+		m_readBuffer(0),
+		m_cache(ZSTD_CHUNKCACHE_SIZE_MB),
+		m_bytesRead(0) {
+		m_blocksize = 2048;
+	};
+
+	virtual ~ZstdFileReader(void) { Close(); };
+
+	static  bool CanHandle(const wxString& fileName);
+	virtual bool Open(const wxString& fileName);
+
+	virtual int ReadSync(void* pBuffer, uint sector, uint count);
+
+	virtual void BeginRead(void* pBuffer, uint sector, uint count);
+	virtual int FinishRead(void);
+	virtual void CancelRead(void) {};
+
+	virtual void Close(void);
+
+	virtual uint GetBlockCount(void) const {
+		return (uint)((m_table.UncompressedSize() - m_dataoffset) / m_blocksize);
+	};
+
+	virtual void SetBlockSize(uint bytes) { m_blocksize = bytes; }
+	virtual void SetDataOffset(int bytes) { m_dataoffset = bytes; }
+
+private:
+	int ReadFromFrame(u8* dest, PX_off_t pos, int maxBytes);
+
+	FILE* m_src;
+	ZSTD_DCtx* m_dctx;
+	u8* m_readBuffer; // compressed frame
+	ZstdSeekTable m_table;
+	ChunksCache m_cache;
+
+	// The result of a read is stored here between BeginRead() and FinishRead().
+	int m_bytesRead;
+};
@@ -49,6 +49,9 @@ Comments) 1950 to 1952 in the files http://tools.ietf.org/html/rfc1950
       (Thanks to Mark Adler for suggesting the approach)
   - build_index(...) - added progress prints
   - CHUNK changed from 16k to 512k
+  - build_index/extract: continue across concatenated gzip members (bgzf, pigz -i, cat a.gz b.gz)
+  - find_point(...) and next_member(...) helpers, also used by GzippedFileReader
+  - bgzf_member(...) and inflate_members(...) for building bgzf indexes in parallel
  */
 
 /* Illustrate the use of Z_BLOCK, inflatePrime(), and inflateSetDictionary()
@@ -274,8 +277,21 @@ local int build_index(FILE *in, PX_off_t span, struct access **built)
                 ret = Z_DATA_ERROR;
             if (ret == Z_MEM_ERROR || ret == Z_DATA_ERROR)
                 goto build_index_error;
-            if (ret == Z_STREAM_END)
-                break;
+            if (ret == Z_STREAM_END) {
+                /* another gzip member may follow, its data continues the image
+                   (the sliding window stays valid: members never reference
+                   each other, so older data in it is simply unused) */
+                if (strm.avail_in < 2) {
+                    memmove(input, strm.next_in, strm.avail_in);
+                    strm.avail_in += fread(input + strm.avail_in, 1, CHUNK - strm.avail_in, in);
+                    strm.next_in = input;
+                }
+                if (strm.avail_in < 2 || strm.next_in[0] != 0x1f || strm.next_in[1] != 0x8b)
+                    break;
+                inflateReset(&strm);
+                ret = Z_OK;
+                continue;
+            }
 
             /* if at end of block, consider adding an index entry (note that if
                data_type indicates an end-of-block, then all of the
@@ -325,6 +341,121 @@ local int build_index(FILE *in, PX_off_t span, struct access **built)
     return ret;
 }
 
+/* Return the position in the list of the access point to start from for
+   extracting at offset */
+local int find_point(struct access *index, PX_off_t offset)
+{
+    int ret = index->have;
+    int i = 0;
+    while (--ret && index->list[i + 1].out <= offset)
+        i++;
+    return i;
+}
+
+/* end is the input offset right after the deflate data of a gzip member. Skip
+   its trailer and the header of the following member, if any. Returns the
+   input offset of the next member's deflate data, or -1 at the end of the file
+   (or if what follows isn't a gzip member). */
+local PX_off_t next_member(FILE *in, PX_off_t end)
+{
+    unsigned char head[10];
+    int flags, c;
+
+    if (PX_fseeko(in, end + 8, SEEK_SET) != 0)
+        return -1;
+    if (fread(head, 1, 10, in) != 10 || head[0] != 0x1f || head[1] != 0x8b || head[2] != 8)
+        return -1;
+    flags = head[3];
+    if (flags & 4) {                    /* FEXTRA */
+        unsigned char xlen[2];
+        if (fread(xlen, 1, 2, in) != 2 || PX_fseeko(in, xlen[0] | (xlen[1] << 8), SEEK_CUR) != 0)
+            return -1;
+    }
+    if (flags & 8)                      /* FNAME */
+        while ((c = getc(in)) > 0);
+    if (flags & 16)                     /* FCOMMENT */
+        while ((c = getc(in)) > 0);
+    if (flags & 2)                      /* FHCRC */
+        PX_fseeko(in, 2, SEEK_CUR);
+    if (feof(in) || ferror(in))
+        return -1;
+    return PX_ftello(in);
+}
+
+/* bgzf (the blocked gzip format of samtools/htslib, also written by pigz
+   --blocksize and others) stores the compressed size of each member in its
+   header, and the uncompressed size in its trailer, so the members can be
+   located without decompressing anything. Reads the member at pos: returns 1
+   and fills the sizes if it's a bgzf member, 0 otherwise (or at the end of
+   the file). head is the size of the gzip header, i.e. where the deflate data
+   starts. */
+local int bgzf_member(FILE *in, PX_off_t pos, unsigned *size, unsigned *head, unsigned *out)
+{
+    unsigned char h[18], t[4];
+
+    if (PX_fseeko(in, pos, SEEK_SET) != 0 || fread(h, 1, 18, in) != 18)
+        return 0;
+    /* magic, deflate, FEXTRA, XLEN 6, subfield 'BC' of length 2 */
+    if (h[0] != 0x1f || h[1] != 0x8b || h[2] != 8 || !(h[3] & 4) ||
+        h[10] != 6 || h[11] != 0 || h[12] != 'B' || h[13] != 'C' || h[14] != 2 || h[15] != 0)
+        return 0;
+    if (h[3] & ~4)                      /* no name/comment/header crc expected */
+        return 0;
+    *head = 18;
+    *size = (h[16] | (h[17] << 8)) + 1;
+    if (*size < 18 + 8 || PX_fseeko(in, pos + *size - 4, SEEK_SET) != 0 || fread(t, 1, 4, in) != 4)
+        return 0;
+    *out = t[0] | (t[1] << 8) | (t[2] << 16) | ((unsigned)t[3] << 24);
+    return 1;
+}
+
+/* Inflate count consecutive bgzf members starting at pos, verifying their crc
+   and length. The data is discarded, this is only the integrity check which
+   build_index() does as a side effect. Returns Z_OK, Z_DATA_ERROR or Z_ERRNO. */
+local int inflate_members(FILE *in, PX_off_t pos, int count)
+{
+    unsigned char input[65536];
+    unsigned char output[65536];
+    z_stream strm;
+    int ret = Z_OK;
+
+    strm.zalloc = Z_NULL;
+    strm.zfree = Z_NULL;
+    strm.opaque = Z_NULL;
+    strm.avail_in = 0;
+    strm.next_in = Z_NULL;
+    if (inflateInit2(&strm, 31) != Z_OK)    /* gzip only */
+        return Z_MEM_ERROR;
+
+    if (PX_fseeko(in, pos, SEEK_SET) != 0)
+        ret = Z_ERRNO;
+    while (ret == Z_OK && count--) {
+        unsigned char h[18];
+        unsigned size;
+        if (fread(h, 1, 18, in) != 18) {
+            ret = Z_ERRNO;
+            break;
+        }
+        size = (h[16] | (h[17] << 8)) + 1;
+        memcpy(input, h, 18);
+        if (size < 18 || fread(input + 18, 1, size - 18, in) != size - 18) {
+            ret = Z_ERRNO;
+            break;
+        }
+        strm.next_in = input;
+        strm.avail_in = size;
+        strm.next_out = output;
+        strm.avail_out = sizeof(output);
+        ret = inflate(&strm, Z_FINISH);
+        /* inflate checks the crc and the length of the member */
+        ret = (ret == Z_STREAM_END && strm.avail_in == 0) ? Z_OK : Z_DATA_ERROR;
+        inflateReset(&strm);
+    }
+
+    (void)inflateEnd(&strm);
+    return ret;
+}
+
 typedef struct zstate {
     PX_off_t out_offset;
     PX_off_t in_offset;
@@ -371,10 +502,7 @@ local int extract(FILE *in, struct access *index, PX_off_t offset,
         skip = 1;
     } else {
         /* find where in stream to start */
-        here = index->list;
-        ret = index->have;
-        while (--ret && here[1].out <= offset)
-            here++;
+        here = index->list + find_point(index, offset);
 
         /* initialize file and inflate state to start there */
         state->strm.zalloc = Z_NULL;
@@ -444,8 +572,17 @@ local int extract(FILE *in, struct access *index, PX_off_t offset,
                 ret = Z_DATA_ERROR;
             if (ret == Z_MEM_ERROR || ret == Z_DATA_ERROR)
                 goto extract_ret;
-            if (ret == Z_STREAM_END)
-                break;
+            if (ret == Z_STREAM_END) {
+                /* continue with the next gzip member, if any */
+                PX_off_t next = next_member(in, state->in_offset);
+                if (next < 0)
+                    break;
+                PX_fseeko(in, next, SEEK_SET);
+                state->in_offset = next;
+                state->strm.avail_in = 0;
+                inflateReset(&state->strm);
+                ret = Z_OK;
+            }
         } while (state->strm.avail_out != 0);
 
         /* if reach end of stream, then don't keep trying to get more */
@@ -0,0 +1,159 @@
+/*  PCSX2 - PS2 Emulator for PCs
+*  Copyright (C) 2002-2014  PCSX2 Dev Team
+*
+*  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+*  of the GNU Lesser General Public License as published by the Free Software Found-
+*  ation, either version 3 of the License, or (at your option) any later version.
+*
+*  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+*  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+*  PURPOSE.  See the GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License along with PCSX2.
+*  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// Seek table of the zstd "seekable format", as defined in
+// https://github.com/facebook/zstd/blob/dev/contrib/seekable_format/zstd_seekable_compression_format.md
+//
+// The image is a sequence of independent zstd frames, followed by a skippable frame
+// holding the compressed and decompressed size of every frame. Any zstd decoder can
+// decompress the whole file, but with the table a sector can be decompressed from its
+// frame alone. This header has no dependency on libzstd (nor on wx), so that the
+// isozstd tool can share it.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+
+#include "CompressedFileReaderUtils.h"
+
+#define ZSTD_SEEKABLE_MAGIC        0x8F92EAB1
+#define ZSTD_SKIPPABLE_MAGIC       0x184D2A5E
+#define ZSTD_SEEKABLE_FOOTER_SIZE  9
+#define ZSTD_SEEKABLE_MAX_FRAMES   0x8000000U
+
+struct ZstdSeekTable
+{
+	// frames + 1 entries, the last one being the end of the data.
+	std::vector<PX_off_t> in;  // offset of each frame in the file
+	std::vector<PX_off_t> out; // offset of each frame in the decompressed image
+	u32 maxFrameSize;          // largest decompressed frame
+	u32 maxCompressedSize;     // largest compressed frame
+
+	ZstdSeekTable() : maxFrameSize(0), maxCompressedSize(0) {}
+
+	int Frames() const { return (int)out.size() - 1; }
+	PX_off_t UncompressedSize() const { return out.empty() ? 0 : out.back(); }
+
+	// Frame which contains offset (offset must be < UncompressedSize())
+	int FindFrame(PX_off_t offset) const
+	{
+		int lo = 0, hi = Frames() - 1;
+		while (lo < hi) {
+			int mid = (lo + hi + 1) / 2;
+			if (out[mid] <= offset)
+				lo = mid;
+			else
+				hi = mid - 1;
+		}
+		return lo;
+	}
+
+	void Clear()
+	{
+		in.clear();
+		out.clear();
+		maxFrameSize = maxCompressedSize = 0;
+	}
+
+	// Frame sizes as written by the compressor
+	void Add(u32 compressedSize, u32 decompressedSize)
+	{
+		if (in.empty()) {
+			in.push_back(0);
+			out.push_back(0);
+		}
+		in.push_back(in.back() + compressedSize);
+		out.push_back(out.back() + decompressedSize);
+		maxFrameSize = std::max(maxFrameSize, decompressedSize);
+		maxCompressedSize = std::max(maxCompressedSize, compressedSize);
+	}
+};
+
+static inline u32 ZstdSeekableRead32(const u8* p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((u32)p[3] << 24);
+}
+
+static inline void ZstdSeekableWrite32(u8* p, u32 v)
+{
+	p[0] = (u8)v;
+	p[1] = (u8)(v >> 8);
+	p[2] = (u8)(v >> 16);
+	p[3] = (u8)(v >> 24);
+}
+
+// Returns false if the file doesn't end with a valid seek table.
+static bool ZstdSeekableReadTable(FILE* in, ZstdSeekTable& table)
+{
+	u8 footer[ZSTD_SEEKABLE_FOOTER_SIZE];
+
+	table.Clear();
+	if (PX_fseeko(in, -ZSTD_SEEKABLE_FOOTER_SIZE, SEEK_END) != 0)
+		return false;
+	const PX_off_t footerPos = PX_ftello(in);
+	if (fread(footer, 1, sizeof(footer), in) != sizeof(footer))
+		return false;
+	if (ZstdSeekableRead32(footer + 5) != ZSTD_SEEKABLE_MAGIC)
+		return false;
+
+	const u32 frames = ZstdSeekableRead32(footer);
+	const u8 descriptor = footer[4];
+	if (frames > ZSTD_SEEKABLE_MAX_FRAMES || (descriptor & 0x7C) != 0)
+		return false; // reserved bits must be zero
+	const u32 entrySize = (descriptor & 0x80) ? 12 : 8;
+
+	// The table is the content of a skippable frame: magic, size, entries, footer.
+	const PX_off_t tableSize = (PX_off_t)frames * entrySize + ZSTD_SEEKABLE_FOOTER_SIZE;
+	const PX_off_t framePos = footerPos + ZSTD_SEEKABLE_FOOTER_SIZE - tableSize - 8;
+	if (framePos < 0 || PX_fseeko(in, framePos, SEEK_SET) != 0)
+		return false;
+
+	std::vector<u8> buf((size_t)(tableSize + 8 - ZSTD_SEEKABLE_FOOTER_SIZE));
+	if (fread(buf.data(), 1, buf.size(), in) != buf.size())
+		return false;
+	if (ZstdSeekableRead32(&buf[0]) != ZSTD_SKIPPABLE_MAGIC || ZstdSeekableRead32(&buf[4]) != tableSize)
+		return false;
+
+	for (u32 i = 0; i < frames; i++) {
+		const u8* entry = &buf[8 + i * entrySize];
+		table.Add(ZstdSeekableRead32(entry), ZstdSeekableRead32(entry + 4));
+	}
+
+	// The frames must exactly fill the file up to the table.
+	return frames > 0 && table.in.back() == framePos;
+}
+
+// Appends the seek table (without checksums) for the frames written so far.
+static bool ZstdSeekableWriteTable(FILE* out, const ZstdSeekTable& table)
+{
+	const u32 frames = table.Frames();
+	std::vector<u8> buf(8 + frames * 8 + ZSTD_SEEKABLE_FOOTER_SIZE);
+
+	ZstdSeekableWrite32(&buf[0], ZSTD_SKIPPABLE_MAGIC);
+	ZstdSeekableWrite32(&buf[4], (u32)(buf.size() - 8));
+	for (u32 i = 0; i < frames; i++) {
+		ZstdSeekableWrite32(&buf[8 + i * 8], (u32)(table.in[i + 1] - table.in[i]));
+		ZstdSeekableWrite32(&buf[12 + i * 8], (u32)(table.out[i + 1] - table.out[i]));
+	}
+	u8* footer = &buf[8 + frames * 8];
+	ZstdSeekableWrite32(footer, frames);
+	footer[4] = 0;
+	ZstdSeekableWrite32(footer + 5, ZSTD_SEEKABLE_MAGIC);
+
+	return fwrite(buf.data(), 1, buf.size(), out) == buf.size();
+}
@@ -198,7 +198,8 @@ struct Pcsx2Config
 				RecBlocks_EE:1,		// Enables per-block profiling for the EE recompiler [unimplemented]
 				RecBlocks_IOP:1,	// Enables per-block profiling for the IOP recompiler [unimplemented]
 				RecBlocks_VU0:1,	// Enables per-block profiling for the VU0 recompiler [unimplemented]
-				RecBlocks_VU1:1;	// Enables per-block profiling for the VU1 recompiler [unimplemented]
+				RecBlocks_VU1:1,	// Enables per-block profiling for the VU1 recompiler [unimplemented]
+				SlowMem_EE:1;		// Counts the EE memory accesses which go through the vtlb handlers, by physical page and pc
 		BITFIELD_END
 
 		// Default is Disabled, with all recs enabled underneath.
@@ -216,6 +217,30 @@ struct Pcsx2Config
 		}
 	};
 
+	// ------------------------------------------------------------------------
+	struct RewindOptions
+	{
+		bool	Enabled;
+		int		FrameInterval;	// vsyncs between two snapshots of the VM
+		int		BufferSizeMB;	// memory for the snapshot history (the oldest are dropped)
+
+		RewindOptions();
+		void LoadSave( IniInterface& conf );
+
+		bool operator ==( const RewindOptions& right ) const
+		{
+			return
+				OpEqu( Enabled )		&&
+				OpEqu( FrameInterval )	&&
+				OpEqu( BufferSizeMB );
+		}
+
+		bool operator !=( const RewindOptions& right ) const
+		{
+			return !this->operator ==( right );
+		}
+	};
+
 	// ------------------------------------------------------------------------
 	struct RecompilerOptions
 	{
@@ -246,7 +271,9 @@ struct Pcsx2Config
 				PreBlockCheckEE	:1,
 				PreBlockCheckIOP:1;
 			bool
-				EnableEECache   :1;
+				EnableEECache   :1,
+				EnableEEBlockProfile:1,	// save the blocks compiled by the EE rec, and compile them at the next boot of the game
+				EnableVifProfile:1;		// same for the VIF unpacks, and report the most used ones
 		BITFIELD_END
 
 		RecompilerOptions();
@@ -297,6 +324,12 @@ struct Pcsx2Config
 		bool	SynchronousMTGS;
 
 		int		VsyncQueueSize;
+		int		RingBufferSizeFactor;	// MTGS ring buffer of 2^n 16-byte entries (16 to 20), read at startup
+
+		// Waits of the EE, MTGS and MTVU threads on each other spin (pause) up to
+		// SpinWaitCount times, then yield up to SpinWaitYields timeslices, then sleep.
+		int		SpinWaitCount;
+		int		SpinWaitYields;
 
 		bool		FrameLimitEnable;
 		bool		FrameSkipEnable;
@@ -319,6 +352,9 @@ struct Pcsx2Config
 			return
 				OpEqu( SynchronousMTGS )		&&
 				OpEqu( VsyncQueueSize )			&&
+				OpEqu( RingBufferSizeFactor )	&&
+				OpEqu( SpinWaitCount )			&&
+				OpEqu( SpinWaitYields )			&&
 				
 				OpEqu( FrameSkipEnable )		&&
 				OpEqu( FrameLimitEnable )		&&
@@ -451,12 +487,15 @@ struct Pcsx2Config
 			CdvdVerboseReads	:1,		// enables cdvd read activity verbosely dumped to the console
 			CdvdDumpBlocks		:1,		// enables cdvd block dumping
 			CdvdShareWrite		:1,		// allows the iso to be modified while it's loaded
+			CdvdDirectIO		:1,		// reads uncompressed isos without the OS page cache (Linux only)
 			EnablePatches		:1,		// enables patch detection and application
 			EnableCheats		:1,		// enables cheat detection and application
 			EnableWideScreenPatches		:1,
 		// when enabled uses BOOT2 injection, skipping sony bios splashes
 			UseBOOT2Injection	:1,
 			BackupSavestate		:1,
+		// compresses savestates with zstd on all cores (needs zstd support, deflate otherwise)
+			SavestateZstd		:1,
 		// enables simulated ejection of memory cards when loading savestates
 			McdEnableEjection	:1,
 			McdFolderAutoManage	:1,
@@ -473,6 +512,7 @@ struct Pcsx2Config
 	SpeedhackOptions	Speedhacks;
 	GamefixOptions		Gamefixes;
 	ProfilerOptions		Profiler;
+	RewindOptions		Rewind;
 	DebugOptions		Debugger;
 
 	TraceLogFilters		Trace;
@@ -498,6 +538,7 @@ struct Pcsx2Config
 			OpEqu( Speedhacks )	&&
 			OpEqu( Gamefixes )	&&
 			OpEqu( Profiler )	&&
+			OpEqu( Rewind )		&&
 			OpEqu( Trace )		&&
 			OpEqu( BiosFilename );
 	}
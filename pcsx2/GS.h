@@ -304,6 +304,30 @@ struct MTGS_FreezeData
 	s32			retval;		// value returned from the call, valid only after an mtgsWaitGS()
 };
 
+// Telemetry of the MTGS ring buffer. The occupancy is sampled on each packet sent to the
+// ring, the EE stall and GS idle times are accumulated per frame (vsync). A GS-bound game
+// shows EE stalls and a full ring, an EE-bound one an idle GS and an empty ring.
+struct MTGS_RingStats
+{
+	static const int Buckets = 8;
+
+	u64 occupancy[Buckets];	// packets sent while the ring was [n/8, (n+1)/8) full
+	u64 eeStall[Buckets];	// frames by EE stall time: none, <0.25ms, <0.5ms, <1ms ... <8ms, more
+	u64 gsIdle[Buckets];	// frames by GS idle time (same buckets)
+	u64 stalls;				// EE stalls on a full ring
+	u64 stallTicks;			// EE stall time, in GetCPUTicks() units
+	u64 idleTicks;			// GS idle time, in GetCPUTicks() units
+	u64 frames;
+
+	MTGS_RingStats() { Reset(); }
+	void Reset() { memzero(*this); }
+
+	// Stats gathered since prev (a previous copy of the same stats)
+	MTGS_RingStats Since(const MTGS_RingStats& prev) const;
+	static int TimeBucket(u64 ticks);
+	double OccupancyAvg() const;
+};
+
 // --------------------------------------------------------------------------------------
 //  SysMtgsThread
 // --------------------------------------------------------------------------------------
@@ -327,7 +351,18 @@ public:
 	Mutex			m_mtx_RingBufferBusy;  // Is obtained while processing ring-buffer data
 	Mutex			m_mtx_RingBufferBusy2; // This one gets released on semaXGkick waiting...
 	Mutex			m_mtx_WaitGS;
-	Semaphore		m_sem_OnRingReset;
+	SpinWaitPolicy	m_EventWait;		// MTGS thread waiting on m_sem_event
+	SpinSemaphore	m_sem_OnRingReset;
+
+	// Ring telemetry: m_RingStats and m_FrameStallTicks are only updated by the EE
+	// thread, m_IdleTicks by the MTGS thread. Other threads read the copy published
+	// in m_RingStatsShared once per frame, under m_mtx_RingStats.
+	MTGS_RingStats		m_RingStats;
+	MTGS_RingStats		m_RingStatsShared;
+	Mutex				m_mtx_RingStats;
+	u64					m_FrameStallTicks;
+	u64					m_FrameIdleStart;
+	std::atomic<u64>	m_IdleTicks;
 	Semaphore		m_sem_Vsync;
 
 	// used to keep multiple threads from sending packets to the ringbuffer concurrently.
@@ -375,6 +410,9 @@ public:
 	void SetEvent();
 	void PostVsyncStart();
 
+	void GetRingStats( MTGS_RingStats& dest ) const;
+	void PrintRingStats();
+
 	bool IsPluginOpened() const { return m_PluginOpened; }
 
 protected:
@@ -390,6 +428,9 @@ protected:
 	void OnCleanupInThread();
 
 	void GenericStall( uint size );
+	void RecordRingFrame();
+	void ResetRingStats();
+	void PublishRingStats();
 
 	// Used internally by SendSimplePacket type functions
 	void _FinishSimplePacket();
@@ -457,24 +498,28 @@ extern int g_nLeftGSFrames;
 #endif
 
 // Size of the ringbuffer as a power of 2 -- size is a multiple of simd128s.
-// (actual size is 1<<m_RingBufferSizeFactor simd vectors [128-bit values])
+// (actual size is 1<<RingBufferSizeFactor simd vectors [128-bit values])
 // A value of 19 is a 8meg ring buffer.  18 would be 4 megs, and 20 would be 16 megs.
 // Default was 2mb, but some games with lots of MTGS activity want 8mb to run fast (rama)
-static const uint RingBufferSizeFactor = 19;
+// The factor comes from GSOptions::RingBufferSizeFactor when the MTGS thread starts.
+static const uint RingBufferSizeFactorMin = 16;
+static const uint RingBufferSizeFactorMax = 20;
+static const uint RingBufferSizeMax = 1<<RingBufferSizeFactorMax;
+extern uint RingBufferSizeFactor;
 
 // size of the ringbuffer in simd128's.
-static const uint RingBufferSize = 1<<RingBufferSizeFactor;
+extern uint RingBufferSize;
 
 // Mask to apply to ring buffer indices to wrap the pointer from end to
 // start (the wrapping is what makes it a ringbuffer, yo!)
-static const uint RingBufferMask = RingBufferSize - 1;
+extern uint RingBufferMask;
 
 struct MTGS_BufferedData
 {
-	u128		m_Ring[RingBufferSize];
+	u128*		m_Ring;
 	u8			Regs[Ps2MemSize::GSregs];
 
-	MTGS_BufferedData() {}
+	MTGS_BufferedData() : m_Ring(NULL) {}
 
 	u128& operator[]( uint idx )
 	{
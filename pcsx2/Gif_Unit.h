@@ -158,11 +158,12 @@ struct Gif_Path_MTVU {
 	GS_Packet fakePacket;
 	// Set a size based on MTGS but keep a factor 2 to avoid too waste to much
 	// memory overhead. Note the struct is instantied 3 times (for each gif
-	// path)
-	ringbuffer_base<GS_Packet, RingBufferSize / 2> gsPackQueue;
+	// path). The queue follows the ring size picked at runtime, a smaller
+	// queue only makes push() wait on the MTGS sooner.
+	ringbuffer_base<GS_Packet, RingBufferSizeMax / 2> gsPackQueue;
 	Gif_Path_MTVU() { Reset(); }
 	void Reset()    { fakePackets = 0;
-		gsPackQueue.reset();
+		gsPackQueue.resize(RingBufferSize / 2);
 		fakePacket.Reset();
 		fakePacket.size =~0u; // Used to indicate that its a fake packet
 	}
@@ -15,12 +15,14 @@
 
 #include "PrecompiledHeader.h"
 #include "AsyncFileReader.h"
+#include "LnxIoUring.h"
 
-FlatFileReader::FlatFileReader(bool shareWrite) : shareWrite(shareWrite)
+FlatFileReader::FlatFileReader(bool shareWrite, bool directIO) : shareWrite(shareWrite), directIO(directIO)
 {
 	m_blocksize = 2048;
 	m_fd = -1;
 	m_aio_context = 0;
+	m_uring = NULL;
 }
 
 FlatFileReader::~FlatFileReader(void)
@@ -32,12 +34,37 @@ bool FlatFileReader::Open(const wxString& fileName)
 {
 	m_filename = fileName;
 
+	// O_DIRECT needs aligned reads, which only the io_uring backend takes care of.
+	bool direct = directIO;
+	if (direct)
+		m_fd = wxOpen(fileName, O_RDONLY | O_DIRECT, 0);
+	if (m_fd == -1) {
+		direct = false;
+		m_fd = wxOpen(fileName, O_RDONLY, 0);
+	}
+	if (m_fd == -1)
+		return false;
+
+	m_uring = new IoUringFileReader();
+	if (m_uring->Open(m_fd, direct)) {
+		DevCon.WriteLn(L"CDVD: io_uring reads%s", direct ? L" (direct I/O)" : L"");
+		return true;
+	}
+
+	delete m_uring;
+	m_uring = NULL;
+	if (direct) {
+		// reopen without O_DIRECT for libaio
+		close(m_fd);
+		m_fd = wxOpen(fileName, O_RDONLY, 0);
+		if (m_fd == -1)
+			return false;
+	}
+
 	int err = io_setup(64, &m_aio_context);
 	if (err) return false;
 
-    m_fd = wxOpen(fileName, O_RDONLY, 0);
-
-	return (m_fd != -1);
+	return true;
 }
 
 int FlatFileReader::ReadSync(void* pBuffer, uint sector, uint count)
@@ -53,6 +80,11 @@ void FlatFileReader::BeginRead(void* pBuffer, uint sector, uint count)
 
 	u32 bytesToRead = count * m_blocksize;
 
+	if (m_uring) {
+		m_uring->BeginRead(pBuffer, offset, bytesToRead);
+		return;
+	}
+
 	struct iocb iocb;
 	struct iocb* iocbs = &iocb;
 
@@ -62,6 +94,9 @@ void FlatFileReader::BeginRead(void* pBuffer, uint sector, uint count)
 
 int FlatFileReader::FinishRead(void)
 {
+	if (m_uring)
+		return m_uring->FinishRead();
+
 	int min_nr = 1;
 	int max_nr = 1;
 	struct io_event events[max_nr];
@@ -76,6 +111,11 @@ int FlatFileReader::FinishRead(void)
 
 void FlatFileReader::CancelRead(void)
 {
+	if (m_uring) {
+		m_uring->Cancel();
+		return;
+	}
+
 	// Will be done when m_aio_context context is destroyed
 	// Note: io_cancel exists but need the iocb structure as parameter
 	// int io_cancel(aio_context_t ctx_id, struct iocb *iocb,
@@ -84,10 +124,14 @@ void FlatFileReader::CancelRead(void)
 
 void FlatFileReader::Close(void)
 {
+	if (m_uring) {
+		delete m_uring; // waits for the reads in flight
+		m_uring = NULL;
+	}
 
 	if (m_fd != -1) close(m_fd);
 
-	io_destroy(m_aio_context);
+	if (m_aio_context) io_destroy(m_aio_context);
 
 	m_fd = -1;
 	m_aio_context = 0;
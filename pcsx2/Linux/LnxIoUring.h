@@ -0,0 +1,373 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2002-2014  PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// io_uring backend of the Linux FlatFileReader.
+//
+// The syscalls are used directly (the kernel header is enough), so there's no liburing
+// dependency and the reader simply falls back to libaio when the kernel (< 5.1), or a
+// seccomp/container policy, doesn't allow io_uring.
+
+#if defined(__has_include) && !__has_include(<linux/io_uring.h>)
+
+// Kernel headers older than 5.1, libaio only.
+class IoUringFileReader
+{
+public:
+	bool Open(int fd, bool direct) { return false; }
+	void BeginRead(void* dest, u64 offset, u32 bytes) {}
+	int FinishRead() { return -1; }
+	void Cancel() {}
+};
+
+#else
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+
+#ifndef IORING_FEAT_SINGLE_MMAP
+#define IORING_FEAT_SINGLE_MMAP (1U << 0)
+#endif
+
+// Single threaded ring: the submission and completion queues are only ever used by
+// the thread which owns the reader.
+class IoUring
+{
+	int m_fd;
+	void* m_sqMap;
+	void* m_cqMap;
+	size_t m_sqMapSize;
+	size_t m_cqMapSize;
+	io_uring_sqe* m_sqes;
+	size_t m_sqesSize;
+
+	unsigned* m_sqHead;
+	unsigned* m_sqTail;
+	unsigned* m_sqMask;
+	unsigned* m_sqArray;
+	unsigned m_sqEntries;
+	unsigned m_sqeTail;     // next sqe handed out by GetSqe
+	unsigned m_sqeSubmitted;
+
+	unsigned* m_cqHead;
+	unsigned* m_cqTail;
+	unsigned* m_cqMask;
+	io_uring_cqe* m_cqes;
+
+	static unsigned Load(unsigned* p) { return reinterpret_cast<std::atomic<unsigned>*>(p)->load(std::memory_order_acquire); }
+	static void Store(unsigned* p, unsigned v) { reinterpret_cast<std::atomic<unsigned>*>(p)->store(v, std::memory_order_release); }
+
+	int Enter(unsigned toSubmit, unsigned minComplete, unsigned flags)
+	{
+		int ret;
+		do {
+			ret = syscall(__NR_io_uring_enter, m_fd, toSubmit, minComplete, flags, NULL, 0);
+		} while (ret < 0 && errno == EINTR);
+		return ret;
+	}
+
+public:
+	IoUring()
+		: m_fd(-1), m_sqMap(MAP_FAILED), m_cqMap(MAP_FAILED), m_sqMapSize(0), m_cqMapSize(0)
+		, m_sqes((io_uring_sqe*)MAP_FAILED), m_sqesSize(0), m_sqeTail(0), m_sqeSubmitted(0)
+	{
+	}
+
+	~IoUring() { Destroy(); }
+
+	bool Create(unsigned entries)
+	{
+		io_uring_params p;
+		memset(&p, 0, sizeof(p));
+		m_fd = syscall(__NR_io_uring_setup, entries, &p);
+		if (m_fd < 0)
+			return false;
+
+		m_sqMapSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+		m_cqMapSize = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+		if (p.features & IORING_FEAT_SINGLE_MMAP)
+			m_sqMapSize = m_cqMapSize = std::max(m_sqMapSize, m_cqMapSize);
+
+		m_sqMap = mmap(NULL, m_sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+		if (m_sqMap == MAP_FAILED) {
+			Destroy();
+			return false;
+		}
+		if (p.features & IORING_FEAT_SINGLE_MMAP) {
+			m_cqMap = m_sqMap;
+		} else {
+			m_cqMap = mmap(NULL, m_cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+			if (m_cqMap == MAP_FAILED) {
+				Destroy();
+				return false;
+			}
+		}
+		m_sqesSize = p.sq_entries * sizeof(io_uring_sqe);
+		m_sqes = (io_uring_sqe*)mmap(NULL, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES);
+		if (m_sqes == MAP_FAILED) {
+			Destroy();
+			return false;
+		}
+
+		u8* sq = (u8*)m_sqMap;
+		m_sqHead = (unsigned*)(sq + p.sq_off.head);
+		m_sqTail = (unsigned*)(sq + p.sq_off.tail);
+		m_sqMask = (unsigned*)(sq + p.sq_off.ring_mask);
+		m_sqArray = (unsigned*)(sq + p.sq_off.array);
+		m_sqEntries = p.sq_entries;
+		m_sqeTail = m_sqeSubmitted = *m_sqTail;
+
+		u8* cq = (u8*)m_cqMap;
+		m_cqHead = (unsigned*)(cq + p.cq_off.head);
+		m_cqTail = (unsigned*)(cq + p.cq_off.tail);
+		m_cqMask = (unsigned*)(cq + p.cq_off.ring_mask);
+		m_cqes = (io_uring_cqe*)(cq + p.cq_off.cqes);
+		return true;
+	}
+
+	void Destroy()
+	{
+		if (m_sqes != MAP_FAILED)
+			munmap(m_sqes, m_sqesSize);
+		if (m_cqMap != MAP_FAILED && m_cqMap != m_sqMap)
+			munmap(m_cqMap, m_cqMapSize);
+		if (m_sqMap != MAP_FAILED)
+			munmap(m_sqMap, m_sqMapSize);
+		if (m_fd >= 0)
+			close(m_fd);
+
+		m_fd = -1;
+		m_sqMap = m_cqMap = MAP_FAILED;
+		m_sqes = (io_uring_sqe*)MAP_FAILED;
+	}
+
+	// Pins the buffer once, instead of for every request.
+	bool RegisterBuffer(void* buffer, size_t size)
+	{
+		iovec iov = {buffer, size};
+		return syscall(__NR_io_uring_register, m_fd, IORING_REGISTER_BUFFERS, &iov, 1) == 0;
+	}
+
+	io_uring_sqe* GetSqe()
+	{
+		if (m_sqeTail - Load(m_sqHead) >= m_sqEntries)
+			return NULL;
+
+		unsigned index = m_sqeTail & *m_sqMask;
+		m_sqArray[index] = index;
+		m_sqeTail++;
+
+		io_uring_sqe* sqe = &m_sqes[index];
+		memset(sqe, 0, sizeof(*sqe));
+		return sqe;
+	}
+
+	// Submits everything queued since the last call, and returns how many entries the
+	// kernel took. It only takes less on an error, and the rest is then dropped, so that
+	// a later submit doesn't send stale entries.
+	unsigned Submit()
+	{
+		const unsigned count = m_sqeTail - m_sqeSubmitted;
+		unsigned submitted = 0;
+
+		Store(m_sqTail, m_sqeTail);
+		while (submitted < count) {
+			int ret = Enter(count - submitted, 0, 0);
+			if (ret <= 0)
+				break;
+			submitted += ret;
+		}
+
+		if (submitted < count) {
+			// The kernel only reads the queue in io_uring_enter, it's safe to take it back.
+			m_sqeTail = m_sqeSubmitted + submitted;
+			Store(m_sqTail, m_sqeTail);
+		}
+		m_sqeSubmitted = m_sqeTail;
+		return submitted;
+	}
+
+	// Blocks until a completion is available. Must be followed by CqeSeen().
+	io_uring_cqe* WaitCqe()
+	{
+		while (true) {
+			unsigned head = *m_cqHead;
+			if (head != Load(m_cqTail))
+				return &m_cqes[head & *m_cqMask];
+			if (Enter(0, 1, IORING_ENTER_GETEVENTS) < 0)
+				return NULL;
+		}
+	}
+
+	void CqeSeen() { Store(m_cqHead, *m_cqHead + 1); }
+};
+
+// Reads through a registered bounce buffer. With O_DIRECT it also takes care of the
+// alignment, which the CDVD requests (2048/2352/2448 bytes sectors at any offset)
+// generally don't have. A request is split into chunks which are all submitted at
+// once, so with direct I/O the device sees the whole request as parallel reads.
+class IoUringFileReader
+{
+	static const u32 BufferSize = 1024 * 1024; // > MaxReadUnit raw sectors
+	static const u32 ChunkSize = 64 * 1024;
+	static const u32 Alignment = 4096;
+
+	IoUring m_ring;
+	int m_fd;
+	bool m_direct;
+	u8* m_buffer;
+
+	// Current request
+	u8* m_dest;
+	u64 m_offset;
+	u32 m_bytes;
+	u32 m_done;        // bytes already copied to m_dest
+	u64 m_window;      // file offset of the start of the buffer
+	u32 m_windowSize;  // bytes requested into the buffer
+	u32 m_available;   // valid bytes in the buffer, once the chunks completed
+	u32 m_inflight;    // submitted chunks, not reaped yet
+	bool m_error;
+
+	void SubmitWindow()
+	{
+		const u64 start = m_offset + m_done;
+		const u64 end = m_offset + m_bytes;
+		m_window = m_direct ? start & ~(u64)(Alignment - 1) : start;
+		u64 windowEnd = m_direct ? (end + Alignment - 1) & ~(u64)(Alignment - 1) : end;
+		windowEnd = std::min<u64>(windowEnd, m_window + BufferSize);
+
+		m_windowSize = m_available = (u32)(windowEnd - m_window);
+		u32 queued = 0;
+		for (u32 pos = 0; pos < m_windowSize; pos += ChunkSize) {
+			io_uring_sqe* sqe = m_ring.GetSqe();
+			sqe->opcode = IORING_OP_READ_FIXED;
+			sqe->fd = m_fd;
+			sqe->off = m_window + pos;
+			sqe->addr = (u64)(uptr)(m_buffer + pos);
+			sqe->len = std::min<u32>(ChunkSize, m_windowSize - pos);
+			sqe->buf_index = 0;
+			sqe->user_data = pos;
+			queued++;
+		}
+
+		// Only the chunks the kernel took will complete, the window is lost anyway if
+		// one of them is missing.
+		const u32 submitted = m_ring.Submit();
+		if (submitted < queued)
+			m_error = true;
+		m_inflight += submitted;
+	}
+
+	// Reaps the chunks of the current window, m_available is then the amount of valid data.
+	void WaitWindow()
+	{
+		while (m_inflight) {
+			io_uring_cqe* cqe = m_ring.WaitCqe();
+			if (!cqe) {
+				// Can't happen unless the ring is broken, in which case nothing will complete.
+				m_error = true;
+				m_inflight = 0;
+				break;
+			}
+
+			const u32 pos = (u32)cqe->user_data;
+			const u32 len = std::min<u32>(ChunkSize, m_windowSize - pos);
+			if (cqe->res < 0)
+				m_error = true;
+			else if ((u32)cqe->res < len) // end of file
+				m_available = std::min<u32>(m_available, pos + cqe->res);
+			m_ring.CqeSeen();
+			m_inflight--;
+		}
+	}
+
+public:
+	IoUringFileReader() : m_fd(-1), m_direct(false), m_buffer(NULL), m_inflight(0) {}
+	~IoUringFileReader() { Close(); }
+
+	bool Open(int fd, bool direct)
+	{
+		if (posix_memalign((void**)&m_buffer, Alignment, BufferSize) != 0) {
+			m_buffer = NULL;
+			return false;
+		}
+		if (!m_ring.Create(BufferSize / ChunkSize) || !m_ring.RegisterBuffer(m_buffer, BufferSize)) {
+			Close();
+			return false;
+		}
+		m_fd = fd;
+		m_direct = direct;
+		return true;
+	}
+
+	void Close()
+	{
+		Cancel();
+		m_ring.Destroy();
+		free(m_buffer);
+		m_buffer = NULL;
+		m_fd = -1;
+	}
+
+	void BeginRead(void* dest, u64 offset, u32 bytes)
+	{
+		m_dest = (u8*)dest;
+		m_offset = offset;
+		m_bytes = bytes;
+		m_done = 0;
+		m_error = false;
+		SubmitWindow();
+	}
+
+	// Returns the number of bytes read, or -1
+	int FinishRead()
+	{
+		while (true) {
+			WaitWindow();
+			if (m_error)
+				return -1;
+
+			const u64 start = m_offset + m_done;
+			const u32 skip = (u32)(start - m_window);
+			const u32 copy = std::min<u32>(m_bytes - m_done, m_available > skip ? m_available - skip : 0);
+			memcpy(m_dest + m_done, m_buffer + skip, copy);
+			m_done += copy;
+
+			// Requests bigger than the buffer (much larger than what InputIsoFile asks
+			// for) take several round trips. A short window means the end of the file.
+			if (m_done == m_bytes || m_available < m_windowSize)
+				return m_done;
+			SubmitWindow();
+		}
+	}
+
+	// The kernel may still write to the buffer, so the reads must complete before
+	// the buffer is reused or freed.
+	void Cancel()
+	{
+		WaitWindow();
+	}
+};
+
+#endif
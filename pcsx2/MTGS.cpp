@@ -41,6 +41,9 @@ using namespace Threading;
 // =====================================================================================================
 
 __aligned(32) MTGS_BufferedData RingBuffer;
+uint RingBufferSizeFactor	= 19;
+uint RingBufferSize			= 1 << 19;
+uint RingBufferMask			= RingBufferSize - 1;
 extern bool renderswitch;
 
 
@@ -77,6 +80,25 @@ void SysMtgsThread::OnStart()
 
 	m_CopyDataTally		= 0;
 
+	ResetRingStats();
+	m_FrameStallTicks	= 0;
+	m_FrameIdleStart	= 0;
+	m_IdleTicks			= 0;
+
+	// The ring is empty until the thread runs, so it can be resized here
+	const uint factor = std::min(std::max((uint)EmuConfig.GS.RingBufferSizeFactor, RingBufferSizeFactorMin), RingBufferSizeFactorMax);
+	if (!RingBuffer.m_Ring || factor != RingBufferSizeFactor)
+	{
+		safe_aligned_free(RingBuffer.m_Ring);
+		RingBufferSizeFactor	= factor;
+		RingBufferSize			= 1 << factor;
+		RingBufferMask			= RingBufferSize - 1;
+		RingBuffer.m_Ring		= (u128*)_aligned_malloc(RingBufferSize * sizeof(u128), 32);
+		if (!RingBuffer.m_Ring)
+			throw Exception::OutOfMemory(L"MTGS ring buffer");
+		DevCon.WriteLn(L"MTGS ring buffer: %u KB", (RingBufferSize * sizeof(u128)) / _1kb);
+	}
+
 	_parent::OnStart();
 }
 
@@ -86,6 +108,8 @@ SysMtgsThread::~SysMtgsThread()
 		_parent::Cancel();
 	}
 	DESTRUCTOR_CATCHALL
+
+	safe_aligned_free(RingBuffer.m_Ring);
 }
 
 void SysMtgsThread::OnResumeReady()
@@ -122,6 +146,8 @@ struct RingCmdPacket_Vsync
 
 void SysMtgsThread::PostVsyncStart()
 {
+	RecordRingFrame();
+
 	// Optimization note: Typically regset1 isn't needed.  The regs in that area are typically
 	// changed infrequently, usually during video mode changes.  However, on modern systems the
 	// 256-byte copy is only a few dozen cycles -- executed 60 times a second -- so probably
@@ -162,6 +188,7 @@ void SysMtgsThread::PostVsyncStart()
 	// To avoid this potential deadlock, ring must be wake up after m_VsyncSignalListener
 	// Note: potentially we can also miss the previous wake up if we optimize away the post just before the release of busy signal of the ring
 	// So let's ensure the ring doesn't sleep
+	m_EventWait.Posted();
 	m_sem_event.Post();
 
 	m_sem_Vsync.WaitNoCancel();
@@ -205,6 +232,10 @@ void SysMtgsThread::OpenPlugin()
 
 	GSsetVsync(EmuConfig.GS.GetVsync());
 
+	m_EventWait.SetLimits(EmuConfig.GS.SpinWaitCount, EmuConfig.GS.SpinWaitYields);
+	m_sem_OnRingReset.policy.SetLimits(EmuConfig.GS.SpinWaitCount, EmuConfig.GS.SpinWaitYields);
+	vu1Thread.SetWaitLimits(EmuConfig.GS.SpinWaitCount, EmuConfig.GS.SpinWaitYields);
+
 	if( result != 0 )
 	{
 		DevCon.WriteLn( "GSopen Failed: return code: 0x%x", result );
@@ -289,7 +320,9 @@ void SysMtgsThread::ExecuteTaskInThread()
 		// is very optimized (only 1 instruction test in most cases), so no point in trying
 		// to avoid it.
 
-		m_sem_event.WaitWithoutYield();
+		const u64 idleStart = GetCPUTicks();
+		m_EventWait.WaitOn(m_sem_event);
+		m_IdleTicks.fetch_add(GetCPUTicks() - idleStart, std::memory_order_relaxed);
 		StateCheckInThread();
 		busy.Acquire();
 
@@ -570,6 +603,15 @@ void SysMtgsThread::ClosePlugin()
 	if( !m_PluginOpened ) return;
 	m_PluginOpened = false;
 	GetCorePlugins().Close( PluginId_GS );
+
+	PrintRingStats();
+	ResetRingStats();
+
+	m_EventWait.stats.Print(L"MTGS wait for EE");
+	m_sem_OnRingReset.policy.stats.Print(L"EE wait for MTGS ring space");
+	m_EventWait.stats.Reset();
+	m_sem_OnRingReset.policy.stats.Reset();
+	if (THREAD_VU1) vu1Thread.PrintWaitStats();
 }
 
 void SysMtgsThread::OnSuspendInThread()
@@ -639,8 +681,10 @@ void SysMtgsThread::WaitGS(bool syncRegs, bool weakWait, bool isMTVU)
 // For use in loops that wait on the GS thread to do certain things.
 void SysMtgsThread::SetEvent()
 {
-	if(!m_RingBufferIsBusy.load(std::memory_order_relaxed))
+	if(!m_RingBufferIsBusy.load(std::memory_order_relaxed)) {
+		m_EventWait.Posted();
 		m_sem_event.Post();
+	}
 
 	m_CopyDataTally = 0;
 }
@@ -665,6 +709,9 @@ void SysMtgsThread::SendDataPacket()
 
 	m_WritePos.store(m_packet_writepos, std::memory_order_release);
 
+	const uint used = (m_packet_writepos - m_ReadPos.load(std::memory_order_relaxed)) & RingBufferMask;
+	m_RingStats.occupancy[used >> (RingBufferSizeFactor - 3)]++;
+
 	if(EmuConfig.GS.SynchronousMTGS)
 	{
 		WaitGS();
@@ -714,6 +761,7 @@ void SysMtgsThread::GenericStall( uint size )
 		// the next packet will likely stall up too.  So lets set a condition for the MTGS
 		// thread to wake up the EE once there's a sizable chunk of the ringbuffer emptied.
 
+		const u64 stallStart = GetCPUTicks();
 		uint somedone	= (RingBufferSize - freeroom) / 4;
 		if( somedone < size+1 ) somedone = size + 1;
 
@@ -761,7 +809,126 @@ void SysMtgsThread::GenericStall( uint size )
 				if (freeroom > size) break;
 			}
 		}
+
+		const u64 stallTicks = GetCPUTicks() - stallStart;
+		m_RingStats.stalls++;
+		m_RingStats.stallTicks += stallTicks;
+		m_FrameStallTicks += stallTicks;
+	}
+}
+
+// --------------------------------------------------------------------------------------
+//  MTGS ring buffer telemetry
+// --------------------------------------------------------------------------------------
+
+MTGS_RingStats MTGS_RingStats::Since(const MTGS_RingStats& prev) const
+{
+	// The stats were reset in between (GS closed), no counter may go backwards
+	bool reset = frames < prev.frames || stalls < prev.stalls
+		|| stallTicks < prev.stallTicks || idleTicks < prev.idleTicks;
+	for (int i = 0; i < Buckets; i++)
+		reset |= occupancy[i] < prev.occupancy[i] || eeStall[i] < prev.eeStall[i] || gsIdle[i] < prev.gsIdle[i];
+	if (reset) return *this;
+
+	MTGS_RingStats delta;
+	for (int i = 0; i < Buckets; i++) {
+		delta.occupancy[i]	= occupancy[i] - prev.occupancy[i];
+		delta.eeStall[i]	= eeStall[i] - prev.eeStall[i];
+		delta.gsIdle[i]		= gsIdle[i] - prev.gsIdle[i];
+	}
+	delta.stalls		= stalls - prev.stalls;
+	delta.stallTicks	= stallTicks - prev.stallTicks;
+	delta.idleTicks		= idleTicks - prev.idleTicks;
+	delta.frames		= frames - prev.frames;
+	return delta;
+}
+
+int MTGS_RingStats::TimeBucket(u64 ticks)
+{
+	if (!ticks) return 0;
+
+	u64 quarters = ticks * 4000 / GetTickFrequency(); // in 0.25ms units
+	int bucket = 1;
+	while (quarters && bucket < Buckets - 1) {
+		quarters >>= 1;
+		bucket++;
+	}
+	return bucket;
+}
+
+double MTGS_RingStats::OccupancyAvg() const
+{
+	u64 packets = 0;
+	double sum = 0;
+	for (int i = 0; i < Buckets; i++) {
+		packets += occupancy[i];
+		sum += occupancy[i] * (i + 0.5) / Buckets;
+	}
+	return packets ? sum / packets : 0;
+}
+
+// Closes the telemetry of the current frame (EE thread)
+void SysMtgsThread::RecordRingFrame()
+{
+	const u64 idle = m_IdleTicks.load(std::memory_order_relaxed);
+	const u64 frameIdle = idle - m_FrameIdleStart;
+
+	m_RingStats.eeStall[MTGS_RingStats::TimeBucket(m_FrameStallTicks)]++;
+	m_RingStats.gsIdle[MTGS_RingStats::TimeBucket(frameIdle)]++;
+	m_RingStats.idleTicks += frameIdle;
+	m_RingStats.frames++;
+
+	m_FrameStallTicks = 0;
+	m_FrameIdleStart = idle;
+
+	PublishRingStats();
+}
+
+void SysMtgsThread::ResetRingStats()
+{
+	m_RingStats.Reset();
+	PublishRingStats();
+}
+
+// Copies the stats for the other threads, the EE thread keeps updating m_RingStats
+void SysMtgsThread::PublishRingStats()
+{
+	ScopedLock lock(m_mtx_RingStats);
+	m_RingStatsShared = m_RingStats;
+}
+
+void SysMtgsThread::GetRingStats(MTGS_RingStats& dest) const
+{
+	ScopedLock lock(m_mtx_RingStats);
+	dest = m_RingStatsShared;
+}
+
+void SysMtgsThread::PrintRingStats()
+{
+	const MTGS_RingStats& stats = m_RingStats;
+	if (!stats.frames) return;
+
+	const double ms = 1000.0 / GetTickFrequency();
+	Console.WriteLn(L"(MTGS) Ring of %u KB, %llu frames: ring %.1f%% full on average, EE stalled %llu times (%.2f ms/frame), GS idle %.2f ms/frame",
+		(RingBufferSize * sizeof(u128)) / _1kb, stats.frames, stats.OccupancyAvg() * 100,
+		stats.stalls, stats.stallTicks * ms / stats.frames, stats.idleTicks * ms / stats.frames);
+
+	static const wxChar* timeBuckets[MTGS_RingStats::Buckets] = {
+		L"0", L"<0.25ms", L"<0.5ms", L"<1ms", L"<2ms", L"<4ms", L"<8ms", L">=8ms"
+	};
+
+	u64 packets = 0;
+	for (u64 count : stats.occupancy) packets += count;
+
+	FastFormatUnicode occupancy, stall, idle;
+	for (int i = 0; i < MTGS_RingStats::Buckets; i++) {
+		occupancy.Write(L" %d/8:%.1f%%", i + 1, packets ? stats.occupancy[i] * 100.0 / packets : 0.0);
+		stall.Write(L" %s:%.1f%%", timeBuckets[i], stats.eeStall[i] * 100.0 / stats.frames);
+		idle.Write(L" %s:%.1f%%", timeBuckets[i], stats.gsIdle[i] * 100.0 / stats.frames);
 	}
+	Console.WriteLn(L"(MTGS)   occupancy (packets) %s", occupancy.c_str());
+	Console.WriteLn(L"(MTGS)   EE stall (frames)   %s", stall.c_str());
+	Console.WriteLn(L"(MTGS)   GS idle (frames)    %s", idle.c_str());
 }
 
 void SysMtgsThread::PrepDataPacket( MTGS_RingCommand cmd, u32 size )
@@ -163,23 +163,25 @@ void VU_Thread::ExecuteRingBuffer()
 // Should only be called by ReserveSpace()
 __ri void VU_Thread::WaitOnSize(s32 size)
 {
-	for(;;) {
+	auto hasSpace = [&]() {
 		s32 readPos  = GetReadPos();
-		if (readPos <= m_write_pos) break; // MTVU is reading in back of write_pos
+		if (readPos <= m_write_pos) return true; // MTVU is reading in back of write_pos
 		// FIXME greg: there is a bug somewhere in the queue pointer
 		// management. It creates a deadlock/corruption in SotC intro (before
 		// the first menu). I added a 4KB safety net which seem to avoid to
 		// trigger the bug.
 		// Note: a wait lock instead of a yield also helps to avoid the bug.
-		if (readPos >  m_write_pos + size + _4kb) break; // Enough free front space
-		{ // Let MTVU run to free up buffer space
-			KickStart();
-			// Locking might trigger a full flush of the ring buffer. Yield
-			// will be more aggressive, and only flush the minimal size.
-			// Performance will be smoother but it will consume extra CPU cycle
-			// on the EE thread (not an issue on 4 cores).
-			std::this_thread::yield();
-		}
+		return readPos > m_write_pos + size + _4kb; // Enough free front space
+	};
+
+	while (!hasSpace()) {
+		// Let MTVU run to free up buffer space
+		KickStart();
+		// Spinning and yielding only wait for the minimal size to be freed. If
+		// MTVU takes longer, locking waits for it to finish its current packets
+		// (might be a full flush of the ring buffer) without burning EE cycles.
+		if (spaceWait.Wait(hasSpace)) break;
+		ScopedLock lock(mtxBusy);
 	}
 }
 
@@ -317,6 +319,23 @@ void VU_Thread::WaitVU()
 	}
 }
 
+void VU_Thread::SetWaitLimits(int spin, int yield)
+{
+	semaEvent.policy.SetLimits(spin, yield);
+	semaXGkick.policy.SetLimits(spin, yield);
+	spaceWait.SetLimits(spin, yield);
+}
+
+void VU_Thread::PrintWaitStats()
+{
+	semaEvent.policy.stats.Print(L"MTVU wait for EE");
+	semaXGkick.policy.stats.Print(L"MTGS wait for MTVU xgkick");
+	spaceWait.stats.Print(L"EE wait for MTVU ring space");
+	semaEvent.policy.stats.Reset();
+	semaXGkick.policy.stats.Reset();
+	spaceWait.stats.Reset();
+}
+
 void VU_Thread::ExecuteVU(u32 vu_addr, u32 vif_top, u32 vif_itop)
 {
 	MTVU_LOG("MTVU - ExecuteVU!");
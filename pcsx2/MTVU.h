@@ -37,14 +37,15 @@ class VU_Thread : public pxThread {
 	__aligned(64) int  m_read_pos; // temporary read pos (local to the VU thread)
 	int  m_write_pos; // temporary write pos (local to the EE thread)
 	Mutex     mtxBusy;
-	Semaphore semaEvent;
+	SpinSemaphore semaEvent;
+	SpinWaitPolicy spaceWait; // EE thread waiting for ring buffer space
 	BaseVUmicroCPU*& vuCPU;
 	VURegs&          vuRegs;
 
 public:
 	__aligned16  vifStruct        vif;
 	__aligned16  VIFregisters     vifRegs;
-	__aligned(4) Semaphore semaXGkick;
+	__aligned(4) SpinSemaphore semaXGkick;
 	__aligned(4) std::atomic<unsigned int> vuCycles[4]; // Used for VU cycle stealing hack
 	__aligned(4) u32 vuCycleIdx;  // Used for VU cycle stealing hack
 
@@ -62,6 +63,10 @@ public:
 	// Waits till MTVU is done processing
 	void WaitVU();
 
+	// Wait policy of the EE/MTGS/MTVU handoffs (see GSOptions::SpinWaitCount)
+	void SetWaitLimits(int spin, int yield);
+	void PrintWaitStats();
+
 	void ExecuteVU(u32 vu_addr, u32 vif_top, u32 vif_itop);
 
 	void VifUnpack(vifStruct& _vif, VIFregisters& _vifRegs, u8* data, u32 size);
@@ -76,6 +76,23 @@ void Pcsx2Config::ProfilerOptions::LoadSave( IniInterface& ini )
 	IniBitBool( RecBlocks_IOP );
 	IniBitBool( RecBlocks_VU0 );
 	IniBitBool( RecBlocks_VU1 );
+	IniBitBool( SlowMem_EE );
+}
+
+Pcsx2Config::RewindOptions::RewindOptions()
+{
+	Enabled			= false;
+	FrameInterval	= 30;
+	BufferSizeMB	= 128;
+}
+
+void Pcsx2Config::RewindOptions::LoadSave( IniInterface& ini )
+{
+	ScopedIniGroup path( ini, L"Rewind" );
+
+	IniEntry( Enabled );
+	IniEntry( FrameInterval );
+	IniEntry( BufferSizeMB );
 }
 
 Pcsx2Config::RecompilerOptions::RecompilerOptions()
@@ -89,6 +106,8 @@ Pcsx2Config::RecompilerOptions::RecompilerOptions()
 
 	EnableEE	= true;
 	EnableEECache = false;
+	EnableEEBlockProfile = false;
+	EnableVifProfile = false;
 	EnableIOP	= true;
 	EnableVU0	= true;
 	EnableVU1	= true;
@@ -147,6 +166,8 @@ void Pcsx2Config::RecompilerOptions::LoadSave( IniInterface& ini )
 	IniBitBool( EnableEE );
 	IniBitBool( EnableIOP );
 	IniBitBool( EnableEECache );
+	IniBitBool( EnableEEBlockProfile );
+	IniBitBool( EnableVifProfile );
 	IniBitBool( EnableVU0 );
 	IniBitBool( EnableVU1 );
 
@@ -205,6 +226,10 @@ Pcsx2Config::GSOptions::GSOptions()
 
 	SynchronousMTGS			= false;
 	VsyncQueueSize			= 2;
+	RingBufferSizeFactor	= 19;
+
+	SpinWaitCount			= 1000;
+	SpinWaitYields			= 4;
 
 	FramesToDraw			= 2;
 	FramesToSkip			= 2;
@@ -220,6 +245,9 @@ void Pcsx2Config::GSOptions::LoadSave( IniInterface& ini )
 
 	IniEntry( SynchronousMTGS );
 	IniEntry( VsyncQueueSize );
+	IniEntry( RingBufferSizeFactor );
+	IniEntry( SpinWaitCount );
+	IniEntry( SpinWaitYields );
 
 	IniEntry( FrameLimitEnable );
 	IniEntry( FrameSkipEnable );
@@ -421,6 +449,7 @@ Pcsx2Config::Pcsx2Config()
 	McdFolderAutoManage = true;
 	EnablePatches = true;
 	BackupSavestate = true;
+	SavestateZstd = true;
 }
 
 void Pcsx2Config::LoadSave( IniInterface& ini )
@@ -430,6 +459,7 @@ void Pcsx2Config::LoadSave( IniInterface& ini )
 	IniBitBool( CdvdVerboseReads );
 	IniBitBool( CdvdDumpBlocks );
 	IniBitBool( CdvdShareWrite );
+	IniBitBool( CdvdDirectIO );
 	IniBitBool( EnablePatches );
 	IniBitBool( EnableCheats );
 	IniBitBool( EnableWideScreenPatches );
@@ -437,6 +467,7 @@ void Pcsx2Config::LoadSave( IniInterface& ini )
 	IniBitBool( HostFs );
 
 	IniBitBool( BackupSavestate );
+	IniBitBool( SavestateZstd );
 	IniBitBool( McdEnableEjection );
 	IniBitBool( McdFolderAutoManage );
 	IniBitBool( MultitapPort0_Enabled );
@@ -449,6 +480,7 @@ void Pcsx2Config::LoadSave( IniInterface& ini )
 	GS				.LoadSave( ini );
 	Gamefixes		.LoadSave( ini );
 	Profiler		.LoadSave( ini );
+	Rewind			.LoadSave( ini );
 
 	Debugger		.LoadSave( ini );
 	Trace			.LoadSave( ini );
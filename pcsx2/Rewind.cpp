@@ -0,0 +1,336 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2002-2010  PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PrecompiledHeader.h"
+#include "IopCommon.h"
+#include "Rewind.h"
+
+#include "VUmicro.h"
+#include "Counters.h"
+
+#include "Utilities/SafeArray.inl"
+
+RewindBuffer g_RewindBuffer;
+
+static const u32 MainPages = Ps2MemSize::MainRam / RewindBuffer::PageSize;
+
+// Encodes a page (the XOR of two snapshots) as runs of [u16 zeros][u16 count][count bytes].
+// A literal run only ends on 4 zeros or more, shorter gaps are cheaper kept inline.
+static uint EncodePageXor( const u8* x, u8* out )
+{
+	const uint PageSize = RewindBuffer::PageSize;
+	uint pos = 0, len = 0;
+
+	while (pos < PageSize)
+	{
+		uint zeros = 0;
+		while (pos + zeros < PageSize && !x[pos + zeros]) zeros++;
+		pos += zeros;
+
+		uint end = pos;
+		while (end < PageSize)
+		{
+			if (x[end]) { end++; continue; }
+
+			uint gap = end;
+			while (gap < PageSize && gap < end + 4 && !x[gap]) gap++;
+			if (gap == PageSize || gap == end + 4) break;
+			end = gap;
+		}
+
+		const u16 head[2] = { (u16)zeros, (u16)(end - pos) };
+		memcpy( out + len, head, sizeof(head) );
+		memcpy( out + len + sizeof(head), x + pos, end - pos );
+		len += sizeof(head) + end - pos;
+		pos = end;
+	}
+
+	return len;
+}
+
+static void DecodePageXor( const u8* in, uint len, u8* dest )
+{
+	const u8* end = in + len;
+	u8* d = dest;
+
+	while (in < end)
+	{
+		u16 head[2];
+		memcpy( head, in, sizeof(head) );
+		in += sizeof(head);
+		d += head[0];
+
+		for (uint i = 0; i < head[1]; ++i)
+			d[i] ^= in[i];
+		d += head[1];
+		in += head[1];
+	}
+
+	pxAssertDev( d <= dest + RewindBuffer::PageSize, "Rewind: corrupted page delta" );
+}
+
+RewindBuffer::RewindBuffer()
+	: m_mainShadow( L"Rewind EE memory" )
+	, m_stateShadow( L"Rewind state" )
+	, m_stateScratch( L"Rewind scratch state" )
+	, m_pageXor( PageSize )
+{
+	m_deltaBytes	= 0;
+	m_stateCapacity	= 0;
+	m_stateSize		= 0;
+	m_frame			= 0;
+	m_hasSnapshot	= false;
+	m_vsyncs		= 0;
+	memzero( m_stats );
+}
+
+void RewindBuffer::Clear()
+{
+	if (m_stats.snapshots)
+		PrintStats();
+
+	m_deltas.clear();
+	m_deltaBytes	= 0;
+
+	m_mainShadow.Dispose();
+	m_stateShadow.Dispose();
+	m_stateScratch.Dispose();
+	m_stateCapacity	= 0;
+	m_stateSize		= 0;
+	m_frame			= 0;
+	m_hasSnapshot	= false;
+
+	m_vsyncs		= 0;
+	memzero( m_stats );
+}
+
+size_t RewindBuffer::GetMemoryUsage() const
+{
+	return m_deltaBytes + m_mainShadow.GetSizeInBytes() + m_stateShadow.GetSizeInBytes() + m_stateScratch.GetSizeInBytes();
+}
+
+void RewindBuffer::PrintStats() const
+{
+	const RewindStats& s = m_stats;
+	if (!s.snapshots) return;
+
+	const double ms = 1000.0 / GetTickFrequency();
+	Console.WriteLn( Color_Gray, "Rewind: %llu snapshots, %.2f ms avg (%.2f ms max), %llu dirty pages and %llu KB each on average",
+		s.snapshots, s.ticks * ms / s.snapshots, s.ticksMax * ms,
+		s.pages / s.snapshots, s.deltaBytes / s.snapshots / 1024 );
+	Console.WriteLn( Color_Gray, "Rewind: %u snapshots kept (%u frames), %u MB of history, %u MB in total",
+		GetCount(), m_deltas.empty() ? 0 : m_frame - m_deltas.front().frame,
+		(uint)(m_deltaBytes / _1mb), (uint)(GetMemoryUsage() / _1mb) );
+}
+
+void RewindBuffer::VsyncInThread()
+{
+	if (!EmuConfig.Rewind.Enabled) return;
+
+	// Same reason as the savestate warning in FreezeInternals: the VU1 thread may be in the
+	// middle of a GIF transfer, and it would be repeated at every snapshot.
+	if (THREAD_VU1) return;
+
+	if (++m_vsyncs < (uint)std::max( EmuConfig.Rewind.FrameInterval, 1 )) return;
+	m_vsyncs = 0;
+
+	try {
+		Snapshot();
+	}
+	catch (BaseException& ex)
+	{
+		// The shadow copies are only half updated, start over with the next snapshot.
+		Console.Error( L"Rewind: snapshot failed, history cleared.\n%s", WX_STR(ex.FormatDiagnosticMessage()) );
+		Clear();
+	}
+}
+
+// Everything FreezeAll() does but the EE main memory (compared to its shadow in place) and
+// the BIOS check.  The plugins are frozen without the per-plugin console log, which would
+// otherwise be printed at every snapshot.
+void RewindBuffer::FreezeState( SaveStateBase& state )
+{
+	state.FreezeMem( eeMem->Scratch,	Ps2MemSize::Scratch );
+	state.FreezeMem( eeHw,				Ps2MemSize::Hardware );
+	state.FreezeMem( iopMem->Main,		Ps2MemSize::IopRam );
+	state.FreezeMem( iopHw,				Ps2MemSize::IopHardware );
+
+	state.FreezeMem( vuRegs[0].Micro,	VU0_PROGSIZE );
+	state.FreezeMem( vuRegs[0].Mem,		VU0_MEMSIZE );
+	state.FreezeMem( vuRegs[1].Micro,	VU1_PROGSIZE );
+	state.FreezeMem( vuRegs[1].Mem,		VU1_MEMSIZE );
+
+	state.FreezeInternals();
+
+	for (uint i=0; i<PluginId_Count; ++i)
+	{
+		const PluginsEnum_t pid = (PluginsEnum_t)i;
+
+		freezeData fP = { 0, NULL };
+		if (state.IsSaving() && !GetCorePlugins().DoFreeze( pid, FREEZE_SIZE, &fP ))
+			fP.size = 0;
+
+		state.Freeze( fP.size );
+		if (!fP.size) continue;
+
+		state.PrepBlock( fP.size );
+		fP.data = (s8*)state.GetBlockPtr();
+
+		if (state.IsSaving())
+		{
+			if (!GetCorePlugins().DoFreeze( pid, FREEZE_SAVE, &fP ))
+				throw Exception::FreezePluginFailure( pid );
+		}
+		else
+		{
+			if (!GetCorePlugins().DoFreeze( pid, FREEZE_LOAD, &fP ))
+				throw Exception::ThawPluginFailure( pid );
+		}
+
+		state.CommitBlock( fP.size );
+	}
+}
+
+// Appends the pages of cur which differ from shadow to the delta, and updates the shadow.
+void RewindBuffer::EncodeRegion( const u8* cur, u8* shadow, uint size, u32 firstPage, std::vector<u8>& out )
+{
+	u8* x = m_pageXor.data();
+
+	for (uint page = 0; page < size / PageSize; ++page)
+	{
+		const u8* src = cur + page * PageSize;
+		u8* dst = shadow + page * PageSize;
+		if (memcmp( src, dst, PageSize ) == 0) continue;
+
+		for (uint i = 0; i < PageSize; i += sizeof(u64))
+			*(u64*)(x + i) = *(const u64*)(src + i) ^ *(const u64*)(dst + i);
+		memcpy( dst, src, PageSize );
+
+		const size_t head = out.size();
+		out.resize( head + 8 + PageSize * 2 );
+
+		const u32 hdr[2] = { firstPage + page, EncodePageXor( x, &out[head + 8] ) };
+		memcpy( &out[head], hdr, sizeof(hdr) );
+		out.resize( head + 8 + hdr[1] );
+
+		m_stats.pages++;
+	}
+}
+
+void RewindBuffer::ApplyDelta( const Delta& delta )
+{
+	const u8* in = delta.data.data();
+	const u8* end = in + delta.data.size();
+
+	while (in < end)
+	{
+		u32 hdr[2];
+		memcpy( hdr, in, sizeof(hdr) );
+		in += sizeof(hdr);
+
+		u8* dest = (hdr[0] < MainPages)
+			? m_mainShadow.GetPtr( hdr[0] * PageSize )
+			: m_stateShadow.GetPtr( (hdr[0] - MainPages) * PageSize );
+
+		DecodePageXor( in, hdr[1], dest );
+		in += hdr[1];
+	}
+
+	m_frame		= delta.frame;
+	m_stateSize	= delta.stateSize;
+}
+
+void RewindBuffer::Snapshot()
+{
+	const u64 start = GetCPUTicks();
+
+	memSavingState save( m_stateScratch );
+	FreezeState( save );
+	const u32 size = save.GetCurrentPos();
+
+	// Both state buffers keep the same size in whole pages, and anything past the end of
+	// the state is zero so that a state which grows or shrinks is still a plain XOR.
+	const uint capacity = (size + PageSize - 1) & ~(PageSize - 1);
+	if (capacity > m_stateCapacity)
+	{
+		m_stateScratch.MakeRoomFor( capacity );
+		m_stateShadow.MakeRoomFor( capacity );
+		memset( m_stateShadow.GetPtr() + m_stateCapacity, 0, capacity - m_stateCapacity );
+		m_stateCapacity = capacity;
+	}
+	memset( m_stateScratch.GetPtr() + size, 0, m_stateCapacity - size );
+
+	if (!m_hasSnapshot)
+	{
+		m_mainShadow.ExactAlloc( Ps2MemSize::MainRam );
+		memcpy( m_mainShadow.GetPtr(), eeMem->Main, Ps2MemSize::MainRam );
+		memcpy( m_stateShadow.GetPtr(), m_stateScratch.GetPtr(), m_stateCapacity );
+		m_hasSnapshot = true;
+	}
+	else
+	{
+		Delta delta;
+		delta.frame		= m_frame;
+		delta.stateSize	= m_stateSize;
+
+		EncodeRegion( eeMem->Main, m_mainShadow.GetPtr(), Ps2MemSize::MainRam, 0, delta.data );
+		EncodeRegion( m_stateScratch.GetPtr(), m_stateShadow.GetPtr(), m_stateCapacity, MainPages, delta.data );
+		delta.data.shrink_to_fit();
+
+		m_deltaBytes += delta.data.size();
+		m_stats.deltaBytes += delta.data.size();
+		m_deltas.push_back( std::move(delta) );
+
+		const size_t budget = (size_t)std::max( EmuConfig.Rewind.BufferSizeMB, 1 ) * _1mb;
+		while (!m_deltas.empty() && m_deltaBytes > budget)
+		{
+			m_deltaBytes -= m_deltas.front().data.size();
+			m_deltas.pop_front();
+		}
+	}
+
+	m_frame		= g_FrameCount;
+	m_stateSize	= size;
+
+	const u64 ticks = GetCPUTicks() - start;
+	m_stats.snapshots++;
+	m_stats.ticks += ticks;
+	m_stats.ticksMax = std::max( m_stats.ticksMax, ticks );
+}
+
+bool RewindBuffer::Restore()
+{
+	if (!m_hasSnapshot) return false;
+
+	SysClearExecutionCache();
+	memcpy( eeMem->Main, m_mainShadow.GetPtr(), Ps2MemSize::MainRam );
+
+	memLoadingState load( m_stateShadow );
+	FreezeState( load );
+
+	Console.WriteLn( Color_StrongGreen, "Rewind: restored frame %u (%u frames back).", m_frame, g_FrameCount - m_frame );
+
+	// Step the shadow back, the next restore goes one snapshot further in the past (the
+	// oldest snapshot stays, as there is nothing to step it back to).
+	if (!m_deltas.empty())
+	{
+		ApplyDelta( m_deltas.back() );
+		m_deltaBytes -= m_deltas.back().data.size();
+		m_deltas.pop_back();
+	}
+
+	m_vsyncs = 0;
+	return true;
+}
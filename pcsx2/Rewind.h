@@ -0,0 +1,101 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2002-2010  PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "SaveState.h"
+#include <deque>
+
+struct RewindStats
+{
+	u64 snapshots;
+	u64 pages;			// dirty pages over all the snapshots
+	u64 deltaBytes;		// encoded size of those pages
+	u64 ticks;			// time spent taking the snapshots
+	u64 ticksMax;
+};
+
+// --------------------------------------------------------------------------------------
+//  RewindBuffer
+// --------------------------------------------------------------------------------------
+// Keeps the recent history of the VM in memory, so that it can be stepped back a few
+// seconds at a time.  Every Rewind.FrameInterval vsyncs the EE thread snapshots the VM.
+//
+// Only the newest snapshot is kept in full (the shadow copies).  Each older one is stored
+// as the XOR of two consecutive snapshots over the 4KB pages which differ, run-length
+// encoded.  The EE main memory is compared to its shadow in place, everything else is
+// serialized to a scratch buffer first.  Since a XOR delta goes both ways, applying the
+// newest one to the shadow gives back the snapshot before it, and the oldest ones can
+// simply be dropped once the history exceeds Rewind.BufferSizeMB.
+//
+// Snapshots are taken on the EE thread, and Restore() is only called while it's paused,
+// so there is no locking.
+//
+class RewindBuffer
+{
+	DeclareNoncopyableObject( RewindBuffer );
+
+public:
+	static const uint PageSize = 0x1000;
+
+protected:
+	struct Delta
+	{
+		u32				frame;		// of the snapshot this delta leads to
+		u32				stateSize;	// serialized state size of that snapshot
+		std::vector<u8>	data;		// [u32 page][u32 length][RLE of the XOR] ...
+	};
+
+	std::deque<Delta>	m_deltas;		// back() steps the shadow to the previous snapshot
+	size_t				m_deltaBytes;
+
+	SafeArray<u8>		m_mainShadow;
+	VmStateBuffer		m_stateShadow;
+	VmStateBuffer		m_stateScratch;
+	uint				m_stateCapacity;	// size of both state buffers, in whole pages
+	u32					m_stateSize;
+	u32					m_frame;
+	bool				m_hasSnapshot;
+
+	uint				m_vsyncs;
+	std::vector<u8>		m_pageXor;
+	RewindStats			m_stats;
+
+public:
+	RewindBuffer();
+	virtual ~RewindBuffer() = default;
+
+	void Clear();
+
+	// Called by the EE thread at every vsync; snapshots the VM when one is due.
+	void VsyncInThread();
+
+	// Loads the newest snapshot into the VM, and drops it from the history so that the
+	// next call goes further back.  The VM must be paused.
+	bool Restore();
+
+	uint GetCount() const { return m_hasSnapshot ? m_deltas.size() + 1 : 0; }
+	u32 GetFrame() const { return m_frame; }
+	size_t GetMemoryUsage() const;
+	void PrintStats() const;
+
+protected:
+	void Snapshot();
+	void FreezeState( SaveStateBase& state );
+	void EncodeRegion( const u8* cur, u8* shadow, uint size, u32 firstPage, std::vector<u8>& out );
+	void ApplyDelta( const Delta& delta );
+};
+
+extern RewindBuffer g_RewindBuffer;
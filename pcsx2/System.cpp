@@ -605,6 +605,8 @@ void SysClearExecutionCache()
 		dVifReset(0);
 		dVifReset(1);
 	}
+
+	vtlb_SlowMemProfileReset();
 }
 
 // Maps a block of memory for use as a recompiled code buffer, and ensures that the
@@ -22,6 +22,7 @@
 #include "GS.h"
 #include "Elfheader.h"
 #include "Patch.h"
+#include "Rewind.h"
 #include "SysThreads.h"
 #include "MTVU.h"
 
@@ -149,6 +150,8 @@ void SysCoreThread::ApplySettings( const Pcsx2Config& src )
 	m_resetProfilers		= ( src.Profiler != EmuConfig.Profiler );
 	m_resetVsyncTimers		= ( src.GS != EmuConfig.GS );
 
+	if( src.Rewind != EmuConfig.Rewind ) g_RewindBuffer.Clear();
+
 	const_cast<Pcsx2Config&>(EmuConfig) = src;
 }
 
@@ -196,6 +199,7 @@ void SysCoreThread::_reset_stuff_as_needed()
 		m_resetVsyncTimers		= false;
 
 		ForgetLoadedPatches();
+		g_RewindBuffer.Clear();
 	}
 
 	if( m_resetVsyncTimers )
@@ -225,6 +229,7 @@ void SysCoreThread::DoCpuReset()
 void SysCoreThread::VsyncInThread()
 {
 	ApplyLoadedPatches(PPT_CONTINUOUSLY);
+	g_RewindBuffer.VsyncInThread();
 }
 
 void SysCoreThread::GameStartingInThread()
@@ -236,6 +241,10 @@ void SysCoreThread::GameStartingInThread()
 	sApp.PostAppMethod(&Pcsx2App::resetDebugger);
 
 	ApplyLoadedPatches(PPT_ONCE_ON_LOAD);
+
+	// The VIF1 unpacks may be compiled by the VU1 thread
+	vu1Thread.WaitVU();
+	dVifProfileStart(ElfCRC);
 #ifdef USE_SAVESLOT_UI_UPDATES
 	UI_UpdateSysControls();
 #endif
@@ -293,6 +302,7 @@ void SysCoreThread::OnCleanupInThread()
 
 	// FIXME: temporary workaround for deadlock on exit, which actually should be a crash
 	vu1Thread.WaitVU();
+	g_RewindBuffer.Clear();
 	GetCorePlugins().Close();
 	GetCorePlugins().Shutdown();
 
@@ -37,6 +37,7 @@ extern __aligned16 const UNPACKFUNCTYPE VIFfuncTable[2][4][(4 * 4 * 2 * 2)];
 
 _vifT extern int  nVifUnpack (const u8* data);
 extern void resetNewVif(int idx);
+extern void dVifProfileStart(u32 crc);
 
 template< int idx >
 extern void vifUnpackSetup(const u32* data);
@@ -19,6 +19,10 @@
 #include "Utilities/pxStreams.h"
 #include "wx/zipstrm.h"
 
+#ifdef PCSX2_ZSTD
+#include <atomic>
+#endif
+
 using namespace Threading;
 
 // --------------------------------------------------------------------------------------
@@ -139,6 +143,73 @@ public:
 	}
 };
 
+// --------------------------------------------------------------------------------------
+//  ArchiveZstdCodec
+// --------------------------------------------------------------------------------------
+// Entries compressed with zstd are stored as-is in the zip, under their name followed by
+// ArchiveZstdSuffix.  The data is a sequence of independent zstd frames of (at most)
+// ArchiveZstdFrameSize bytes of input each, so that a big entry like the EE memory is
+// split between all the cores both when saving and when loading.
+//
+static const wxChar ArchiveZstdSuffix[] = L".zst";
+
+#ifdef PCSX2_ZSTD
+static const uint ArchiveZstdFrameSize = 0x200000;
+
+class ArchiveZstdCodec
+{
+	DeclareNoncopyableObject( ArchiveZstdCodec );
+
+	friend class ArchiveZstdThread;
+
+protected:
+	struct Frame
+	{
+		const u8*	src;
+		size_t		srcsize;
+		u8*			dest;		// decompression only
+		size_t		destsize;
+		uint		entry;
+		size_t		result;		// compressed size, or a zstd error code
+	};
+
+	struct Entry
+	{
+		std::vector<u8>	packed;	// compression only, once Compress() is done
+		wxString		error;
+	};
+
+	std::vector<Frame>	m_frames;
+	std::vector<Entry>	m_entries;
+	std::atomic<uint>	m_next;
+	bool				m_compress;
+	int					m_level;
+
+public:
+	ArchiveZstdCodec() : m_next(0), m_compress(false), m_level(0) {}
+	virtual ~ArchiveZstdCodec() = default;
+
+	// Queues an entry and returns its index. An empty entry yields an empty result.
+	uint AddCompress( const u8* src, size_t size );
+	// dest must hold exactly GetContentSize(src, size) bytes.
+	uint AddDecompress( const u8* src, size_t size, u8* dest, size_t destsize );
+
+	// Process all the queued entries, and return false if any of them failed.
+	bool Compress( int level );
+	bool Decompress();
+
+	const std::vector<u8>& GetCompressed( uint entry ) const { return m_entries[entry].packed; }
+	const wxString& GetError( uint entry ) const { return m_entries[entry].error; }
+
+	// Decompressed size of a sequence of frames, or -1 if it's not a valid one.
+	static s64 GetContentSize( const u8* src, size_t size );
+
+protected:
+	bool Run();
+	void RunFrames();
+};
+#endif
+
 // --------------------------------------------------------------------------------------
 //  BaseCompressThread
 // --------------------------------------------------------------------------------------
@@ -151,6 +222,7 @@ protected:
 	pxOutputStream*					m_gzfp;
 	ArchiveEntryList*				m_src_list;
 	bool							m_PendingSaveFlag;
+	int								m_zstd_level;
 	
 	wxString						m_final_filename;
 
@@ -187,6 +259,14 @@ public:
 		return *this;
 	}
 
+	// Compresses the entries with zstd instead of deflate (0 disables it).  Ignored when
+	// zstd support isn't built in.
+	BaseCompressThread& SetZstdLevel( int level )
+	{
+		m_zstd_level = level;
+		return *this;
+	}
+
 	wxString GetStreamName() const { return m_gzfp->GetStreamName(); }
 
 	BaseCompressThread& SetTargetFilename(const wxString& filename)
@@ -201,9 +281,11 @@ protected:
 		m_gzfp				= NULL;
 		m_src_list			= NULL;
 		m_PendingSaveFlag	= false;
+		m_zstd_level		= 0;
 	}
 
 	void SetPendingSave();
+	void WriteEntryData( const u8* data, size_t size );
 	void ExecuteTaskInThread();
 	void OnCleanupInThread();
 };
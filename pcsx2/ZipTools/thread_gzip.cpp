@@ -41,6 +41,20 @@ void BaseCompressThread::SetPendingSave()
 	m_PendingSaveFlag = true;
 }
 
+void BaseCompressThread::WriteEntryData( const u8* data, size_t size )
+{
+	static const uint BlockSize = 0x64000;
+	size_t curidx = 0;
+
+	while( curidx < size )
+	{
+		uint thisBlockSize = std::min<size_t>( BlockSize, size - curidx );
+		m_gzfp->Write(data + curidx, thisBlockSize);
+		curidx += thisBlockSize;
+		Yield( 2 );
+	}
+}
+
 void BaseCompressThread::ExecuteTaskInThread()
 {
 	// TODO : Add an API to PersistentThread for this! :)  --air
@@ -56,24 +70,52 @@ void BaseCompressThread::ExecuteTaskInThread()
 	Yield( 3 );
 
 	uint listlen = m_src_list->GetLength();
+	wxArchiveOutputStream& woot = *(wxArchiveOutputStream*)m_gzfp->GetWxStreamBase();
+
+#ifdef PCSX2_ZSTD
+	if( m_zstd_level > 0 )
+	{
+		// All the entries are compressed at once (on all cores) before anything is written;
+		// the zip itself only stores the result.
+		ArchiveZstdCodec zstd;
+		for( uint i=0; i<listlen; ++i )
+		{
+			const ArchiveEntry& entry = (*m_src_list)[i];
+			zstd.AddCompress( entry.GetDataSize() ? m_src_list->GetPtr( entry.GetDataIndex() ) : NULL, entry.GetDataSize() );
+		}
+
+		if( !zstd.Compress( m_zstd_level ) )
+		{
+			for( uint i=0; i<listlen; ++i )
+			{
+				if( !zstd.GetError( i ).IsEmpty() )
+					throw Exception::BadStream( m_final_filename )
+						.SetDiagMsg(pxsFmt( L"zstd failed to compress '%s': %s", WX_STR((*m_src_list)[i].GetFilename()), WX_STR(zstd.GetError( i )) ))
+						.SetUserMsg(_("The savestate was not properly saved. The data could not be compressed."));
+			}
+		}
+
+		for( uint i=0; i<listlen; ++i )
+		{
+			const ArchiveEntry& entry = (*m_src_list)[i];
+			if (!entry.GetDataSize()) continue;
+
+			wxZipEntry* zent = new wxZipEntry( entry.GetFilename() + ArchiveZstdSuffix );
+			zent->SetMethod( wxZIP_METHOD_STORE );
+			woot.PutNextEntry( zent );
+			WriteEntryData( zstd.GetCompressed( i ).data(), zstd.GetCompressed( i ).size() );
+			woot.CloseEntry();
+		}
+	}
+	else
+#endif
 	for( uint i=0; i<listlen; ++i )
 	{
 		const ArchiveEntry& entry = (*m_src_list)[i];
 		if (!entry.GetDataSize()) continue;
 
-		wxArchiveOutputStream& woot = *(wxArchiveOutputStream*)m_gzfp->GetWxStreamBase();
 		woot.PutNextEntry( entry.GetFilename() );
-
-		static const uint BlockSize = 0x64000;
-		uint curidx = 0;
-
-		do {
-			uint thisBlockSize = std::min( BlockSize, entry.GetDataSize() - curidx );
-			m_gzfp->Write(m_src_list->GetPtr( entry.GetDataIndex() + curidx ), thisBlockSize);
-			curidx += thisBlockSize;
-			Yield( 2 );
-		} while( curidx < entry.GetDataSize() );
-		
+		WriteEntryData( m_src_list->GetPtr( entry.GetDataIndex() ), entry.GetDataSize() );
 		woot.CloseEntry();
 	}
 
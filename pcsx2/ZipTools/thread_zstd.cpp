@@ -0,0 +1,213 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2002-2010  PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PrecompiledHeader.h"
+
+#include "ThreadedZipTools.h"
+#include <zstd.h>
+
+// --------------------------------------------------------------------------------------
+//  ArchiveZstdThread
+// --------------------------------------------------------------------------------------
+// Helps the calling thread to go through the frames of a codec; the frames are picked
+// one at a time so that a slow (big) entry doesn't leave the other workers idle.
+//
+class ArchiveZstdThread : public pxThread
+{
+	ArchiveZstdCodec& m_codec;
+
+public:
+	ArchiveZstdThread( ArchiveZstdCodec& codec, int id )
+		: m_codec( codec )
+	{
+		m_name = wxsFormat( L"Savestate zstd %d", id );
+	}
+
+	virtual ~ArchiveZstdThread()
+	{
+		try {
+			pxThread::Cancel();
+		}
+		DESTRUCTOR_CATCHALL
+	}
+
+protected:
+	void ExecuteTaskInThread()
+	{
+		m_codec.RunFrames();
+	}
+};
+
+uint ArchiveZstdCodec::AddCompress( const u8* src, size_t size )
+{
+	const uint entry = m_entries.size();
+	m_entries.push_back( Entry() );
+
+	for (size_t pos = 0; pos < size; pos += ArchiveZstdFrameSize)
+	{
+		Frame frame = { src + pos, std::min<size_t>( ArchiveZstdFrameSize, size - pos ), NULL, 0, entry, 0 };
+		m_frames.push_back( frame );
+	}
+
+	return entry;
+}
+
+uint ArchiveZstdCodec::AddDecompress( const u8* src, size_t size, u8* dest, size_t destsize )
+{
+	const uint entry = m_entries.size();
+	m_entries.push_back( Entry() );
+
+	size_t pos = 0, out = 0;
+	while (pos < size)
+	{
+		const size_t frameSize = ZSTD_findFrameCompressedSize( src + pos, size - pos );
+		const unsigned long long contentSize = ZSTD_isError( frameSize )
+			? ZSTD_CONTENTSIZE_ERROR : ZSTD_getFrameContentSize( src + pos, frameSize );
+
+		if (contentSize == ZSTD_CONTENTSIZE_ERROR || contentSize == ZSTD_CONTENTSIZE_UNKNOWN || contentSize > destsize - out)
+		{
+			m_entries[entry].error = L"invalid zstd frame";
+			break;
+		}
+
+		Frame frame = { src + pos, frameSize, dest + out, (size_t)contentSize, entry, 0 };
+		m_frames.push_back( frame );
+		pos += frameSize;
+		out += contentSize;
+	}
+
+	if (m_entries[entry].error.IsEmpty() && out != destsize)
+		m_entries[entry].error = L"unexpected decompressed size";
+
+	return entry;
+}
+
+s64 ArchiveZstdCodec::GetContentSize( const u8* src, size_t size )
+{
+	s64 total = 0;
+	size_t pos = 0;
+	while (pos < size)
+	{
+		const size_t frameSize = ZSTD_findFrameCompressedSize( src + pos, size - pos );
+		if (ZSTD_isError( frameSize )) return -1;
+
+		const unsigned long long contentSize = ZSTD_getFrameContentSize( src + pos, frameSize );
+		if (contentSize == ZSTD_CONTENTSIZE_ERROR || contentSize == ZSTD_CONTENTSIZE_UNKNOWN) return -1;
+
+		total += contentSize;
+		pos += frameSize;
+	}
+	return total;
+}
+
+bool ArchiveZstdCodec::Compress( int level )
+{
+	m_compress = true;
+	m_level = level;
+
+	// Every frame gets its own worst case sized slot in the packed buffer of its entry,
+	// and the slots are squeezed together once all of them are done.
+	std::vector<size_t> slots( m_frames.size() );
+	std::vector<size_t> used( m_entries.size(), 0 );
+	for (uint i = 0; i < m_frames.size(); ++i)
+	{
+		slots[i] = used[m_frames[i].entry];
+		used[m_frames[i].entry] += ZSTD_compressBound( m_frames[i].srcsize );
+	}
+	for (uint i = 0; i < m_entries.size(); ++i)
+		m_entries[i].packed.resize( used[i] );
+	for (uint i = 0; i < m_frames.size(); ++i)
+	{
+		Frame& frame = m_frames[i];
+		frame.dest = m_entries[frame.entry].packed.data() + slots[i];
+		frame.destsize = ZSTD_compressBound( frame.srcsize );
+	}
+
+	if (!Run()) return false;
+
+	std::fill( used.begin(), used.end(), 0 );
+	for (const Frame& frame : m_frames)
+	{
+		std::vector<u8>& packed = m_entries[frame.entry].packed;
+		memmove( packed.data() + used[frame.entry], frame.dest, frame.result );
+		used[frame.entry] += frame.result;
+	}
+	for (uint i = 0; i < m_entries.size(); ++i)
+		m_entries[i].packed.resize( used[i] );
+
+	return true;
+}
+
+bool ArchiveZstdCodec::Decompress()
+{
+	m_compress = false;
+	return Run();
+}
+
+bool ArchiveZstdCodec::Run()
+{
+	for (const Entry& entry : m_entries)
+		if (!entry.error.IsEmpty()) return false;
+
+	// Small states (or single core machines) aren't worth starting threads for.
+	const int threads = std::max<int>( 1, std::min<int>( x86caps.LogicalCores, m_frames.size() ) );
+
+	m_next = 0;
+	std::vector<ArchiveZstdThread*> workers;
+	for (int i = 1; i < threads; ++i)
+	{
+		workers.push_back( new ArchiveZstdThread( *this, i ) );
+		workers.back()->Start();
+	}
+
+	RunFrames();
+
+	for (ArchiveZstdThread* worker : workers)
+	{
+		worker->Block();
+		delete worker;
+	}
+
+	bool ok = true;
+	for (const Frame& frame : m_frames)
+	{
+		Entry& entry = m_entries[frame.entry];
+		if (!ZSTD_isError( frame.result ) && (m_compress || frame.result == frame.destsize)) continue;
+
+		if (entry.error.IsEmpty())
+			entry.error = ZSTD_isError( frame.result ) ? fromUTF8( ZSTD_getErrorName( frame.result ) ) : L"unexpected decompressed size";
+		ok = false;
+	}
+	return ok;
+}
+
+void ArchiveZstdCodec::RunFrames()
+{
+	ZSTD_CCtx* cctx = m_compress ? ZSTD_createCCtx() : NULL;
+	ZSTD_DCtx* dctx = m_compress ? NULL : ZSTD_createDCtx();
+
+	uint idx;
+	while ((idx = m_next.fetch_add( 1 )) < m_frames.size())
+	{
+		Frame& frame = m_frames[idx];
+		if (m_compress)
+			frame.result = ZSTD_compressCCtx( cctx, frame.dest, frame.destsize, frame.src, frame.srcsize, m_level );
+		else
+			frame.result = ZSTD_decompressDCtx( dctx, frame.dest, frame.destsize, frame.src, frame.srcsize );
+	}
+
+	ZSTD_freeCCtx( cctx );
+	ZSTD_freeDCtx( dctx );
+}
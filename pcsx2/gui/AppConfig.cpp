@@ -542,6 +542,7 @@ AppConfig::AppConfig()
 	}
 
 	GzipIsoIndexTemplate = L"$(f).pindex.tmp";
+	CompressedIsoCacheMB = 200;
 }
 
 // ------------------------------------------------------------------------
@@ -632,6 +633,7 @@ void AppConfig::LoadSaveRootItems( IniInterface& ini )
 	IniEntry( LanguageCode );
 	IniEntry( RecentIsoCount );
 	IniEntry( GzipIsoIndexTemplate );
+	IniEntry( CompressedIsoCacheMB );
 	IniEntry( Listbook_ImageSize );
 	IniEntry( Toolbar_ImageSize );
 	IniEntry( Toolbar_ShowLabels );
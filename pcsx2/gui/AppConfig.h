@@ -329,6 +329,7 @@ public:
 	// slots (3 each)
 	McdOptions				Mcd[8];
 	wxString				GzipIsoIndexTemplate; // for quick-access index with gzipped ISO
+	int						CompressedIsoCacheMB; // extracted data cache of the gzip/zstd ISO readers
 
 	ConsoleLogOptions		ProgLogBox;
 	FolderOptions			Folders;
@@ -270,6 +270,13 @@ static int loadGameSettings(Pcsx2Config& dest, const Game_Data& game) {
 		gf++;
 	}
 
+	if (game.keyExists("eeWaitLoopSpeedHack")) {
+		bool waitLoop = game.getInt("eeWaitLoopSpeedHack") ? 1 : 0;
+		PatchesCon->WriteLn("(GameDB) Changing EE wait loop speed hack [mode=%d]", waitLoop);
+		dest.Speedhacks.WaitLoop = waitLoop;
+		gf++;
+	}
+
 	for( GamefixId id=GamefixId_FIRST; id<pxEnumEnd; ++id )
 	{
 		wxString key( EnumToString(id) );
@@ -49,6 +49,7 @@ void GSPanel::InitDefaultAccelerators()
 	m_Accels->Map( AAC( WXK_F3 ).Shift(),		"States_DefrostCurrentSlotBackup");
 	m_Accels->Map( AAC( WXK_F2 ),				"States_CycleSlotForward" );
 	m_Accels->Map( AAC( WXK_F2 ).Shift(),		"States_CycleSlotBackward" );
+	m_Accels->Map( AAC( WXK_BACK ),				"States_Rewind" );
 
 	m_Accels->Map( AAC( WXK_F4 ),				"Framelimiter_MasterToggle");
 	m_Accels->Map( AAC( WXK_F4 ).Shift(),		"Frameskip_Toggle");
@@ -611,6 +612,21 @@ void GSFrame::OnUpdateTitle( wxTimerEvent& evt )
 	out << std::fixed << std::setprecision(2) << fps;
 	OSDmonitor(Color_StrongGreen, "FPS:", out.str());
 
+	MTGS_RingStats ring;
+	GetMTGS().GetRingStats(ring);
+	const MTGS_RingStats recent(ring.Since(m_RingStats));
+	m_RingStats = ring;
+	if (recent.frames) {
+		const double ms = 1000.0 / GetTickFrequency();
+		std::ostringstream ringOut, stallOut, idleOut;
+		ringOut << std::fixed << std::setprecision(0) << recent.OccupancyAvg() * 100 << "%";
+		stallOut << std::fixed << std::setprecision(2) << recent.stallTicks * ms / recent.frames << " ms/f";
+		idleOut << std::fixed << std::setprecision(2) << recent.idleTicks * ms / recent.frames << " ms/f";
+		OSDmonitor(Color_StrongGreen, "Ring:", ringOut.str());
+		OSDmonitor(Color_StrongGreen, "EE stall:", stallOut.str());
+		OSDmonitor(Color_StrongGreen, "GS idle:", idleOut.str());
+	}
+
 #ifdef __linux__
 	// Important Linux note: When the title is set in fullscreen the window is redrawn. Unfortunately
 	// an intermediate white screen appears too which leads to a very annoying flickering.
@@ -18,6 +18,7 @@
 
 #include "AppCommon.h"
 #include "CpuUsageProvider.h"
+#include "GS.h"
 #include <memory>
 
 
@@ -92,6 +93,7 @@ protected:
 	wxStatusBar*			m_statusbar;
 
 	CpuUsageProvider		m_CpuUsage;
+	MTGS_RingStats			m_RingStats;	// at the previous title update
 
 public:
 	GSFrame( const wxString& title);
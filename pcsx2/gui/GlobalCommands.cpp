@@ -505,6 +505,13 @@ static const GlobalCommandDescriptor CommandDeclarations[] =
 		false,
 	},
 
+	{	"States_Rewind",
+		States_Rewind,
+		pxL( "Rewind" ),
+		pxL( "Steps the virtual machine back to the previous rewind snapshot." ),
+		false,
+	},
+
 	{	"Frameskip_Toggle",
 		Implementations::Frameskip_Toggle,
 		NULL,
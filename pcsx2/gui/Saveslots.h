@@ -123,6 +123,7 @@ extern void States_DefrostCurrentSlot();
 extern void States_FreezeCurrentSlot();
 extern void States_CycleSlotForward();
 extern void States_CycleSlotBackward();
+extern void States_Rewind();
 extern void States_SetCurrentSlot(int slot);
 extern int States_GetCurrentSlot();
 extern void Sstates_updateLoadBackupMenuItem(bool isBeforeSave);
\ No newline at end of file
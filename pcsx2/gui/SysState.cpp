@@ -27,9 +27,11 @@
 #include "ConsoleLogger.h"
 
 #include <wx/wfstream.h>
+#include <wx/mstream.h>
 #include <memory>
 
 #include "Patch.h"
+#include "Rewind.h"
 
 // Used to hold the current state backup (fullcopy of PS2 memory and plugin states).
 //static VmStateBuffer state_buffer( L"Public Savestate Buffer" );
@@ -38,6 +40,8 @@ static const wxChar* EntryFilename_StateVersion			= L"PCSX2 Savestate Version.id
 static const wxChar* EntryFilename_Screenshot			= L"Screenshot.jpg";
 static const wxChar* EntryFilename_InternalStructures	= L"PCSX2 Internal Structures.dat";
 
+static const int SavestateZstdLevel = 3;
+
 
 // --------------------------------------------------------------------------------------
 //  BaseSavestateEntry
@@ -467,6 +471,7 @@ protected:
 			.SetSource(elist.get())
 			.SetOutStream(out.get())
 			.SetFinishedPath(m_filename)
+			.SetZstdLevel(EmuConfig.SavestateZstd ? SavestateZstdLevel : 0)
 			.Start();
 
 		// No errors?  Release cleanup handlers:
@@ -484,6 +489,22 @@ protected:
 	}
 };
 
+// Entries are either deflated under their own name, or stored as zstd frames under their
+// name followed by ArchiveZstdSuffix (see ArchiveZstdCodec).
+static bool IsZstdEntry( const wxZipEntry& entry )
+{
+	return entry.GetName().Lower().EndsWith( ArchiveZstdSuffix );
+}
+
+static bool IsEntryNamed( const wxZipEntry& entry, const wxString& filename )
+{
+	wxString name( entry.GetName() );
+	if (IsZstdEntry( entry ))
+		name.Truncate( name.length() - wxStrlen( ArchiveZstdSuffix ) );
+
+	return name.CmpNoCase( filename ) == 0;
+}
+
 // --------------------------------------------------------------------------------------
 //  SysExecEvent_UnzipFromDisk
 // --------------------------------------------------------------------------------------
@@ -555,7 +576,7 @@ protected:
 				continue;
 			}
 
-			if (entry->GetName().CmpNoCase(EntryFilename_InternalStructures) == 0)
+			if (IsEntryNamed(*entry, EntryFilename_InternalStructures))
 			{
 				DevCon.WriteLn( Color_Green, L" ... found '%s'", EntryFilename_InternalStructures);
 				foundInternal = std::move(entry);
@@ -571,7 +592,7 @@ protected:
 
 			for (uint i=0; i<ArraySize(SavestateEntries); ++i)
 			{
-				if (entry->GetName().CmpNoCase(SavestateEntries[i]->GetFilename()) == 0)
+				if (IsEntryNamed(*entry, SavestateEntries[i]->GetFilename()))
 				{
 					DevCon.WriteLn( Color_Green, L" ... found '%s'", WX_STR(SavestateEntries[i]->GetFilename()) );
 					foundEntry[i] = std::move(entry);
@@ -606,6 +627,12 @@ protected:
 				.SetDiagMsg( L"Savestate cannot be loaded: some required components were not found or are incomplete." )
 				.SetUserMsg(_("This savestate cannot be loaded due to missing critical components.  See the log file for details."));
 
+		// The zstd entries are read and then decompressed all at once (on all cores), before
+		// the emulation is paused.  The last slot holds the internal structures.
+
+		std::unique_ptr<VmStateBuffer> unpacked[ArraySize(SavestateEntries) + 1];
+		LoadZstdEntries( *reader, foundEntry, foundInternal.get(), unpacked );
+
 		// We use direct Suspend/Resume control here, since it's desirable that emulation
 		// *ALWAYS* start execution after the new savestate is loaded.
 
@@ -620,20 +647,117 @@ protected:
 
 			Threading::pxTestCancel();
 
+			if (unpacked[i])
+			{
+				pxInputStream memreader( m_filename, new wxMemoryInputStream( unpacked[i]->GetPtr(), unpacked[i]->GetSizeInBytes() ) );
+				SavestateEntries[i]->FreezeIn( memreader );
+				continue;
+			}
+
 			gzreader->OpenEntry( *foundEntry[i] );
 			SavestateEntries[i]->FreezeIn( *reader );
 		}
 
 		// Load all the internal data
 
-		gzreader->OpenEntry( *foundInternal );
+		std::unique_ptr<VmStateBuffer> internals( std::move(unpacked[ArraySize(SavestateEntries)]) );
+		if (!internals)
+		{
+			gzreader->OpenEntry( *foundInternal );
 
-		VmStateBuffer buffer( foundInternal->GetSize(), L"StateBuffer_UnzipFromDisk" );		// start with an 8 meg buffer to avoid frequent reallocation.
-		reader->Read( buffer.GetPtr(), foundInternal->GetSize() );
+			internals.reset( new VmStateBuffer( foundInternal->GetSize(), L"StateBuffer_UnzipFromDisk" ) );
+			reader->Read( internals->GetPtr(), foundInternal->GetSize() );
+		}
 
-		memLoadingState( buffer ).FreezeBios().FreezeInternals();
+		memLoadingState( *internals ).FreezeBios().FreezeInternals();
 		GetCoreThread().Resume();	// force resume regardless of emulation state earlier.
 	}
+
+	void LoadZstdEntries( pxInputStream& reader, const std::unique_ptr<wxZipEntry>* foundEntry, wxZipEntry* foundInternal,
+		std::unique_ptr<VmStateBuffer>* unpacked )
+	{
+		const uint count = ArraySize(SavestateEntries) + 1;
+
+#ifdef PCSX2_ZSTD
+		wxZipInputStream* gzreader = (wxZipInputStream*)reader.GetWxStreamBase();
+		std::unique_ptr<VmStateBuffer> packed[count];
+		uint codecIdx[count];
+		ArchiveZstdCodec zstd;
+		bool hasZstd = false;
+#endif
+
+		for (uint i=0; i<count; ++i)
+		{
+			wxZipEntry* entry = (i < ArraySize(SavestateEntries)) ? foundEntry[i].get() : foundInternal;
+			if (!entry || !IsZstdEntry(*entry)) continue;
+
+#ifdef PCSX2_ZSTD
+			Threading::pxTestCancel();
+
+			gzreader->OpenEntry( *entry );
+			packed[i].reset( new VmStateBuffer( entry->GetSize(), L"StateBuffer_Zstd" ) );
+			reader.Read( packed[i]->GetPtr(), entry->GetSize() );
+
+			const s64 size = ArchiveZstdCodec::GetContentSize( packed[i]->GetPtr(), entry->GetSize() );
+			if (size < 0 || size > 0x7fffffff)
+				throw Exception::SaveStateLoadError( m_filename )
+					.SetDiagMsg( pxsFmt(L"Savestate entry '%s' is not a valid zstd stream.", WX_STR(entry->GetName())) )
+					.SetUserMsg(_("This savestate cannot be loaded because it is corrupted.  See the log file for details."));
+
+			unpacked[i].reset( new VmStateBuffer( (int)size, L"StateBuffer_Zstd" ) );
+			codecIdx[i] = zstd.AddDecompress( packed[i]->GetPtr(), entry->GetSize(), unpacked[i]->GetPtr(), size );
+			hasZstd = true;
+#else
+			throw Exception::SaveStateLoadError( m_filename )
+				.SetDiagMsg( pxsFmt(L"Savestate entry '%s' is compressed with zstd, which is not supported by this build.", WX_STR(entry->GetName())) )
+				.SetUserMsg(_("This savestate cannot be loaded because it was compressed with zstd, which this build of PCSX2 does not support."));
+#endif
+		}
+
+#ifdef PCSX2_ZSTD
+		if (!hasZstd || zstd.Decompress()) return;
+
+		for (uint i=0; i<count; ++i)
+		{
+			if (!packed[i] || zstd.GetError( codecIdx[i] ).IsEmpty()) continue;
+
+			const wxZipEntry* entry = (i < ArraySize(SavestateEntries)) ? foundEntry[i].get() : foundInternal;
+			throw Exception::SaveStateLoadError( m_filename )
+				.SetDiagMsg( pxsFmt(L"Savestate entry '%s' failed to decompress: %s", WX_STR(entry->GetName()), WX_STR(zstd.GetError( codecIdx[i] ))) )
+				.SetUserMsg(_("This savestate cannot be loaded because it is corrupted.  See the log file for details."));
+		}
+#endif
+	}
+};
+
+// --------------------------------------------------------------------------------------
+//  SysExecEvent_Rewind
+// --------------------------------------------------------------------------------------
+// Loads the newest snapshot of the rewind buffer; see RewindBuffer.
+//
+class SysExecEvent_Rewind : public SysExecEvent
+{
+public:
+	wxString GetEventName() const { return L"VM_Rewind"; }
+
+	virtual ~SysExecEvent_Rewind() = default;
+	SysExecEvent_Rewind* Clone() const { return new SysExecEvent_Rewind( *this ); }
+
+	bool IsCriticalEvent() const { return true; }
+	bool AllowCancelOnExit() const { return false; }
+
+protected:
+	void InvokeEvent()
+	{
+		ScopedCoreThreadPause paused_core;
+
+		if( !g_RewindBuffer.Restore() )
+			OSDlog( Color_StrongGreen, true, "Nothing to rewind to." );
+		else
+			OSDlog( Color_StrongGreen, false, "Rewound (%u snapshots left).", g_RewindBuffer.GetCount() - 1 );
+
+		paused_core.AllowResume();
+	}
 };
 
 // =====================================================================================================
@@ -652,6 +776,11 @@ void StateCopy_SaveToFile( const wxString& file )
 	ziplist.release();
 }
 
+void StateCopy_Rewind()
+{
+	GetSysExecutorThread().PostEvent(new SysExecEvent_Rewind());
+}
+
 void StateCopy_LoadFromFile( const wxString& file )
 {
 	UI_DisableSysActions();
@@ -38,6 +38,8 @@
 
 #include "Utilities/MemsetFast.inl"
 
+#include <unordered_map>
+
 using namespace R5900;
 using namespace vtlb_private;
 
@@ -46,6 +48,7 @@ using namespace vtlb_private;
 namespace vtlb_private
 {
 	__aligned(64) MapData vtlbdata;
+	SlowMemProfile slowmem;
 }
 
 static vtlbHandler vtlbHandlerCount = 0;
@@ -87,6 +90,73 @@ __inline int CheckCache(u32 addr)
 	}
 	return false;
 }
+// --------------------------------------------------------------------------------------
+//  Slow path profiler
+// --------------------------------------------------------------------------------------
+// Counts the accesses which reach the vtlb handlers (hardware registers, unmapped pages...)
+// by physical page and by guest pc, to find the register polling loops of a game.
+
+// The counters are only ever zeroed, never freed, since recompiled code points to them.
+static std::unordered_map<u32, u32> s_slowMemSites;
+
+u32* vtlb_SlowMemProfileSite(u32 pc)
+{
+	return &s_slowMemSites[pc];
+}
+
+static void vtlb_ProfileSlowMem(u32 paddr)
+{
+	slowmem.pages[(paddr >> VTLB_PAGE_BITS) & (VTLB_PMAP_ITEMS - 1)]++;
+
+	// The interpreter has already moved on to the next instruction.  The recompiled code only
+	// gets here through C++ helpers, without an up to date pc, and counts its own accesses.
+	if (!CHECK_EEREC)
+		s_slowMemSites[cpuRegs.pc - 4]++;
+}
+
+static void vtlb_PrintSlowMemTop(const char* title, std::vector<std::pair<u32, u32>>& counts, u64 total)
+{
+	std::sort(counts.begin(), counts.end(), std::greater<std::pair<u32, u32>>());
+
+	Console.WriteLn(Color_Gray, "  %s:", title);
+	for (uint i = 0; i < std::min<size_t>(counts.size(), 16); i++)
+		Console.WriteLn(Color_Gray, "    0x%08x - [%6.2f%%][count=%u]",
+			counts[i].second, (double)counts[i].first * 100.0 / total, counts[i].first);
+}
+
+static void vtlb_SlowMemProfilePrint()
+{
+	std::vector<std::pair<u32, u32>> pages, sites;	// [count, address]
+	u64 total = 0;
+
+	for (uint i = 0; i < VTLB_PMAP_ITEMS; i++) {
+		if (!slowmem.pages[i]) continue;
+		pages.push_back(std::make_pair(slowmem.pages[i], i << VTLB_PAGE_BITS));
+		total += slowmem.pages[i];
+	}
+	if (!total) return;
+
+	for (const auto& it : s_slowMemSites)
+		if (it.second) sites.push_back(std::make_pair(it.second, it.first));
+
+	Console.WriteLn(Color_StrongBlack, "EE slow memory profile: %llu accesses through the vtlb handlers", total);
+	vtlb_PrintSlowMemTop("By physical page", pages, total);
+	vtlb_PrintSlowMemTop("By pc", sites, total);
+}
+
+// Reports and clears the counters, and picks up the profiler options.  The recompiler cache
+// must be cleared as well, since the recompiled code only counts when the profiler was on.
+void vtlb_SlowMemProfileReset()
+{
+	vtlb_SlowMemProfilePrint();
+
+	memzero(slowmem.pages);
+	for (auto& it : s_slowMemSites)
+		it.second = 0;
+
+	slowmem.enabled = EmuConfig.Profiler.Enabled && EmuConfig.Profiler.SlowMem_EE;
+}
+
 // --------------------------------------------------------------------------------------
 // Interpreter Implementations of VTLB Memory Operations.
 // --------------------------------------------------------------------------------------
@@ -128,6 +198,7 @@ DataType __fastcall vtlb_memRead(u32 addr)
 	//has to: translate, find function, call function
 	u32 hand=(u8)vmv;
 	u32 paddr=ppf-hand+0x80000000;
+	if (unlikely(slowmem.enabled)) vtlb_ProfileSlowMem(paddr);
 	//Console.WriteLn("Translated 0x%08X to 0x%08X", addr,paddr);
 	//return reinterpret_cast<TemplateHelper<DataSize,false>::HandlerType*>(vtlbdata.RWFT[TemplateHelper<DataSize,false>::sidx][0][hand])(paddr,data);
 
@@ -171,6 +242,7 @@ void __fastcall vtlb_memRead64(u32 mem, mem64_t *out)
 		//has to: translate, find function, call function
 		u32 hand=(u8)vmv;
 		u32 paddr=ppf-hand+0x80000000;
+		if (unlikely(slowmem.enabled)) vtlb_ProfileSlowMem(paddr);
 		//Console.WriteLn("Translated 0x%08X to 0x%08X", addr,paddr);
 
 		((vtlbMemR64FP*)vtlbdata.RWFT[3][0][hand])(paddr, out);
@@ -200,6 +272,7 @@ void __fastcall vtlb_memRead128(u32 mem, mem128_t *out)
 		//has to: translate, find function, call function
 		u32 hand=(u8)vmv;
 		u32 paddr=ppf-hand+0x80000000;
+		if (unlikely(slowmem.enabled)) vtlb_ProfileSlowMem(paddr);
 		//Console.WriteLn("Translated 0x%08X to 0x%08X", addr,paddr);
 
 		((vtlbMemR128FP*)vtlbdata.RWFT[4][0][hand])(paddr, out);
@@ -241,6 +314,7 @@ void __fastcall vtlb_memWrite(u32 addr, DataType data)
 		//has to: translate, find function, call function
 		u32 hand=(u8)vmv;
 		u32 paddr=ppf-hand+0x80000000;
+		if (unlikely(slowmem.enabled)) vtlb_ProfileSlowMem(paddr);
 		//Console.WriteLn("Translated 0x%08X to 0x%08X", addr,paddr);
 
 		switch( DataSize )
@@ -279,6 +353,7 @@ void __fastcall vtlb_memWrite64(u32 mem, const mem64_t* value)
 		//has to: translate, find function, call function
 		u32 hand=(u8)vmv;
 		u32 paddr=ppf-hand+0x80000000;
+		if (unlikely(slowmem.enabled)) vtlb_ProfileSlowMem(paddr);
 		//Console.WriteLn("Translated 0x%08X to 0x%08X", addr,paddr);
 
 		((vtlbMemW64FP*)vtlbdata.RWFT[3][1][hand])(paddr, value);
@@ -307,6 +382,7 @@ void __fastcall vtlb_memWrite128(u32 mem, const mem128_t *value)
 		//has to: translate, find function, call function
 		u32 hand=(u8)vmv;
 		u32 paddr=ppf-hand+0x80000000;
+		if (unlikely(slowmem.enabled)) vtlb_ProfileSlowMem(paddr);
 		//Console.WriteLn("Translated 0x%08X to 0x%08X", addr,paddr);
 
 		((vtlbMemW128FP*)vtlbdata.RWFT[4][1][hand])(paddr, value);
@@ -825,6 +901,8 @@ void vtlb_Alloc_Ppmap()
 
 void vtlb_Core_Free()
 {
+	vtlb_SlowMemProfileReset();
+
 	safe_aligned_free( vtlbdata.vmap );
 	safe_aligned_free( vtlbdata.ppmap );
 }
@@ -90,6 +90,9 @@ extern void vtlb_DynGenWrite_Const( u32 bits, u32 addr_const );
 extern void vtlb_DynGenRead64_Const( u32 bits, u32 addr_const );
 extern void vtlb_DynGenRead32_Const( u32 bits, bool sign, u32 addr_const );
 
+extern void vtlb_SlowMemProfileReset();
+extern u32* vtlb_SlowMemProfileSite(u32 pc);
+
 // --------------------------------------------------------------------------------------
 //  VtlbMemoryReserve
 // --------------------------------------------------------------------------------------
@@ -212,6 +215,16 @@ namespace vtlb_private
 	};
 
 	extern __aligned(64) MapData vtlbdata;
+
+	// Slow path profiler (Profiler.SlowMem_EE): the accesses which went through the handlers,
+	// by physical page.  The recompiled code increments the counters directly.
+	struct SlowMemProfile
+	{
+		u32 enabled;
+		u32 pages[VTLB_PMAP_ITEMS];
+	};
+
+	extern SlowMemProfile slowmem;
 }
 
 // --------------------------------------------------------------------------------------
@@ -25,6 +25,7 @@
 
 extern u32 maxrecmem;
 extern u32 pc;			         // recompiler pc (also used by the SuperVU! .. why? (air))
+extern bool g_recompilingDelaySlot;	// pc is still on the delay slot while it's recompiled
 extern int g_branch;	         // set for branch (also used by the SuperVU! .. why? (air))
 extern u32 target;		         // branch target
 extern u32 s_nBlockCycles;		// cycles of current block recompiling
@@ -34,11 +34,13 @@
 
 #include "../DebugTools/Breakpoints.h"
 #include "Patch.h"
+#include "AppConfig.h"
 
 #if !PCSX2_SEH
 #	include <csetjmp>
 #endif
 
+#include <unordered_map>
 
 #include "Utilities/MemsetFast.inl"
 #include "Utilities/Perf.h"
@@ -96,6 +98,44 @@ u32 s_nEndBlock = 0; // what pc the current block ends
 u32 s_branchTo;
 static bool s_nBlockFF;
 
+// --------------------------------------------------------------------------------------
+//  Wait loop statistics
+// --------------------------------------------------------------------------------------
+// The wait loops found by the block scan of recRecompile (s_nBlockFF) since the last reset
+// of the recompiler, and the cycles they fast forwarded (Speedhacks.WaitLoop).  The
+// counters are updated by the recompiled code, so they live as long as the rec cache.
+
+struct recWaitLoop
+{
+	u64 cycles;		// skipped
+	u32 skips;
+};
+
+static std::unordered_map<u32, recWaitLoop> s_waitLoops; // by startpc
+static recWaitLoop* s_nBlockFFStats = NULL;
+
+static void recPrintWaitLoops()
+{
+	std::vector< std::pair<u64, u32> > loops; // [cycles, startpc]
+	u64 cycles = 0, skips = 0;
+
+	for (const auto& it : s_waitLoops) {
+		cycles += it.second.cycles;
+		skips += it.second.skips;
+		if (it.second.skips)
+			loops.push_back(std::make_pair(it.second.cycles, it.first));
+	}
+	if (!skips) return;
+
+	std::sort(loops.begin(), loops.end(), std::greater< std::pair<u64, u32> >());
+
+	Console.WriteLn(Color_StrongBlack, "EE wait loops: %u found, %llu skips, %.2f s of EE time skipped",
+		(uint)s_waitLoops.size(), skips, (double)cycles / PS2CLK);
+	for (uint i = 0; i < std::min<size_t>(loops.size(), 8); i++)
+		Console.WriteLn(Color_Gray, "    0x%08x - [%u skips][%.3f s]",
+			loops[i].second, s_waitLoops[loops[i].second].skips, (double)loops[i].first / PS2CLK);
+}
+
 // save states for branches
 GPR_reg64 s_saveConstRegs[32];
 static u32 s_saveHasConstReg = 0, s_saveFlushedConstReg = 0;
@@ -315,6 +355,7 @@ void recCall( void (*func)() )
 // =====================================================================================================
 
 static void __fastcall recRecompile( const u32 startpc );
+static void recProfileSave();
 static void __fastcall dyna_block_discard(u32 start,u32 sz);
 static void __fastcall dyna_page_reset(u32 start,u32 sz);
 
@@ -588,6 +629,11 @@ static void recResetRaw()
 
 	Console.WriteLn( Color_StrongBlack, "EE/iR5900-32 Recompiler Reset" );
 
+	recProfileSave();
+
+	recPrintWaitLoops();
+	s_waitLoops.clear();
+
 	recMem->Reset();
 	ClearRecLUT((BASEBLOCK*)recLutReserve_RAM, recLutSize);
 	memset(recRAMCopy, 0, Ps2MemSize::MainRam);
@@ -614,6 +660,10 @@ static void recResetRaw()
 
 static void recShutdown()
 {
+	recProfileSave();
+	recPrintWaitLoops();
+	s_waitLoops.clear();
+
 	safe_delete( recMem );
 	safe_aligned_free( recRAMCopy );
 	safe_aligned_free( recLutReserve_RAM );
@@ -1034,6 +1084,14 @@ static void iBranchTest(u32 newpc)
 		xADD(ptr32[&cpuRegs.cycle], scaleblockcycles());
 		xCMP(eax, ptr32[&cpuRegs.cycle]);
 		xCMOVS(eax, ptr32[&cpuRegs.cycle]);
+
+		// statistics (edx is free, the dispatcher doesn't expect anything there)
+		xMOV(edx, eax);
+		xSUB(edx, ptr32[&cpuRegs.cycle]);
+		xADD(ptr32[(u32*)&s_nBlockFFStats->cycles], edx);
+		xADC(ptr32[(u32*)&s_nBlockFFStats->cycles + 1], 0);
+		xADD(ptr32[&s_nBlockFFStats->skips], 1);
+
 		xMOV(ptr32[&cpuRegs.cycle], eax);
 
 		xJMP( (void*)DispatcherEvent );
@@ -1598,6 +1656,153 @@ void doPlace0Patches()
     ApplyLoadedPatches(PPT_ONCE_ON_LOAD);
 }
 
+// --------------------------------------------------------------------------------------
+//  EE block profile
+// --------------------------------------------------------------------------------------
+// The blocks compiled while a game runs are saved to a profile of the game (start pc, size
+// and a hash of their MIPS code). When the game boots again, the blocks of the profile are
+// compiled right after its entry point, instead of the first time the game reaches them.
+// Blocks whose code doesn't match anymore (overlays, self-modifying code) are skipped, and
+// dropped from the profile.
+
+struct recProfileBlock
+{
+	u32 startpc;
+	u32 size;	// in instructions
+	u32 hash;
+};
+
+static const u32 recProfileMagic = 0x46504545; // "EEPF"
+static const u32 recProfileVersion = 1;
+static const uint recProfileMaxBlocks = 0x20000;
+
+static std::unordered_map<u32, recProfileBlock> s_profileBlocks; // by startpc
+static u32 s_profileCRC = 0;			// game of s_profileBlocks (0 = not profiling)
+static bool s_profilePreload = false;	// the entry point of the game was compiled
+
+static wxString recProfileFilename(u32 crc)
+{
+	return Path::Combine(g_Conf->Folders.Savestates, pxsFmt(L"%08X.eeblocks", crc));
+}
+
+// Only main memory (through its direct and kernel mirrors) is profiled
+static bool recProfileIsRam(u32 pc)
+{
+	// segments 0x0, 0x2, 0x3, 0x8, 0xa, 0xb, 0xc and 0xd (see recAlloc)
+	return ((0x3d0d >> (pc >> 28)) & 1) && (((pc >> 16) & 0xfff) < 0x200);
+}
+
+static u32 recProfileHash(u32 startpc, u32 size)
+{
+	const u32* code = (u32*)PSM(startpc);
+	if (!code) return 0;
+
+	u32 hash = 0x811c9dc5;
+	for (u32 i = 0; i < size; i++)
+		hash = (hash ^ code[i]) * 0x01000193;
+	return hash;
+}
+
+static void recProfileRecord(u32 startpc, u32 size)
+{
+	if (!s_profileCRC || !size || !recProfileIsRam(startpc)) return;
+	if (s_profileBlocks.size() >= recProfileMaxBlocks && !s_profileBlocks.count(startpc)) return;
+
+	recProfileBlock& block = s_profileBlocks[startpc];
+	block.startpc = startpc;
+	block.size = size;
+	block.hash = recProfileHash(startpc, size);
+}
+
+static void recProfileSave()
+{
+	if (!s_profileCRC || s_profileBlocks.empty()) return;
+
+	const wxString fname(recProfileFilename(s_profileCRC));
+	g_Conf->Folders.Savestates.Mkdir();
+	wxFFile fp(fname, L"wb");
+	if (!fp.IsOpened()) {
+		Console.Warning(L"EE block profile: cannot write %s", WX_STR(fname));
+		return;
+	}
+
+	u32 header[3] = { recProfileMagic, recProfileVersion, (u32)s_profileBlocks.size() };
+	fp.Write(header, sizeof(header));
+	for (const auto& it : s_profileBlocks)
+		fp.Write(&it.second, sizeof(recProfileBlock));
+}
+
+static void recProfileLoad(u32 crc, std::vector<recProfileBlock>& blocks)
+{
+	const wxString fname(recProfileFilename(crc));
+	if (!wxFileExists(fname)) return;
+
+	wxFFile fp(fname, L"rb");
+	u32 header[3];
+	if (!fp.IsOpened() || fp.Read(header, sizeof(header)) != sizeof(header)
+		|| header[0] != recProfileMagic || header[1] != recProfileVersion
+		|| header[2] > recProfileMaxBlocks) {
+		Console.Warning(L"EE block profile: %s is invalid, ignored", WX_STR(fname));
+		return;
+	}
+
+	blocks.resize(header[2]);
+	if (header[2] && fp.Read(blocks.data(), header[2] * sizeof(recProfileBlock)) != header[2] * sizeof(recProfileBlock)) {
+		Console.Warning(L"EE block profile: %s is truncated, ignored", WX_STR(fname));
+		blocks.clear();
+	}
+}
+
+// Starts the profile of the game whose entry point is being compiled
+static void recProfileStart()
+{
+	if (s_profileCRC != ElfCRC) {
+		recProfileSave();
+		s_profileBlocks.clear();
+	}
+
+	s_profileCRC = ElfCRC;
+	s_profilePreload = (ElfCRC != 0);
+}
+
+// Compiles the blocks of the profile. Uses at most half of the rec cache, so that the
+// game doesn't reset the recompiler right away.
+static void recProfilePreload()
+{
+	s_profilePreload = false;
+
+	std::vector<recProfileBlock> blocks;
+	recProfileLoad(s_profileCRC, blocks);
+	if (blocks.empty()) return;
+
+	// Compile in address order, like the game would mostly do
+	std::sort(blocks.begin(), blocks.end(),
+		[](const recProfileBlock& a, const recProfileBlock& b) { return a.startpc < b.startpc; });
+
+	const u8* limit = recPtr + (recMem->GetPtrEnd() - recPtr) / 2;
+	u64 start = GetCPUTicks();
+	uint compiled = 0, stale = 0;
+
+	for (const recProfileBlock& block : blocks) {
+		if (recPtr >= limit || eeRecNeedsReset) break;
+		if (!block.startpc || !recProfileIsRam(block.startpc)) continue;
+
+		if (recProfileHash(block.startpc, block.size) != block.hash) {
+			stale++;
+			continue;
+		}
+
+		s_profileBlocks[block.startpc] = block;
+		if (PC_GETBLOCK(block.startpc)->GetFnptr() != (uptr)JITCompile) continue;
+
+		recRecompile(block.startpc);
+		compiled++;
+	}
+
+	Console.WriteLn(Color_StrongBlack, "EE block profile: %u blocks compiled, %u stale (%.1f ms)",
+		compiled, stale, (double)(GetCPUTicks() - start) * 1000.0 / GetTickFrequency());
+}
+
 static void __fastcall recRecompile( const u32 startpc )
 {
 	u32 i = 0;
@@ -1687,6 +1892,9 @@ static void __fastcall recRecompile( const u32 startpc )
 		// Apply patch as soon as possible. Normally it is done in
 		// eeGameStarting but first block is already compiled.
 		doPlace0Patches();
+
+		if (EmuConfig.Cpu.Recompiler.EnableEEBlockProfile)
+			recProfileStart();
 	}
 
 	g_branch = 0;
@@ -1885,6 +2093,21 @@ StartRecomp:
 					break;
 				}
 			}
+			// shifts by an immediate (sll, srl, sra and their 64 bit versions), which the
+			// polling loops use to extract the bits of a register
+			else if (_Opcode_ == 0 && ((_Funct_ & 074) == 0 || (_Funct_ & 070) == 070) && (_Funct_ & 3) != 1)
+			{
+				if (loads & 1 << _Rt_) {
+					loads |= 1 << _Rd_;
+					continue;
+				}
+				else
+					reads |= 1 << _Rt_;
+				if (reads & 1 << _Rd_) {
+					s_nBlockFF = false;
+					break;
+				}
+			}
 			// loads
 			else if ((_Opcode_ & 070) == 040 || (_Opcode_ & 076) == 032 || _Opcode_ == 067)
 			{
@@ -1911,6 +2134,7 @@ StartRecomp:
 			}
 		}
 	}
+	s_nBlockFFStats = s_nBlockFF ? &s_waitLoops[startpc] : NULL;
 
 	// rec info //
 	{
@@ -2114,8 +2338,14 @@ StartRecomp:
 
 	pxAssert( (g_cpuHasConstReg&g_cpuFlushedConstReg) == g_cpuHasConstReg );
 
+	recProfileRecord(startpc, s_pCurBlockEx->size);
+
 	s_pCurBlock = NULL;
 	s_pCurBlockEx = NULL;
+
+	// The blocks of the profile are compiled once the entry point of the game is done
+	if (s_profilePreload)
+		recProfilePreload();
 }
 
 // The only *safe* way to throw exceptions from the context of recompiled code.
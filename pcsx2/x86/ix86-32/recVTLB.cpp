@@ -225,6 +225,23 @@ namespace vtlb_private
 	}
 }
 
+// ------------------------------------------------------------------------
+// Slow path profiler: the guest pc of the instruction being recompiled.
+//
+static u32 DynGen_ProfilePC()
+{
+	return g_recompilingDelaySlot ? pc : pc - 4;
+}
+
+// Counts a slow access whose address is known at compile time.
+static void DynGen_ProfileSlowMem( u32 paddr )
+{
+	if (!slowmem.enabled) return;
+
+	xADD( ptr32[&slowmem.pages[(paddr >> VTLB_PAGE_BITS) & (VTLB_PMAP_ITEMS - 1)]], 1 );
+	xADD( ptr32[vtlb_SlowMemProfileSite( DynGen_ProfilePC() )], 1 );
+}
+
 // ------------------------------------------------------------------------
 // allocate one page for our naked indirect dispatcher function.
 // this *must* be a full page, since we'll give it execution permission later.
@@ -248,7 +265,8 @@ static u8* GetIndirectDispatcherPtr( int mode, int operandsize, int sign = 0 )
 	// 7*64? 5 widths with two sign extension modes for 8 and 16 bit reads
 
 	// Gregory: a 32 bytes alignment is likely enough and more cache friendly
-	const int A = 32;
+	// (but the slow path profiler doesn't fit in 32 bytes)
+	const int A = 64;
 
 	return &m_IndirectDispatchers[(mode*(7*A)) + (sign*5*A) + (operandsize*A)];
 }
@@ -269,7 +287,17 @@ static void DynGen_IndirectDispatch( int mode, int bits, bool sign = false )
 		case 128:	szidx=4;	break;
 		jNO_DEFAULT;
 	}
-	xJS( GetIndirectDispatcherPtr( mode, szidx, sign ) );
+
+	if (slowmem.enabled)
+	{
+		// Counts the slow accesses of this instruction on its way to the dispatcher.
+		xForwardJNS8 direct;
+		xADD( ptr32[vtlb_SlowMemProfileSite( DynGen_ProfilePC() )], 1 );
+		xJMP( GetIndirectDispatcherPtr( mode, szidx, sign ) );
+		direct.SetTarget();
+	}
+	else
+		xJS( GetIndirectDispatcherPtr( mode, szidx, sign ) );
 }
 
 // ------------------------------------------------------------------------
@@ -280,6 +308,17 @@ static void DynGen_IndirectTlbDispatcher( int mode, int bits, bool sign )
 	xSUB( ecx, 0x80000000 );
 	xSUB( ecx, eax );
 
+	// Slow path profiler, by physical page.  The dispatchers are only generated once, so
+	// the profiler is checked at runtime.
+	xCMP( ptr32[&slowmem.enabled], 0 );
+	xForwardJZ8 skipProfile;
+	xPUSH( ecx );
+	xSHR( ecx, VTLB_PAGE_BITS );
+	xAND( ecx, VTLB_PMAP_ITEMS - 1 );
+	xADD( ptr32[(ecx*4) + slowmem.pages], 1 );
+	xPOP( ecx );
+	skipProfile.SetTarget();
+
 	// jump to the indirect handler, which is a __fastcall C++ function.
 	// [ecx is address, edx is data]
 	xFastCall(ptr32[(eax*4) + vtlbdata.RWFT[bits][mode]], ecx, edx);
@@ -405,6 +444,7 @@ void vtlb_DynGenRead64_Const( u32 bits, u32 addr_const )
 			case 128:	szidx=4;	break;
 		}
 
+		DynGen_ProfileSlowMem( paddr );
 		iFlushCall(FLUSH_FULLVTLB);
 		xFastCall( vtlbdata.RWFT[szidx][0][handler], paddr );
 	}
@@ -468,6 +508,7 @@ void vtlb_DynGenRead32_Const( u32 bits, bool sign, u32 addr_const )
 		}
 		else
 		{
+			DynGen_ProfileSlowMem( paddr );
 			iFlushCall(FLUSH_FULLVTLB);
 			xFastCall( vtlbdata.RWFT[szidx][0][handler], paddr );
 
@@ -558,6 +599,7 @@ void vtlb_DynGenWrite_Const( u32 bits, u32 addr_const )
 			case 128:   szidx=4; break;
 		}
 
+		DynGen_ProfileSlowMem( paddr );
 		iFlushCall(FLUSH_FULLVTLB);
 		xFastCall( vtlbdata.RWFT[szidx][1][handler], paddr, edx );
 	}
@@ -44,6 +44,10 @@ void mVUreserveCache(microVU& mVU) {
 	mVU.cache_reserve->ThrowIfNotOk();
 }
 
+#ifdef mVUbenchSearch
+static void mVUbenchmarkSearch();
+#endif
+
 // Only run this once per VU! ;)
 void mVUinit(microVU& mVU, uint vuIndex) {
 
@@ -69,13 +73,21 @@ void mVUinit(microVU& mVU, uint vuIndex) {
 	else mVU.dispCache = vu0_RecDispatchers;
 
 	mVU.regAlloc.reset(new microRegAlloc(mVU.index));
+
+#ifdef mVUbenchSearch
+	if (vuIndex) mVUbenchmarkSearch();
+#endif
 }
 
 // Resets Rec Data
 void mVUreset(microVU& mVU, bool resetReserve) {
 
 	// Restore reserve to uncommitted state
-	if (resetReserve) mVU.cache_reserve->Reset();
+	if (resetReserve) {
+		mVUprintCacheStats(mVU);
+		memzero(mVU.prog.stats);
+		mVU.cache_reserve->Reset();
+	}
 
 	HostSys::MemProtect(mVU.dispCache, mVUdispCacheSize, PageAccess_ReadWrite());
 	memset(mVU.dispCache, 0xcc, mVUdispCacheSize);
@@ -98,15 +110,22 @@ void mVUreset(microVU& mVU, bool resetReserve) {
 	mVU.prog.curFrame	=  0;
 
 	// Setup Dynarec Cache Limits for Each Program
+	// The cache is split in regions, each one keeps a safe-zone for the program
+	// which crosses its limit. A small cache is a single region, which is flushed
+	// entirely when full.
 	u8* z = mVU.cache;
+	mVU.prog.x86regions		= std::max(1u, std::min(mVUcacheRegions, mVU.cacheSize / (mVUcacheSafeZone * 4)));
+	mVU.prog.x86regionSize	= (uptr)mVU.cacheSize * _1mb / mVU.prog.x86regions;
+	mVU.prog.x86region		= 0;
 	mVU.prog.x86start	= z;
 	mVU.prog.x86ptr		= z;
-	mVU.prog.x86end		= z + ((mVU.cacheSize - mVUcacheSafeZone) * _1mb);
+	mVU.prog.x86end		= z + mVU.prog.x86regionSize - (mVUcacheSafeZone * _1mb);
 	//memset(mVU.prog.x86start, 0xcc, mVU.cacheSize*_1mb);
 
 	for(u32 i = 0; i < (mVU.progSize / 2); i++) {
 		if(!mVU.prog.prog[i]) {
-			mVU.prog.prog[i] = new std::deque<microProgram*>();
+			mVU.prog.prog[i]  = new std::deque<microProgram*>();
+			mVU.prog.index[i] = new microProgIndex();
 			continue;
 		}
 		std::deque<microProgram*>::iterator it(mVU.prog.prog[i]->begin());
@@ -127,6 +146,7 @@ void mVUreset(microVU& mVU, bool resetReserve) {
 // Free Allocated Resources
 void mVUclose(microVU& mVU) {
 
+	mVUprintCacheStats(mVU);
 	safe_delete  (mVU.cache_reserve);
 
 	// Delete Programs and Block Managers
@@ -137,7 +157,84 @@ void mVUclose(microVU& mVU) {
 			mVUdeleteProg(mVU, it[0]);
 		}
 		safe_delete(mVU.prog.prog[i]);
+		safe_delete(mVU.prog.index[i]);
+	}
+}
+
+// Moves to the next (oldest) cache region once the current one is full. The programs
+// with code in that region are deleted, they'll be recompiled when they run again.
+void mVUrecycleCache(microVU& mVU) {
+	const u32 region = (mVU.prog.x86region + 1) % mVU.prog.x86regions;
+	const u32 mask   = 1 << region;
+	u32 evicted = 0, kept = 0;
+
+	for (u32 i = 0; i < (mVU.progSize / 2); i++) {
+		microProgramList* list = mVU.prog.prog[i];
+		for (auto it = list->begin(); it != list->end(); ) {
+			if (it[0]->cacheRegions & mask) {
+				mVUdeleteProg(mVU, it[0]);
+				it = list->erase(it);
+				evicted++;
+			}
+			else {
+				++it;
+				kept++;
+			}
+		}
+		mVU.prog.quick[i].block = NULL;
+		mVU.prog.quick[i].prog  = NULL;
+	}
+
+	// JR/JALR targets are cached across programs, drop them before a deleted
+	// program's memory gets reused by a new one.
+	for (u32 i = 0; i < (mVU.progSize / 2); i++) {
+		for (auto prog : *mVU.prog.prog[i]) {
+			for (u32 j = 0; j < (mVU.progSize / 2); j++) {
+				if (prog->block[j]) prog->block[j]->clearJumpCaches();
+			}
+		}
 	}
+
+	mVU.prog.cleared	=  1;
+	mVU.prog.isSame		= -1;
+	mVU.prog.cur		= NULL;
+	mVU.prog.x86region	= region;
+	mVU.prog.x86ptr		= mVU.prog.x86start + region * mVU.prog.x86regionSize;
+	mVU.prog.x86end		= mVU.prog.x86ptr + mVU.prog.x86regionSize - (mVUcacheSafeZone * _1mb);
+
+	mVU.prog.stats.evicted += evicted;
+	mVU.prog.stats.recycled++;
+
+	Console.WriteLn(mVU.index ? Color_Orange : Color_Magenta,
+		"microVU%d: Program cache limit reached, recycling region %d/%d (%d programs evicted, %d kept).",
+		mVU.index, region, mVU.prog.x86regions, evicted, kept);
+}
+
+// Marks the cache regions used by the code in [start, end) as owned by the current program
+void mVUcacheRegionsUsed(microVU& mVU, u8* start, u8* end) {
+	if (end <= start) return;
+	u32 first = (start - mVU.prog.x86start) / mVU.prog.x86regionSize;
+	u32 last  = (end - 1 - mVU.prog.x86start) / mVU.prog.x86regionSize;
+	last = std::min(last, mVU.prog.x86regions - 1); // Code written in the last safe-zone
+	for (u32 i = first; i <= last; i++) {
+		mVU.prog.cur->cacheRegions |= 1 << i;
+	}
+}
+
+void mVUprintCacheStats(microVU& mVU) {
+	if (!mVU.prog.stats.compiled) return;
+	u32 programs = 0;
+	for (u32 i = 0; i < (mVU.progSize / 2); i++) {
+		if (mVU.prog.prog[i]) programs += mVU.prog.prog[i]->size();
+	}
+	const double used = (double)(mVU.prog.x86ptr - (mVU.prog.x86start + mVU.prog.x86region * mVU.prog.x86regionSize)) / (double)_1mb;
+	DevCon.WriteLn(mVU.index ? Color_Orange : Color_Magenta,
+		"microVU%d: Cache stats: %d programs compiled, %d evicted, %d live, %d regions recycled (region %d/%d, %3.1fmb used)",
+		mVU.index, mVU.prog.stats.compiled, mVU.prog.stats.evicted, programs, mVU.prog.stats.recycled,
+		mVU.prog.x86region, mVU.prog.x86regions, used);
+	DevCon.WriteLn(mVU.index ? Color_Orange : Color_Magenta,
+		"microVU%d: Search stats: %d lookups, %d full compares",
+		mVU.index, mVU.prog.stats.searches, mVU.prog.stats.compares);
 }
 
 // Clears Block Data in specified range
@@ -163,6 +260,12 @@ __ri void mVUvsyncUpdate(mV) {
 
 // Deletes a program
 __ri void mVUdeleteProg(microVU& mVU, microProgram*& prog) {
+	mVUindexRemove(mVU, *prog);
+	if (prog->indexDirty) {
+		microProgram** link = &mVU.prog.dirty;
+		while (*link != prog) link = &(*link)->nextDirty;
+		*link = prog->nextDirty;
+	}
 	for (u32 i = 0; i < (mVU.progSize / 2); i++) {
 		safe_delete(prog->block[i]);
 	}
@@ -177,13 +280,15 @@ __ri microProgram* mVUcreateProg(microVU& mVU, int startPC) {
 	prog->idx     = mVU.prog.total++;
 	prog->ranges  = new std::deque<microRange>();
 	prog->startPC = startPC;
+	mVU.prog.stats.compiled++;
 	mVUcacheProg(mVU, *prog); // Cache Micro Program
-	double cacheSize = (double)((uptr)mVU.prog.x86end - (uptr)mVU.prog.x86start);
-	double cacheUsed =((double)((uptr)mVU.prog.x86ptr - (uptr)mVU.prog.x86start)) / (double)_1mb;
-	double cachePerc =((double)((uptr)mVU.prog.x86ptr - (uptr)mVU.prog.x86start)) / cacheSize * 100;
+	u8*    regionStart = mVU.prog.x86start + mVU.prog.x86region * mVU.prog.x86regionSize;
+	double cacheSize = (double)((uptr)mVU.prog.x86end - (uptr)regionStart);
+	double cacheUsed =((double)((uptr)mVU.prog.x86ptr - (uptr)regionStart)) / (double)_1mb;
+	double cachePerc =((double)((uptr)mVU.prog.x86ptr - (uptr)regionStart)) / cacheSize * 100;
 	ConsoleColors c = mVU.index ? Color_Orange : Color_Magenta;
-	DevCon.WriteLn(c, "microVU%d: Cached Prog = [%03d] [PC=%04x] [List=%02d] (Cache=%3.3f%%) [%3.1fmb]",
-				   mVU.index, prog->idx, startPC*8, mVU.prog.prog[startPC]->size()+1, cachePerc, cacheUsed);
+	DevCon.WriteLn(c, "microVU%d: Cached Prog = [%03d] [PC=%04x] [List=%02d] (Region %d=%3.3f%%) [%3.1fmb]",
+				   mVU.index, prog->idx, startPC*8, mVU.prog.prog[startPC]->size()+1, mVU.prog.x86region, cachePerc, cacheUsed);
 	return prog;
 }
 
@@ -191,25 +296,100 @@ __ri microProgram* mVUcreateProg(microVU& mVU, int startPC) {
 __ri void mVUcacheProg(microVU& mVU, microProgram& prog) {
 	if (!mVU.index)	memcpy(prog.data, mVU.regs().Micro, 0x1000);
 	else			memcpy(prog.data, mVU.regs().Micro, 0x4000);
+	mVUindexDirty(mVU, prog);
 	mVUdumpProg(mVU, prog);
 }
 
+// Fingerprint of the micro memory covered by the ranges (same bytes as mVUcmpPartial
+// compares, clamped to the micro memory). 16 bytes are hashed per SSE2 step.
+u64 mVUhashRanges(const u8* mem, const std::deque<microRange>& ranges, u32 memSize) {
+	const __m128i key = _mm_set_epi32(0x165667b1, 0xd3a2646c, 0xfd7046c5, 0xb55a4f09);
+	__m128i acc = _mm_set_epi32(0x9e3779b1, 0x85ebca77, 0xc2b2ae3d, 0x27d4eb2f);
+
+	for (const microRange& range : ranges) {
+		if ((range.start < 0) || (range.end < 0)) continue; // Range still being recompiled
+		const u8* ptr = mem + range.start;
+		const u8* end = mem + std::min<u32>(range.end + 8, memSize);
+		for ( ; ptr < end; ptr += 16) {
+			__m128i data = (end - ptr >= 16) ? _mm_loadu_si128((const __m128i*)ptr) : _mm_loadl_epi64((const __m128i*)ptr);
+			__m128i dk   = _mm_xor_si128(data, key);
+			__m128i prod = _mm_mul_epu32(dk, _mm_shuffle_epi32(dk, _MM_SHUFFLE(0, 3, 0, 1)));
+			acc = _mm_add_epi64(acc, _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2)));
+			acc = _mm_add_epi64(acc, prod);
+			acc = _mm_xor_si128(acc, _mm_srli_epi64(acc, 47)); // Order of the data matters
+		}
+	}
+
+	u64 lanes[2];
+	_mm_storeu_si128((__m128i*)lanes, acc);
+	u64 hash = lanes[0] ^ (lanes[1] * 0x9e3779b97f4a7c15ull);
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdull;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+// Fingerprint of the ranges themselves
+static u64 mVUhashRangesKey(const std::deque<microRange>& ranges) {
+	u64 hash = 0xcbf29ce484222325ull;
+	for (const microRange& range : ranges) {
+		hash = (hash ^ (u32)range.start) * 0x100000001b3ull;
+		hash = (hash ^ (u32)range.end)   * 0x100000001b3ull;
+	}
+	return hash;
+}
+
 // Generate Hash for partial program based on compiled ranges...
 u64 mVUrangesHash(microVU& mVU, microProgram& prog) {
-	union {
-		u64 v64;
-		u32 v32[2];
-	} hash = {0};
+	return mVUhashRanges((u8*)prog.data, *prog.ranges, mVU.microMemSize);
+}
 
-	std::deque<microRange>::const_iterator it(prog.ranges->begin());
-	for ( ; it != prog.ranges->end(); ++it) {
-		if((it[0].start<0)||(it[0].end<0))  { DevCon.Error("microVU%d: Negative Range![%d][%d]", mVU.index, it[0].start, it[0].end); }
-		for(int i = it[0].start/4; i < it[0].end/4; i++) {
-			hash.v32[0] -= prog.data[i];
-			hash.v32[1] ^= prog.data[i];
+// Queues a program for (re)indexing, its data or its ranges are changing
+void mVUindexDirty(microVU& mVU, microProgram& prog) {
+	if (prog.indexDirty) return;
+	prog.indexDirty = true;
+	prog.nextDirty  = mVU.prog.dirty;
+	mVU.prog.dirty  = &prog;
+}
+
+void mVUindexRemove(microVU& mVU, microProgram& prog) {
+	if (!prog.indexed) return;
+	std::vector<microProgIndex::Group>& groups = mVU.prog.index[prog.startPC]->groups;
+	for (auto group = groups.begin(); group != groups.end(); ++group) {
+		if (group->key != prog.indexKey) continue;
+		auto range = group->progs.equal_range(prog.indexHash);
+		for (auto it = range.first; it != range.second; ++it) {
+			if (it->second == &prog) { group->progs.erase(it); break; }
+		}
+		if (group->progs.empty()) groups.erase(group);
+		break;
+	}
+	prog.indexed = false;
+}
+
+// Indexes the programs whose data or ranges changed
+void mVUindexUpdate(microVU& mVU) {
+	while (microProgram* prog = mVU.prog.dirty) {
+		mVU.prog.dirty   = prog->nextDirty;
+		prog->nextDirty  = NULL;
+		prog->indexDirty = false;
+
+		mVUindexRemove(mVU, *prog);
+		prog->indexKey  = mVUhashRangesKey(*prog->ranges);
+		prog->indexHash = mVUhashRanges((u8*)prog->data, *prog->ranges, mVU.microMemSize);
+		prog->indexed   = true;
+
+		std::vector<microProgIndex::Group>& groups = mVU.prog.index[prog->startPC]->groups;
+		auto group = std::find_if(groups.begin(), groups.end(),
+			[prog](const microProgIndex::Group& g) { return g.key == prog->indexKey; });
+		if (group == groups.end()) {
+			groups.push_back(microProgIndex::Group());
+			group = groups.end() - 1;
+			group->key    = prog->indexKey;
+			group->ranges = *prog->ranges;
 		}
+		group->progs.insert(std::make_pair(prog->indexHash, prog));
 	}
-	return hash.v64;
 }
 
 // Prints the ratio of unique programs to total programs
@@ -231,54 +411,117 @@ void mVUprintUniqueRatio(microVU& mVU) {
 }
 
 // Compare partial program by only checking compiled ranges...
-__ri bool mVUcmpPartial(microVU& mVU, microProgram& prog) {
+__ri bool mVUcmpPartial(microVU& mVU, microProgram& prog, const u8* micro) {
 	std::deque<microRange>::const_iterator it(prog.ranges->begin());
 	for ( ; it != prog.ranges->end(); ++it) {
 		if((it[0].start<0)||(it[0].end<0))  { DevCon.Error("microVU%d: Negative Range![%d][%d]", mVU.index, it[0].start, it[0].end); }
-		if (memcmp_mmx(cmpOffset(prog.data), cmpOffset(mVU.regs().Micro), ((it[0].end + 8)  -  it[0].start))) {
+		if (memcmp_mmx(cmpOffset(prog.data), cmpOffset(micro), ((it[0].end + 8)  -  it[0].start))) {
 			return 0;
 		}
 	}
 	return 1;
 }
 
-// Compare Cached microProgram to mVU.regs().Micro
-__fi bool mVUcmpProg(microVU& mVU, microProgram& prog, const bool cmpWholeProg) {
-	if ((cmpWholeProg && !memcmp_mmx((u8*)prog.data, mVU.regs().Micro, mVU.microMemSize))
-	|| (!cmpWholeProg && mVUcmpPartial(mVU, prog))) {
-		mVU.prog.cleared =  0;
-		mVU.prog.cur	 = &prog;
-		mVU.prog.isSame  =  cmpWholeProg ? 1 : -1;
-		return true;
+// Finds a cached program of startPC matching micro through the fingerprint index
+__fi microProgram* mVUindexSearch(microVU& mVU, u32 startPC, const u8* micro) {
+	mVUindexUpdate(mVU);
+	mVU.prog.stats.searches++;
+	for (const microProgIndex::Group& group : mVU.prog.index[startPC]->groups) {
+		u64  hash  = mVUhashRanges(micro, group.ranges, mVU.microMemSize);
+		auto range = group.progs.equal_range(hash);
+		for (auto it = range.first; it != range.second; ++it) {
+			mVU.prog.stats.compares++;
+			if (mVUcmpPartial(mVU, *it->second, micro)) return it->second;
+		}
 	}
-	return false;
+	return NULL;
 }
 
+#ifdef mVUbenchSearch
+// Times the lookup of a program among variants which only differ at the end of their
+// range (the worst case of a compare), with a linear scan and with the index.
+static void mVUbenchmarkSearch() {
+	static microVU bench; // Only its program index is used
+	bench.index			= 1;
+	bench.microMemSize	= 0x4000;
+	bench.progSize		= 0x4000 / 4;
+	bench.prog.index[0]	= new microProgIndex();
+
+	u8* micro = (u8*)_aligned_malloc(0x4000 + 16, 16);
+	for (u32 i = 0; i < 0x4000 + 16; i++) micro[i] = (u8)(i * 7);
+
+	const int loops = 2000;
+	for (int variants = 1; variants <= 256; variants *= 2) {
+		std::deque<microProgram*> list;
+		for (int v = 0; v < variants; v++) {
+			microProgram* prog = (microProgram*)_aligned_malloc(sizeof(microProgram), 64);
+			memset(prog, 0, sizeof(microProgram));
+			memcpy(prog->data, micro, 0x4000);
+			prog->data[0x2ff0 / 4] = variants - 1 - v; // The match is at the end of the list
+			prog->ranges = new std::deque<microRange>();
+			prog->ranges->push_back({0, 0x2ff8});
+			mVUindexDirty(bench, *prog);
+			list.push_back(prog);
+		}
+		*(u32*)&micro[0x2ff0] = 0;
+
+		u64 start = GetCPUTicks();
+		for (int i = 0; i < loops; i++) {
+			for (microProgram* prog : list) {
+				if (mVUcmpPartial(bench, *prog, micro)) break;
+			}
+		}
+		u64 linear = GetCPUTicks() - start;
+
+		mVUindexUpdate(bench);
+		start = GetCPUTicks();
+		for (int i = 0; i < loops; i++) {
+			if (!mVUindexSearch(bench, 0, micro)) Console.Error("microVU: Benchmark program not found!");
+		}
+		u64 indexed = GetCPUTicks() - start;
+
+		Console.WriteLn("microVU: Search of %3d variants: linear %8.2fus, indexed %6.2fus", variants,
+			(double)linear  * 1e6 / GetTickFrequency() / loops,
+			(double)indexed * 1e6 / GetTickFrequency() / loops);
+
+		for (microProgram* prog : list) mVUdeleteProg(bench, prog);
+	}
+
+	safe_delete(bench.prog.index[0]);
+	_aligned_free(micro);
+}
+#endif
+
 // Searches for Cached Micro Program and sets prog.cur to it (returns entry-point to program)
 _mVUt __fi void* mVUsearchProg(u32 startPC, uptr pState) {
 	microVU& mVU = mVUx;
 	microProgramQuick& quick = mVU.prog.quick[startPC/8];
 	microProgramList*  list  = mVU.prog.prog [startPC/8];
 	if(!quick.prog) { // If null, we need to search for new program
-		std::deque<microProgram*>::iterator it(list->begin());
-		for ( ; it != list->end(); ++it) {
-			bool b = mVUcmpProg(mVU, *it[0], 0);
-			if (EmuConfig.Gamefixes.ScarfaceIbit) {
-				if (isVU1 && ((((u32*)mVU.regs().Micro)[startPC / 4 + 1]) == 0x80200118) && ((((u32*)mVU.regs().Micro)[startPC / 4 + 3]) == 0x81000062)) {
-					b = true;
-					mVU.prog.cleared = 0;
-					mVU.prog.cur = it[0];
-					mVU.prog.isSame = 1;
-				}
+		microProgram* prog = NULL;
+		if (EmuConfig.Gamefixes.ScarfaceIbit && !list->empty()) {
+			if (isVU1 && ((((u32*)mVU.regs().Micro)[startPC / 4 + 1]) == 0x80200118) && ((((u32*)mVU.regs().Micro)[startPC / 4 + 3]) == 0x81000062)) {
+				prog = list->front();
+				mVU.prog.cleared = 0;
+				mVU.prog.cur = prog;
+				mVU.prog.isSame = 1;
 			}
-			if (b) {
-				quick.block = it[0]->block[startPC/8];
-				quick.prog  = it[0];
-				list->erase(it);
-				list->push_front(quick.prog);
-				return mVUentryGet(mVU, quick.block, startPC, pState);
+		}
+		if (!prog) {
+			prog = mVUindexSearch(mVU, startPC/8, mVU.regs().Micro);
+			if (prog) {
+				mVU.prog.cleared = 0;
+				mVU.prog.cur = prog;
+				mVU.prog.isSame = -1;
 			}
 		}
+		if (prog) {
+			quick.block = prog->block[startPC/8];
+			quick.prog  = prog;
+			list->erase(std::find(list->begin(), list->end(), prog));
+			list->push_front(prog);
+			return mVUentryGet(mVU, quick.block, startPC, pState);
+		}
 
 		// If cleared and program not found, make a new program instance
 		mVU.prog.cleared	= 0;
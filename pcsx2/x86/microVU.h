@@ -16,6 +16,7 @@
 #pragma once
 //#define mVUlogProg // Dumps MicroPrograms to \logs\*.html
 //#define mVUprofileProg // Shows opcode statistics in console
+//#define mVUbenchSearch // Times the microProgram lookup against the number of variants (in console)
 
 class AsciiFile;
 using namespace x86Emitter;
@@ -23,6 +24,7 @@ using namespace x86Emitter;
 #include <deque>
 #include <algorithm>
 #include <memory>
+#include <unordered_map>
 #include "Common.h"
 #include "VU.h"
 #include "MTVU.h"
@@ -37,6 +39,8 @@ using namespace x86Emitter;
 #include "microVU_Profiler.h"
 #include "Utilities/Perf.h"
 
+#define mProgSize (0x4000/4)
+
 struct microBlockLink {
 	microBlock		block;
 	microBlockLink*	next;
@@ -56,6 +60,16 @@ public:
 		fBlockEnd = fBlockList = NULL;
 	}
 	~microBlockManager() { reset(); }
+	void clearJumpCaches() { // The compiled code keeps a pointer to the arrays, so only their entries are reset
+		for(microBlockLink* linkI = qBlockList; linkI != NULL; linkI = linkI->next) {
+			if (!linkI->block.jumpCache) continue;
+			for (int i = 0; i < mProgSize/2; i++) linkI->block.jumpCache[i] = microJumpCache();
+		}
+		for(microBlockLink* linkI = fBlockList; linkI != NULL; linkI = linkI->next) {
+			if (!linkI->block.jumpCache) continue;
+			for (int i = 0; i < mProgSize/2; i++) linkI->block.jumpCache[i] = microJumpCache();
+		}
+	}
 	void reset() {
 		for(microBlockLink* linkI = qBlockList; linkI != NULL; ) {
 			microBlockLink* freeI = linkI;
@@ -142,25 +156,51 @@ struct microRange {
 	s32 end;   // End PC   (The opcode the block ends with)
 };
 
-#define mProgSize (0x4000/4)
 struct microProgram {
 	u32				   data [mProgSize];   // Holds a copy of the VU microProgram
 	microBlockManager* block[mProgSize/2]; // Array of Block Managers
 	std::deque<microRange>* ranges;			   // The ranges of the microProgram that have already been recompiled
 	u32 startPC; // Start PC of this program
 	int idx;	 // Program index
+	u32 cacheRegions; // Bitmask of the rec-cache regions holding code of this program
+	u64 indexKey;	  // Fingerprint of the ranges (group of the program in the microProgIndex)
+	u64 indexHash;	  // Fingerprint of the program data covered by the ranges
+	bool indexed;	  // Program is in the microProgIndex
+	bool indexDirty;  // Data or ranges changed since the program was indexed
+	microProgram* nextDirty; // Next program in the list of programs to re-index
 };
 
 typedef std::deque<microProgram*> microProgramList;
 
+// Programs of a startPC, grouped by their ranges. A lookup hashes the micro memory
+// once per group, only the programs with the same fingerprint are then compared.
+struct microProgIndex {
+	struct Group {
+		u64 key;						// Fingerprint of the ranges
+		std::deque<microRange> ranges;	// Ranges shared by the programs of the group
+		std::unordered_multimap<u64, microProgram*> progs; // Programs keyed by indexHash
+	};
+	std::vector<Group> groups;
+};
+
 struct microProgramQuick {
 	microBlockManager*    block; // Quick reference to valid microBlockManager for current startPC
 	microProgram*		  prog;	 // The microProgram who is the owner of 'block'
 };
 
+struct microCacheStats {
+	u32 compiled;	// microPrograms created (the recompiles of evicted programs included)
+	u32 evicted;	// microPrograms discarded when their cache region was recycled
+	u32 recycled;	// Cache regions recycled
+	u32 searches;	// microProgram lookups (quick reference missed)
+	u32 compares;	// Full compares run on a fingerprint match
+};
+
 struct microProgManager {
 	microIR<mProgSize>	IRinfo;				// IR information
 	microProgramList*	prog [mProgSize/2];	// List of microPrograms indexed by startPC values
+	microProgIndex*		index[mProgSize/2];	// Fingerprint index of the microPrograms of each startPC
+	microProgram*		dirty;				// Programs to re-index before the next lookup
 	microProgramQuick	quick[mProgSize/2];	// Quick reference to valid microPrograms for current execution
 	microProgram*		cur;				// Pointer to currently running MicroProgram
 	int					total;				// Total Number of valid MicroPrograms
@@ -169,7 +209,11 @@ struct microProgManager {
 	u32					curFrame;			// Frame Counter
 	u8*					x86ptr;				// Pointer to program's recompilation code
 	u8*					x86start;			// Start of program's rec-cache
-	u8*					x86end;				// Limit of program's rec-cache
+	u8*					x86end;				// Limit of the cache region being filled
+	u32					x86region;			// Cache region being filled (the next one is the oldest)
+	u32					x86regions;			// Number of cache regions
+	uptr				x86regionSize;		// Size of a cache region (in bytes)
+	microCacheStats		stats;				// Cache counters (since the last full reset)
 	microRegInfo		lpState;			// Pipeline state from where program left off (useful for continuing execution)
 };
 
@@ -177,6 +221,7 @@ static const uint mVUdispCacheSize	= __pagesize; // Dispatcher Cache Size (in by
 static const uint mVUcacheSafeZone	= 3;		  // Safe-Zone for program recompilation (in megabytes)
 static const uint mVU0cacheReserve	= 64;		  // mVU0 Reserve Cache Size (in megabytes)
 static const uint mVU1cacheReserve	= 64;		  // mVU1 Reserve Cache Size (in megabytes)
+static const uint mVUcacheRegions	= 4;		  // Max number of rec-cache regions (recycled oldest first when the cache is full)
 
 struct microVU {
 
@@ -238,6 +283,7 @@ int mVUdebugNow = 0;
 // Main Functions
 extern void  mVUclear(mV, u32, u32);
 extern void  mVUreset(microVU& mVU, bool resetReserve);
+extern void  mVUrecycleCache(microVU& mVU);
 extern void* mVUblockFetch(microVU& mVU, u32 startPC, uptr pState);
 _mVUt extern void* __fastcall mVUcompileJIT(u32 startPC, uptr ptr);
 
@@ -250,6 +296,11 @@ mVUop(mVUopL);
 // Private Functions
 extern void  mVUcacheProg (microVU& mVU, microProgram&  prog);
 extern void  mVUdeleteProg(microVU& mVU, microProgram*& prog);
+extern void  mVUcacheRegionsUsed(microVU& mVU, u8* start, u8* end);
+extern void  mVUprintCacheStats(microVU& mVU);
+extern void  mVUindexDirty(microVU& mVU, microProgram& prog);
+extern void  mVUindexRemove(microVU& mVU, microProgram& prog);
+extern void  mVUindexUpdate(microVU& mVU);
 _mVUt extern void* mVUsearchProg(u32 startPC, uptr pState);
 extern void* __fastcall mVUexecuteVU0(u32 startPC, u32 cycles);
 extern void* __fastcall mVUexecuteVU1(u32 startPC, u32 cycles);
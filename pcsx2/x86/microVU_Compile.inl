@@ -61,6 +61,7 @@ void mVUsetupRange(microVU& mVU, s32 pc, bool isStartPC) {
 	}
 
 	mVUcheckIsSame(mVU);
+	mVUindexDirty(mVU, mVUcurProg); // Ranges change below
 
 	if (isStartPC) {
 		microRange mRange = {pc, -1};
@@ -660,6 +661,7 @@ void* mVUcompile(microVU& mVU, u32 startPC, uptr pState) {
 
 perf_and_return:
 
+	mVUcacheRegionsUsed(mVU, thisPtr, x86Ptr);
 	Perf::vu.map((uptr)thisPtr, x86Ptr - thisPtr, startPC);
 
 	return thisPtr;
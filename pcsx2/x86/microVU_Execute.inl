@@ -145,10 +145,13 @@ _mVUt void mVUcleanUp() {
 
 	mVU.prog.x86ptr = x86Ptr;
 
-	if ((xGetPtr() < mVU.prog.x86start) || (xGetPtr() >= mVU.prog.x86end)) {
-		Console.WriteLn(vuIndex ? Color_Orange : Color_Magenta, "microVU%d: Program cache limit reached.", mVU.index);
+	if (xGetPtr() < mVU.prog.x86start) {
+		Console.WriteLn(vuIndex ? Color_Orange : Color_Magenta, "microVU%d: Program cache pointer out of range.", mVU.index);
 		mVUreset(mVU, false);
 	}
+	else if (xGetPtr() >= mVU.prog.x86end) {
+		mVUrecycleCache(mVU);
+	}
 
 	mVU.cycles = mVU.totalCycles - mVU.cycles;
 	mVU.regs().cycle += mVU.cycles;
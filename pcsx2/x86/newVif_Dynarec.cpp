@@ -20,9 +20,162 @@
 #include "PrecompiledHeader.h"
 #include "newVif_UnpackSSE.h"
 #include "MTVU.h"
+#include "AppConfig.h"
 #include "Utilities/Perf.h"
+#include <unordered_map>
+
+// --------------------------------------------------------------------------------------
+//  VIF unpack profile
+// --------------------------------------------------------------------------------------
+// Counts the unpack shapes (the keys of the nVifBlocks) used by a game, and saves them to a
+// profile of the game. When the game boots again, the shapes of the profile are compiled
+// up front instead of on the first frames which use them.
+
+struct dVifProfileShape
+{
+	u8  idx;
+	u8  _pad;
+	u16 hash_key;	// [upkType:num]
+	u32 key0;		// mask
+	u32 key1;		// [wl:cl:aligned:mode]
+	u32 count;		// unpacks
+};
+
+struct dVifShapeKey
+{
+	u32 hash_key;
+	u32 key0;
+	u32 key1;
+
+	bool operator==(const dVifShapeKey& right) const {
+		return hash_key == right.hash_key && key0 == right.key0 && key1 == right.key1;
+	}
+};
+
+struct dVifShapeHash
+{
+	size_t operator()(const dVifShapeKey& key) const {
+		return (key.hash_key * 0x9E3779B1u) ^ (key.key0 * 0x85EBCA77u) ^ key.key1;
+	}
+};
+
+typedef std::pair<dVifShapeKey, u32> dVifShapeCount;
+
+static const u32 dVifProfileMagic = 0x50464956; // "VIFP"
+static const u32 dVifProfileVersion = 1;
+static const uint dVifProfileMaxShapes = 0x4000;
+
+// One table per VIF, VIF1 unpacks on the VU1 thread when MTVU is enabled.
+static std::unordered_map<dVifShapeKey, u32, dVifShapeHash> s_vifShapes[2];
+static u32 s_vifProfileCRC = 0;	// game of s_vifShapes (0 = not profiling)
+
+static wxString dVifProfileFilename(u32 crc)
+{
+	return Path::Combine(g_Conf->Folders.Savestates, pxsFmt(L"%08X.vifblocks", crc));
+}
+
+static void dVifProfileRecord(int idx, const nVifBlock& block)
+{
+	const dVifShapeKey key = { block.hash_key, block.key0, block.key1 };
+	auto& shapes = s_vifShapes[idx];
+
+	auto it = shapes.find(key);
+	if (it != shapes.end()) {
+		if (it->second != 0xffffffff) it->second++;
+	}
+	else if (shapes.size() < dVifProfileMaxShapes)
+		shapes[key] = 1;
+}
+
+// Most used shapes first
+static std::vector<dVifShapeCount> dVifProfileSorted(int idx)
+{
+	std::vector<dVifShapeCount> shapes(s_vifShapes[idx].begin(), s_vifShapes[idx].end());
+	std::sort(shapes.begin(), shapes.end(),
+		[](const dVifShapeCount& a, const dVifShapeCount& b) { return a.second > b.second; });
+	return shapes;
+}
+
+static void dVifProfileSave()
+{
+	if (!s_vifProfileCRC || (s_vifShapes[0].empty() && s_vifShapes[1].empty())) return;
+
+	const wxString fname(dVifProfileFilename(s_vifProfileCRC));
+	g_Conf->Folders.Savestates.Mkdir();
+	wxFFile fp(fname, L"wb");
+	if (!fp.IsOpened()) {
+		Console.Warning(L"VIF unpack profile: cannot write %s", WX_STR(fname));
+		return;
+	}
+
+	u32 header[3] = { dVifProfileMagic, dVifProfileVersion, (u32)(s_vifShapes[0].size() + s_vifShapes[1].size()) };
+	fp.Write(header, sizeof(header));
+	for (int idx = 0; idx < 2; idx++) {
+		for (const auto& it : s_vifShapes[idx]) {
+			const dVifProfileShape shape = { (u8)idx, 0, (u16)it.first.hash_key, it.first.key0, it.first.key1, it.second };
+			fp.Write(&shape, sizeof(shape));
+		}
+	}
+}
+
+static void dVifProfileLoad(u32 crc)
+{
+	const wxString fname(dVifProfileFilename(crc));
+	if (!wxFileExists(fname)) return;
+
+	wxFFile fp(fname, L"rb");
+	u32 header[3];
+	if (!fp.IsOpened() || fp.Read(header, sizeof(header)) != sizeof(header)
+		|| header[0] != dVifProfileMagic || header[1] != dVifProfileVersion
+		|| header[2] > dVifProfileMaxShapes * 2) {
+		Console.Warning(L"VIF unpack profile: %s is invalid, ignored", WX_STR(fname));
+		return;
+	}
+
+	std::vector<dVifProfileShape> shapes(header[2]);
+	if (header[2] && fp.Read(shapes.data(), header[2] * sizeof(dVifProfileShape)) != header[2] * sizeof(dVifProfileShape)) {
+		Console.Warning(L"VIF unpack profile: %s is truncated, ignored", WX_STR(fname));
+		return;
+	}
+
+	for (const dVifProfileShape& shape : shapes) {
+		if (shape.idx > 1) continue;
+		const dVifShapeKey key = { shape.hash_key, shape.key0, shape.key1 };
+		s_vifShapes[shape.idx][key] = shape.count;
+	}
+}
+
+// Hit rate of the block cache since its last reset, and the shapes the game uses most
+// when it's profiled.  Goes to the devel log.
+static void dVifPrintStats(int idx) {
+	const HashBucket& bucket = nVif[idx].vifBlocks;
+	const HashBucketStats& s = bucket.stats();
+	if (!s.lookups) return;
+
+	u32 blocks, used, longest;
+	bucket.chain_stats(blocks, used, longest);
+
+	const u64 hits = s.lookups - s.misses;
+	DevCon.WriteLn(Color_Gray, "nVif%d: %llu unpacks, %.2f%% cache hits, %u blocks in %u buckets (longest chain %u, %.2f probes per hit)",
+		idx, s.lookups, hits * 100.0 / s.lookups, blocks, used, longest, hits ? (double)s.probes / hits : 0.0);
+
+	if (!s_vifProfileCRC) return;
+
+	const std::vector<dVifShapeCount> shapes(dVifProfileSorted(idx));
+	for (uint i = 0; i < std::min<size_t>(shapes.size(), 10); i++) {
+		nVifBlock block;
+		block.hash_key = shapes[i].first.hash_key;
+		block.key0 = shapes[i].first.key0;
+		block.key1 = shapes[i].first.key1;
+
+		DevCon.WriteLn(Color_Gray, "    %10u x [upkType=0x%02x][num=%3d][cl=%d][wl=%d][mode=%d][aligned=%d][mask=0x%08x]",
+			shapes[i].second, block.upkType, block.num, block.cl, block.wl, block.mode, block.aligned, block.mask);
+	}
+}
 
 static void recReset(int idx) {
+	dVifPrintStats(idx);
+
 	nVif[idx].vifBlocks.reset();
 
 	nVif[idx].recReserve->Reset();
@@ -49,6 +202,9 @@ void dVifClose(int idx) {
 }
 
 void dVifRelease(int idx) {
+	dVifPrintStats(idx);
+	if (idx == 1) dVifProfileSave();
+
 	dVifClose(idx);
 	safe_delete(nVif[idx].recReserve);
 }
@@ -298,6 +454,53 @@ _vifT __fi nVifBlock* dVifCompile(nVifBlock& block, bool isFill) {
 	return &block;
 }
 
+_vifT static uint dVifProfilePreload() {
+	nVifStruct& v = nVif[idx];
+
+	// Uses at most half of the rec cache, so that the game doesn't reset it right away.
+	const u8* limit = v.recWritePtr + (v.recReserve->GetPtrEnd() - v.recWritePtr) / 2;
+	uint compiled = 0;
+
+	for (const dVifShapeCount& shape : dVifProfileSorted(idx)) {
+		if (v.recWritePtr >= limit) break;
+
+		nVifBlock block;
+		block.hash_key = shape.first.hash_key;
+		block.key0 = shape.first.key0;
+		block.key1 = shape.first.key1;
+		if (v.vifBlocks.find(block)) continue;
+
+		const int wl = block.wl ? block.wl : 256;
+		dVifCompile<idx>(block, block.cl < wl);
+		compiled++;
+	}
+
+	return compiled;
+}
+
+// Starts the profile of the game which is booting, and compiles the shapes of its last
+// sessions.  The VU1 thread must be idle.
+void dVifProfileStart(u32 crc) {
+	if (!EmuConfig.Cpu.Recompiler.EnableVifProfile) crc = 0;
+
+	if (crc != s_vifProfileCRC) {
+		dVifProfileSave();
+		s_vifShapes[0].clear();
+		s_vifShapes[1].clear();
+
+		s_vifProfileCRC = crc;
+		if (crc) dVifProfileLoad(crc);
+	}
+
+	if (!crc || (s_vifShapes[0].empty() && s_vifShapes[1].empty())) return;
+
+	u64 start = GetCPUTicks();
+	uint compiled = dVifProfilePreload<0>() + dVifProfilePreload<1>();
+
+	Console.WriteLn(Color_StrongBlack, "VIF unpack profile: %u shapes compiled (%.1f ms)",
+		compiled, (double)(GetCPUTicks() - start) * 1000.0 / GetTickFrequency());
+}
+
 _vifT __fi void dVifUnpack(const u8* data, bool isFill) {
 
 	nVifStruct&   v       = nVif[idx];
@@ -341,6 +544,9 @@ _vifT __fi void dVifUnpack(const u8* data, bool isFill) {
 		b = dVifCompile<idx>(block, isFill);
 	}
 
+	if (unlikely(s_vifProfileCRC))
+		dVifProfileRecord(idx, block);
+
 	{ // Execute the block
 		const VURegs& VU         = vuRegs[idx];
 		const uint    vuMemLimit = idx ? 0x4000 : 0x1000;
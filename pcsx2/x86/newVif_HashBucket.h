@@ -48,6 +48,12 @@ union nVifBlock {
 // * to use a 16 bits move instead of an 'and' mask to compute the hashed key
 #define hSize 0x10000 // [usn*1:mask*1:upk*4:num*8] hash...
 
+struct HashBucketStats {
+	u64 lookups;
+	u64 misses;
+	u64 probes;		// blocks skipped in the chains before the hits
+};
+
 // HashBucket is a container which uses a built-in hash function
 // to perform quick searches. It is designed around the nVifBlock structure
 //
@@ -57,10 +63,12 @@ union nVifBlock {
 class HashBucket {
 protected:
 	std::array<nVifBlock*, hSize> m_bucket;
+	HashBucketStats m_stats;
 
 public:
 	HashBucket() {
 		m_bucket.fill(nullptr);
+		memzero(m_stats);
 	}
 
 	~HashBucket() { clear(); }
@@ -68,12 +76,18 @@ public:
 	__fi nVifBlock* find(const nVifBlock& dataPtr) {
 		nVifBlock* chainpos = m_bucket[dataPtr.hash_key];
 
+		m_stats.lookups++;
+
 		while (true) {
-			if (chainpos->key0 == dataPtr.key0 && chainpos->key1 == dataPtr.key1)
+			if (chainpos->key0 == dataPtr.key0 && chainpos->key1 == dataPtr.key1) {
+				m_stats.probes += chainpos - m_bucket[dataPtr.hash_key];
 				return chainpos;
+			}
 
-			if (chainpos->startPtr == 0)
+			if (chainpos->startPtr == 0) {
+				m_stats.misses++;
 				return nullptr;
+			}
 
 			chainpos++;
 		}
@@ -112,6 +126,24 @@ public:
 		return size;
 	}
 
+	const HashBucketStats& stats() const { return m_stats; }
+
+	// Walks all the buckets, only meant for the stats report.
+	void chain_stats(u32& blocks, u32& used, u32& longest) const {
+		blocks = used = longest = 0;
+
+		for (const nVifBlock* bucket : m_bucket) {
+			if (!bucket) continue;
+
+			u32 size = 0;
+			while (bucket[size].startPtr != 0) size++;
+
+			blocks += size;
+			used += (size != 0);
+			longest = std::max(longest, size);
+		}
+	}
+
 	void clear() {
 		for (auto& bucket : m_bucket)
 			safe_aligned_free(bucket);
@@ -119,6 +151,7 @@ public:
 
 	void reset() {
 		clear();
+		memzero(m_stats);
 
 		// Allocate an empty cell for all buckets
 		for (auto& bucket : m_bucket) {
@@ -66,6 +66,7 @@ static int s_vsync = 0;
 static bool s_exclusive = true;
 static const char *s_renderer_name = "";
 static const char *s_renderer_type = "";
+static bool s_headless = false; // set by the benchmark replayer, no window and no graphics API
 bool gsopen_done = false; // crash guard for GSgetTitleInfo2 and GSKeyEvent (replace with lock?)
 
 EXPORT_C_(uint32) PS2EgetLibType()
@@ -282,6 +283,12 @@ static int _GSopen(void** dsp, const char* title, GSRendererType renderer, int t
 					break;
 			}
 
+			if (s_headless)
+			{
+				wnds.clear();
+				wnds.push_back(std::make_shared<GSWndNull>());
+			}
+
 			int w = theApp.GetConfigI("ModeWidth");
 			int h = theApp.GetConfigI("ModeHeight");
 #if defined(__unix__)
@@ -349,7 +356,8 @@ static int _GSopen(void** dsp, const char* title, GSRendererType renderer, int t
 			break;
 		}
 
-		switch (renderer)
+		// Headless replays keep the selected renderer but pair it with the null device
+		switch (s_headless ? GSRendererType::Null : renderer)
 		{
 		default:
 #ifdef _WIN32
@@ -1078,12 +1086,7 @@ EXPORT_C GSReplay(HWND hwnd, HINSTANCE hinst, LPSTR lpszCmdLine, int nCmdShow)
 
 	Console console{"GSdx", true};
 
-	const std::string f{lpszCmdLine};
-	const bool is_xz = f.size() >= 4 && f.compare(f.size() - 3, 3, ".xz") == 0;
-
-	auto file = is_xz
-		? std::unique_ptr<GSDumpFile>{std::make_unique<GSDumpLzma>(lpszCmdLine, nullptr)}
-		: std::unique_ptr<GSDumpFile>{std::make_unique<GSDumpRaw>(lpszCmdLine, nullptr)};
+	auto file = GSDumpFile::Open(lpszCmdLine, nullptr);
 
 	GSinit();
 
@@ -1147,6 +1150,11 @@ EXPORT_C GSReplay(HWND hwnd, HINSTANCE hinst, LPSTR lpszCmdLine, int nCmdShow)
 			p.buff.resize(0x2000);
 			file->Read(p.buff.data(), 0x2000);
 			break;
+		case 4:
+			// Keyframe, only needed to start in the middle of the dump
+			file->Read(&p.size, 4);
+			file->Skip(p.size + 0x2000);
+			break;
 		}
 
 		return p;
@@ -1456,16 +1464,9 @@ EXPORT_C GSReplay(char* lpszCmdLine, int renderer)
 	if (s_gs->m_wnd == NULL) return;
 
 	{ // Read .gs content
-		std::string f(lpszCmdLine);
-		bool is_xz = (f.size() >= 4) && (f.compare(f.size()-3, 3, ".xz") == 0);
-		if (is_xz)
-			f.replace(f.end()-6, f.end(), "_repack.gs");
-		else
-			f.replace(f.end()-3, f.end(), "_repack.gs");
+		std::string f = GSDumpFile::RepackName(lpszCmdLine);
 
-		GSDumpFile* file = is_xz
-			? (GSDumpFile*) new GSDumpLzma(lpszCmdLine, repack_dump ? f.c_str() : nullptr)
-			: (GSDumpFile*) new GSDumpRaw(lpszCmdLine, repack_dump ? f.c_str() : nullptr);
+		auto file = GSDumpFile::Open(lpszCmdLine, repack_dump ? f.c_str() : nullptr);
 
 		uint32 crc;
 		file->Read(&crc, 4);
@@ -1527,6 +1528,13 @@ EXPORT_C GSReplay(char* lpszCmdLine, int renderer)
 
 				file->Read(&p->buff[0], 0x2000);
 
+				break;
+
+			case 4:
+				// Keyframe, only needed to start in the middle of the dump
+				file->Read(&p->size, 4);
+				file->Skip(p->size + 0x2000);
+
 				break;
 			}
 
@@ -1535,8 +1543,6 @@ EXPORT_C GSReplay(char* lpszCmdLine, int renderer)
 			if (repack_dump && frame_number > -finished)
 				break;
 		}
-
-		delete file;
 	}
 
 	sleep(2);
@@ -1622,4 +1628,419 @@ EXPORT_C GSReplay(char* lpszCmdLine, int renderer)
 	GSclose();
 	GSshutdown();
 }
+
+// Number of frames of a dump, from its index (-1 without index)
+EXPORT_C_(int) GSReplayFrameCount(char* lpszCmdLine)
+{
+	std::vector<GSDumpIndexEntry> index;
+	if (!GSDumpFile::ReadIndex(lpszCmdLine, index))
+		return -1;
+
+	return index.back().frame;
+}
+
+// Writes s as a JSON string, quotes included
+static void WriteJsonString(FILE* fp, const char* s)
+{
+	fputc('"', fp);
+
+	for(; *s; s++)
+	{
+		unsigned char c = (unsigned char)*s;
+
+		if(c == '"' || c == '\\') fprintf(fp, "\\%c", c);
+		else if(c < 0x20) fprintf(fp, "\\u%04x", c);
+		else fputc(c, fp);
+	}
+
+	fputc('"', fp);
+}
+
+// Headless benchmark replay. The dump is replayed `loops` times against the SW
+// or Null renderer with no window, every loop restarts from the dump's initial
+// freeze so frames are comparable, and per-frame wall time plus draw/prim/pixel
+// counts from GSPerfMon are written to `report` (.json, anything else is CSV).
+//
+// Only the frames [start_frame, start_frame + frame_count) are measured (a count
+// <= 0 runs to the end). With a frame index the replay starts from the closest
+// keyframe, otherwise from the beginning of the dump.
+EXPORT_C GSReplayBenchmark(char* lpszCmdLine, int renderer, int loops, char* report, int start_frame, int frame_count)
+{
+	GSRendererType m_renderer = static_cast<GSRendererType>(renderer);
+
+	if (m_renderer != GSRendererType::OGL_SW && m_renderer != GSRendererType::Null)
+	{
+		fprintf(stderr, "benchmark: renderer %d can't run headless, use %d (SW) or %d (Null)\n",
+				renderer, static_cast<int>(GSRendererType::OGL_SW), static_cast<int>(GSRendererType::Null));
+		return;
+	}
+
+	// Cleared on every return, a later GSopen of this process gets a window again
+	struct HeadlessScope
+	{
+		HeadlessScope() {s_headless = true;}
+		~HeadlessScope() {s_headless = false;}
+	} headless;
+
+	if (GSinit() != 0)
+	{
+		fprintf(stderr, "benchmark: failed to init GSdx\n");
+		return;
+	}
+
+	struct Packet {uint8 type, param; uint32 size, addr; std::vector<uint8> buff;};
+
+	std::vector<Packet> packets;
+	std::vector<uint8> buff;
+	std::vector<uint8> freeze;
+	uint8 regs[0x2000];
+	uint8 init_regs[0x2000];
+	int first_frame = 0; // frame of the initial freeze
+
+	GSsetBaseMem(regs);
+
+	s_vsync = 0;
+
+	void* hWnd = NULL;
+	if (_GSopen((void**)&hWnd, "", m_renderer) != 0)
+	{
+		fprintf(stderr, "benchmark: failed to GSopen\n");
+		GSshutdown();
+		return;
+	}
+
+	{ // Read .gs content
+		std::unique_ptr<GSDumpFile> file;
+
+		try
+		{
+			file = GSDumpFile::Open(lpszCmdLine, nullptr);
+		}
+		catch (...)
+		{
+			fprintf(stderr, "benchmark: failed to open %s\n", lpszCmdLine);
+			GSclose();
+			GSshutdown();
+			return;
+		}
+
+		uint32 crc;
+		file->Read(&crc, 4);
+		GSsetGameCRC(crc, 0);
+
+		uint32 size;
+		file->Read(&size, 4);
+		freeze.resize(size);
+		file->Read(freeze.data(), size);
+
+		file->Read(init_regs, 0x2000);
+
+		std::vector<GSDumpIndexEntry> index;
+		if (start_frame > 0 && GSDumpFile::ReadIndex(lpszCmdLine, index))
+		{
+			const GSDumpIndexEntry* key = nullptr;
+
+			for(const auto& e : index)
+				if (!(e.flags & GSDUMP_INDEX_END) && (int)e.frame <= start_frame)
+					key = &e;
+
+			if (key)
+			{
+				uint8 type = 0;
+
+				if (!file->Seek(*key) || !file->Read(&type, 1) || type != 4)
+				{
+					fprintf(stderr, "benchmark: bad keyframe for frame %u in %s\n", key->frame, lpszCmdLine);
+					GSclose();
+					GSshutdown();
+					return;
+				}
+
+				file->Read(&size, 4);
+				freeze.resize(size);
+				file->Read(freeze.data(), size);
+
+				file->Read(init_regs, 0x2000);
+
+				first_frame = key->frame;
+			}
+		}
+		else if (start_frame > 0)
+		{
+			fprintf(stderr, "benchmark: %s has no frame index, replaying from the first frame\n", lpszCmdLine);
+		}
+
+		int frame = first_frame;
+
+		uint8 type;
+		while(file->Read(&type, 1))
+		{
+			if (type == 4)
+			{
+				// The state is already there when replaying linearly
+				file->Read(&size, 4);
+				file->Skip(size + 0x2000);
+				continue;
+			}
+
+			Packet p;
+
+			p.type = type;
+
+			switch(type)
+			{
+			case 0:
+				file->Read(&p.param, 1);
+				file->Read(&p.size, 4);
+
+				switch(p.param)
+				{
+				case 0:
+					p.buff.resize(0x4000);
+					p.addr = 0x4000 - p.size;
+					file->Read(&p.buff[p.addr], p.size);
+					break;
+				case 1:
+				case 2:
+				case 3:
+					p.buff.resize(p.size);
+					file->Read(p.buff.data(), p.size);
+					break;
+				}
+
+				break;
+
+			case 1:
+				file->Read(&p.param, 1);
+				break;
+
+			case 2:
+				file->Read(&p.size, 4);
+				break;
+
+			case 3:
+				p.buff.resize(0x2000);
+				file->Read(p.buff.data(), 0x2000);
+				break;
+			}
+
+			packets.push_back(std::move(p));
+
+			if (type == 1 && ++frame >= start_frame + frame_count && frame_count > 0)
+				break;
+		}
+	}
+
+	struct FrameStat {int loop, frame; double ms, draw, prim, pixels, steal;};
+
+	std::vector<FrameStat> frames;
+	GSPerfMon& pm = s_gs->m_perfmon;
+
+	for(int loop = 0; loop < loops; loop++)
+	{
+		GSFreezeData fd;
+		fd.size = freeze.size();
+		fd.data = freeze.data();
+		GSfreeze(FREEZE_LOAD, &fd);
+
+		memcpy(regs, init_regs, 0x2000);
+
+		GSvsync(1);
+
+		int frame = first_frame;
+		double draw = pm.GetTotal(GSPerfMon::Draw);
+		double prim = pm.GetTotal(GSPerfMon::Prim);
+		double pixels = pm.GetTotal(GSPerfMon::Fillrate);
+		double steal = pm.GetTotal(GSPerfMon::Steal);
+		auto start = std::chrono::steady_clock::now();
+
+		for(auto& p : packets)
+		{
+			switch(p.type)
+			{
+				case 0:
+
+					switch(p.param)
+					{
+						case 0: GSgifTransfer1(p.buff.data(), p.addr); break;
+						case 1: GSgifTransfer2(p.buff.data(), p.size / 16); break;
+						case 2: GSgifTransfer3(p.buff.data(), p.size / 16); break;
+						case 3: GSgifTransfer(p.buff.data(), p.size / 16); break;
+					}
+
+					break;
+
+				case 1:
+				{
+					GSvsync(p.param);
+
+					auto now = std::chrono::steady_clock::now();
+
+					FrameStat fs;
+					fs.loop = loop;
+					fs.frame = frame++;
+					fs.ms = std::chrono::duration<double, std::milli>(now - start).count();
+					fs.draw = pm.GetTotal(GSPerfMon::Draw) - draw;
+					fs.prim = pm.GetTotal(GSPerfMon::Prim) - prim;
+					fs.pixels = pm.GetTotal(GSPerfMon::Fillrate) - pixels;
+					fs.steal = pm.GetTotal(GSPerfMon::Steal) - steal;
+
+					// Frames between the keyframe and the range only restore the state
+					if (fs.frame >= start_frame)
+						frames.push_back(fs);
+
+					draw += fs.draw;
+					prim += fs.prim;
+					pixels += fs.pixels;
+					steal += fs.steal;
+					start = now;
+
+					break;
+				}
+
+				case 2:
+
+					if(buff.size() < p.size) buff.resize(p.size);
+
+					GSreadFIFO2(buff.data(), p.size / 16);
+
+					break;
+
+				case 3:
+
+					memcpy(regs, p.buff.data(), 0x2000);
+
+					break;
+			}
+		}
+	}
+
+	// Busy share of every SW worker over the whole run, the gain of the rasterizer scheduling shows up here
+	std::vector<int> workers;
+	if (m_renderer == GSRendererType::OGL_SW)
+	{
+		int threads = std::min(theApp.GetConfigI("extrathreads"), GSPerfMon::WorkerDraw15 - GSPerfMon::WorkerDraw0 + 1);
+		for(int i = 0; i < threads; i++)
+			workers.push_back(pm.CPU(GSPerfMon::WorkerDraw0 + i, false));
+	}
+
+	GSclose();
+	GSshutdown();
+
+	if (frames.empty())
+	{
+		fprintf(stderr, "benchmark: %s has no frame\n", lpszCmdLine);
+		return;
+	}
+
+	std::vector<double> ms;
+	double total_ms = 0, total_draw = 0, total_prim = 0, total_pixels = 0, total_steal = 0;
+
+	for(const auto& fs : frames)
+	{
+		ms.push_back(fs.ms);
+		total_ms += fs.ms;
+		total_draw += fs.draw;
+		total_prim += fs.prim;
+		total_pixels += fs.pixels;
+		total_steal += fs.steal;
+	}
+
+	std::sort(ms.begin(), ms.end());
+
+	// Nearest-rank percentile
+	auto percentile = [&ms](double p) {
+		size_t rank = (size_t)std::ceil(p / 100.0 * ms.size());
+		return ms[std::min(std::max<size_t>(rank, 1), ms.size()) - 1];
+	};
+
+	const double n = (double)frames.size();
+	std::vector<std::pair<std::string, double>> stats = {
+		{"frames",   n},
+		{"total_ms", total_ms},
+		{"fps",      1000.0 * n / total_ms},
+		{"mean_ms",  total_ms / n},
+		{"min_ms",   ms.front()},
+		{"p50_ms",   percentile(50)},
+		{"p90_ms",   percentile(90)},
+		{"p95_ms",   percentile(95)},
+		{"p99_ms",   percentile(99)},
+		{"max_ms",   ms.back()},
+		{"draws_per_frame",  total_draw / n},
+		{"prims_per_frame",  total_prim / n},
+		{"pixels_per_frame", total_pixels / n},
+		{"steals_per_frame", total_steal / n},
+	};
+
+	for(size_t i = 0; i < workers.size(); i++)
+		stats.push_back({format("worker%d_util", (int)i), (double)workers[i]});
+
+	for(const auto& s : stats)
+		printf("%-16s %.3f\n", s.first.c_str(), s.second);
+
+	if (report == NULL || *report == 0)
+		return;
+
+	FILE* fp = fopen(report, "w");
+	if (fp == NULL)
+	{
+		fprintf(stderr, "benchmark: failed to write %s\n", report);
+		return;
+	}
+
+	std::string r(report);
+	bool is_json = (r.size() >= 5) && (r.compare(r.size()-5, 5, ".json") == 0);
+
+	if (is_json)
+	{
+		fprintf(fp, "{\n\t\"dump\": ");
+		WriteJsonString(fp, lpszCmdLine);
+		fprintf(fp, ",\n\t\"renderer\": %d,\n\t\"loops\": %d,\n", renderer, loops);
+
+		fprintf(fp, "\t\"summary\": {\n");
+		for(size_t i = 0; i < stats.size(); i++)
+			fprintf(fp, "\t\t\"%s\": %.3f%s\n", stats[i].first.c_str(), stats[i].second, i + 1 < stats.size() ? "," : "");
+		fprintf(fp, "\t},\n");
+
+		fprintf(fp, "\t\"frames\": [\n");
+		for(size_t i = 0; i < frames.size(); i++)
+		{
+			const FrameStat& fs = frames[i];
+			fprintf(fp, "\t\t{\"loop\": %d, \"frame\": %d, \"ms\": %.3f, \"draws\": %.0f, \"prims\": %.0f, \"pixels\": %.0f}%s\n",
+					fs.loop, fs.frame, fs.ms, fs.draw, fs.prim, fs.pixels, i + 1 < frames.size() ? "," : "");
+		}
+		fprintf(fp, "\t]\n}\n");
+	}
+	else
+	{
+		fprintf(fp, "loop,frame,ms,draws,prims,pixels\n");
+		for(const auto& fs : frames)
+			fprintf(fp, "%d,%d,%.3f,%.0f,%.0f,%.0f\n", fs.loop, fs.frame, fs.ms, fs.draw, fs.prim, fs.pixels);
+
+		// Summary block after a blank line, one stat per row
+		fprintf(fp, "\nstat,value\n");
+		for(const auto& s : stats)
+			fprintf(fp, "%s,%.3f\n", s.first.c_str(), s.second);
+	}
+
+	fclose(fp);
+}
+
+// Checks that the SW rasterizer threads (static and work-stealing dispatch) cover the same
+// pixels as a single thread.  Returns the number of failed modes, -1 if GSdx can't start.
+EXPORT_C_(int) GSRasterizerTest()
+{
+	if(GSinit() != 0)
+	{
+		return -1;
+	}
+
+	int failed = GSRasterizerSelfTest();
+
+	fprintf(stderr, "GSRasterizer self-test: %s\n", failed ? "FAILED" : "passed");
+
+	GSshutdown();
+
+	return failed;
+}
 #endif
@@ -21,20 +21,33 @@
 
 #include "stdafx.h"
 #include "GSDump.h"
+#include "GSdx.h"
 
 GSDumpBase::GSDumpBase(const std::string& fn)
 	: m_frames(0)
 	, m_extra_frames(2)
+	, m_keyframe_interval(theApp.GetConfigI("dump_keyframe_interval"))
+	, m_index(nullptr)
 {
 	m_gs = px_fopen(fn, "wb");
 	if (!m_gs)
 		fprintf(stderr, "GSDump: Error failed to open %s\n", fn.c_str());
+
+	if (m_gs && m_keyframe_interval > 0) {
+		m_index = px_fopen(fn + ".idx", "wb");
+		if (m_index)
+			fwrite(GSDUMP_INDEX_MAGIC, 1, 8, m_index);
+		else
+			fprintf(stderr, "GSDump: Error failed to open %s.idx\n", fn.c_str());
+	}
 }
 
 GSDumpBase::~GSDumpBase()
 {
 	if(m_gs)
 		fclose(m_gs);
+	if(m_index)
+		fclose(m_index);
 }
 
 void GSDumpBase::AddHeader(uint32 crc, const GSFreezeData& fd, const GSPrivRegSet* regs)
@@ -83,6 +96,43 @@ bool GSDumpBase::VSync(int field, bool last, const GSPrivRegSet* regs)
 	return (++m_frames & 1) == 0 && last && (m_extra_frames < 0);
 }
 
+bool GSDumpBase::KeyframeDue() const
+{
+	return m_index && (m_frames % m_keyframe_interval) == 0;
+}
+
+void GSDumpBase::Keyframe(const GSFreezeData& fd, const GSPrivRegSet* regs)
+{
+	BeginKeyframe(m_frames);
+
+	AppendRawData(4);
+	AppendRawData(&fd.size, 4);
+	AppendRawData(fd.data, fd.size);
+	AppendRawData(regs, sizeof(*regs));
+}
+
+void GSDumpBase::AddIndexEntry(uint32 frame, uint32 flags, uint64 offset, uint64 file_offset)
+{
+	if (!m_index)
+		return;
+
+	GSDumpIndexEntry entry = {frame, flags, offset, file_offset};
+	if (fwrite(&entry, sizeof(entry), 1, m_index) != 1)
+		fprintf(stderr, "GSDump: Error failed to write the index\n");
+}
+
+uint64 GSDumpBase::FileOffset()
+{
+	if (!m_gs)
+		return GSDUMP_NO_FILE_OFFSET;
+
+#ifdef _WIN32
+	return _ftelli64(m_gs);
+#else
+	return ftello(m_gs);
+#endif
+}
+
 void GSDumpBase::Write(const void *data, size_t size)
 {
 	if (!m_gs || size == 0)
@@ -103,6 +153,19 @@ GSDump::GSDump(const std::string& fn, uint32 crc, const GSFreezeData& fd, const
 	AddHeader(crc, fd, regs);
 }
 
+GSDump::~GSDump()
+{
+	uint64 end = FileOffset();
+	AddIndexEntry(Frames(), GSDUMP_INDEX_END, end, end);
+}
+
+void GSDump::BeginKeyframe(uint32 frame)
+{
+	// The file is the uncompressed dump
+	uint64 offset = FileOffset();
+	AddIndexEntry(frame, 0, offset, offset);
+}
+
 void GSDump::AppendRawData(const void *data, size_t size)
 {
 	Write(data, size);
@@ -113,12 +176,140 @@ void GSDump::AppendRawData(uint8 c)
 	Write(&c, 1);
 }
 
+//////////////////////////////////////////////////////////////////////
+// GSDumpCompressed implementation
+//////////////////////////////////////////////////////////////////////
+
+GSDumpCompressed::GSDumpCompressed(const std::string& fn)
+	: GSDumpBase(fn)
+	, m_size(0)
+	, m_exit(false)
+{
+	m_block.reserve(WRITER_BLOCK_SIZE);
+}
+
+GSDumpCompressed::~GSDumpCompressed()
+{
+	// Derived classes must have stopped the writer already
+	ASSERT(!m_writer.joinable());
+}
+
+void GSDumpCompressed::StartWriter()
+{
+	m_writer = std::thread(&GSDumpCompressed::WriterThread, this);
+}
+
+void GSDumpCompressed::StopWriter()
+{
+	if (!m_writer.joinable())
+		return;
+
+	QueueBlock();
+
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_exit = true;
+	}
+	m_pending_cv.notify_one();
+
+	m_writer.join();
+
+	AddIndexEntry(Frames(), GSDUMP_INDEX_END, m_size, GSDUMP_NO_FILE_OFFSET);
+}
+
+void GSDumpCompressed::QueueBlock(int keyframe)
+{
+	if (m_block.empty() && keyframe < 0)
+		return;
+
+	// The codec failed to initialize, nobody would consume the data
+	if (!m_writer.joinable()) {
+		m_block.clear();
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(m_lock);
+
+	m_free_cv.wait(lock, [this] { return m_pending.size() < WRITER_MAX_PENDING; });
+
+	m_pending.push_back({std::move(m_block), keyframe, m_size});
+
+	if (m_free.empty()) {
+		m_block = std::vector<uint8>();
+		m_block.reserve(WRITER_BLOCK_SIZE);
+	} else {
+		m_block = std::move(m_free.back());
+		m_free.pop_back();
+	}
+
+	lock.unlock();
+	m_pending_cv.notify_one();
+}
+
+void GSDumpCompressed::WriterThread()
+{
+	std::unique_lock<std::mutex> lock(m_lock);
+
+	while (true) {
+		m_pending_cv.wait(lock, [this] { return m_exit || !m_pending.empty(); });
+
+		if (m_pending.empty())
+			break;
+
+		Block block = std::move(m_pending.front());
+		m_pending.pop_front();
+
+		lock.unlock();
+		m_free_cv.notify_one();
+
+		if (!block.data.empty())
+			Compress(block.data.data(), block.data.size());
+
+		if (block.keyframe >= 0) {
+			uint64 file_offset = Restart() ? FileOffset() : GSDUMP_NO_FILE_OFFSET;
+			AddIndexEntry(block.keyframe, 0, block.offset, file_offset);
+		}
+
+		block.data.clear();
+
+		lock.lock();
+		m_free.push_back(std::move(block.data));
+	}
+
+	lock.unlock();
+
+	Finish();
+}
+
+void GSDumpCompressed::AppendRawData(const void *data, size_t size)
+{
+	size_t old_size = m_block.size();
+	m_block.resize(old_size + size);
+	memcpy(&m_block[old_size], data, size);
+	m_size += size;
+
+	if (m_block.size() >= WRITER_BLOCK_SIZE)
+		QueueBlock();
+}
+
+void GSDumpCompressed::AppendRawData(uint8 c)
+{
+	m_block.push_back(c);
+	m_size++;
+}
+
+void GSDumpCompressed::BeginKeyframe(uint32 frame)
+{
+	QueueBlock(frame);
+}
+
 //////////////////////////////////////////////////////////////////////
 // GSDumpXz implementation
 //////////////////////////////////////////////////////////////////////
 
 GSDumpXz::GSDumpXz(const std::string& fn, uint32 crc, const GSFreezeData& fd, const GSPrivRegSet* regs)
-	: GSDumpBase(fn + ".gs.xz")
+	: GSDumpCompressed(fn + ".gs.xz")
+	, m_out_buff(1024*1024)
 {
 	m_strm = LZMA_STREAM_INIT;
 	lzma_ret ret = lzma_easy_encoder(&m_strm, 6 /*level*/, LZMA_CHECK_CRC64);
@@ -127,68 +318,112 @@ GSDumpXz::GSDumpXz(const std::string& fn, uint32 crc, const GSFreezeData& fd, co
 		return;
 	}
 
+	StartWriter();
 	AddHeader(crc, fd, regs);
 }
 
 GSDumpXz::~GSDumpXz()
 {
-	Flush();
-
-	// Finish the stream
-	m_strm.avail_in = 0;
-	Compress(LZMA_FINISH, LZMA_STREAM_END);
+	StopWriter();
 
 	lzma_end(&m_strm);
 }
 
-void GSDumpXz::AppendRawData(const void *data, size_t size)
+void GSDumpXz::Compress(const uint8* data, size_t size)
 {
-	size_t old_size = m_in_buff.size();
-	m_in_buff.resize(old_size + size);
-	memcpy(&m_in_buff[old_size], data, size);
+	m_strm.next_in = data;
+	m_strm.avail_in = size;
 
-	// Enough data was accumulated, time to write/compress it.  If compression
-	// is enabled, it will freeze PCSX2. 1GB should be enough for long dump.
-	//
-	// Note: long dumps are currently not supported so this path won't be executed
-	if (m_in_buff.size() > 1024*1024*1024)
-		Flush();
+	Compress(LZMA_RUN, LZMA_OK);
 }
 
-void GSDumpXz::AppendRawData(uint8 c)
+void GSDumpXz::Finish()
 {
-	m_in_buff.push_back(c);
+	m_strm.avail_in = 0;
+	Compress(LZMA_FINISH, LZMA_STREAM_END);
 }
 
-void GSDumpXz::Flush()
+void GSDumpXz::Compress(lzma_action action, lzma_ret expected_status)
 {
-	if (m_in_buff.empty())
+	do {
+		m_strm.next_out = m_out_buff.data();
+		m_strm.avail_out = m_out_buff.size();
+
+		lzma_ret ret = lzma_code(&m_strm, action);
+
+		if (ret != expected_status) {
+			fprintf (stderr, "GSDumpXz: Error %d\n", (int) ret);
+			return;
+		}
+
+		size_t write_size = m_out_buff.size() - m_strm.avail_out;
+		Write(m_out_buff.data(), write_size);
+
+	} while (m_strm.avail_out == 0);
+}
+
+#ifdef ENABLE_ZSTD
+//////////////////////////////////////////////////////////////////////
+// GSDumpZst implementation
+//////////////////////////////////////////////////////////////////////
+
+GSDumpZst::GSDumpZst(const std::string& fn, uint32 crc, const GSFreezeData& fd, const GSPrivRegSet* regs)
+	: GSDumpCompressed(fn + ".gs.zst")
+	, m_out_buff(ZSTD_CStreamOutSize())
+{
+	m_strm = ZSTD_createCStream();
+	size_t ret = m_strm ? ZSTD_initCStream(m_strm, 3 /*level*/) : 1;
+	if (!m_strm || ZSTD_isError(ret)) {
+		fprintf(stderr, "GSDumpZst: Error initializing zstd encoder ! (%s)\n", m_strm ? ZSTD_getErrorName(ret) : "no memory");
 		return;
+	}
+
+	StartWriter();
+	AddHeader(crc, fd, regs);
+}
 
-	m_strm.next_in = m_in_buff.data();
-	m_strm.avail_in = m_in_buff.size();
+GSDumpZst::~GSDumpZst()
+{
+	StopWriter();
 
-	Compress(LZMA_RUN, LZMA_OK);
+	ZSTD_freeCStream(m_strm);
+}
 
-	m_in_buff.clear();
+void GSDumpZst::Compress(const uint8* data, size_t size)
+{
+	ZSTD_inBuffer in = {data, size, 0};
+	Compress(in, ZSTD_e_continue);
 }
 
-void GSDumpXz::Compress(lzma_action action, lzma_ret expected_status)
+void GSDumpZst::Finish()
+{
+	ZSTD_inBuffer in = {nullptr, 0, 0};
+	Compress(in, ZSTD_e_end);
+}
+
+bool GSDumpZst::Restart()
+{
+	// Following data goes to a new zstd frame
+	ZSTD_inBuffer in = {nullptr, 0, 0};
+	Compress(in, ZSTD_e_end);
+	return true;
+}
+
+void GSDumpZst::Compress(ZSTD_inBuffer& in, ZSTD_EndDirective action)
 {
-	std::vector<uint8> out_buff(1024*1024);
+	size_t remaining;
 	do {
-		m_strm.next_out = out_buff.data();
-		m_strm.avail_out = out_buff.size();
+		ZSTD_outBuffer out = {m_out_buff.data(), m_out_buff.size(), 0};
 
-		lzma_ret ret = lzma_code(&m_strm, action);
+		remaining = ZSTD_compressStream2(m_strm, &out, &in, action);
 
-		if (ret != expected_status) {
-			fprintf (stderr, "GSDumpXz: Error %d\n", (int) ret);
+		if (ZSTD_isError(remaining)) {
+			fprintf(stderr, "GSDumpZst: Error %s\n", ZSTD_getErrorName(remaining));
 			return;
 		}
 
-		size_t write_size = out_buff.size() - m_strm.avail_out;
-		Write(out_buff.data(), write_size);
+		Write(m_out_buff.data(), out.pos);
 
-	} while (m_strm.avail_out == 0);
+	} while (action == ZSTD_e_end ? remaining != 0 : in.pos < in.size);
 }
+#endif
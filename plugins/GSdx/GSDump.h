@@ -24,6 +24,13 @@
 #include "GS.h"
 #include "Renderers/SW/GSVertexSW.h"
 #include <lzma.h>
+#ifdef ENABLE_ZSTD
+#include <zstd.h>
+// ZSTD_compressStream2() and the ZSTD_c_* parameters came with zstd 1.4.0
+#if ZSTD_VERSION_NUMBER < 10400
+#error "GSdx needs zstd 1.4.0 or newer to write zstd dumps, reconfigure without zstd or update it"
+#endif
+#endif
 
 /*
 
@@ -42,20 +49,47 @@ ReadFIFO2 data (id == 2)
 Regs data (id == 3)
 - [PMODE/0x2000]
 
+Keyframe data (id == 4), after a VSync, every dump_keyframe_interval frames
+- [4/1] [state size/4] [state data/size] [PMODE/0x2000]
+
+When keyframes are enabled, the frame index is written next to the dump (<dump>.idx):
+- [GSDUMP_INDEX_MAGIC/8] [GSDumpIndexEntry] .. [GSDumpIndexEntry]
+
+The last entry (GSDUMP_INDEX_END) holds the frame count and the size of the dump.
+
 */
 
+#define GSDUMP_INDEX_MAGIC "GSDUMPIX"
+#define GSDUMP_INDEX_END 1
+#define GSDUMP_NO_FILE_OFFSET (~0ull)
+
+struct GSDumpIndexEntry
+{
+	uint32 frame;       // number of VSync packets before the keyframe
+	uint32 flags;
+	uint64 offset;      // position of the keyframe packet in the uncompressed dump
+	uint64 file_offset; // position in the file where decoding can restart, or GSDUMP_NO_FILE_OFFSET
+};
+
 class GSDumpBase
 {
 	int m_frames;
 	int m_extra_frames;
+	int m_keyframe_interval;
 	FILE* m_gs;
+	FILE* m_index;
 
 protected:
 	void AddHeader(uint32 crc, const GSFreezeData& fd, const GSPrivRegSet* regs);
 	void Write(const void *data, size_t size);
+	void AddIndexEntry(uint32 frame, uint32 flags, uint64 offset, uint64 file_offset);
+	uint64 FileOffset();
+	int Frames() const { return m_frames; }
 
 	virtual void AppendRawData(const void *data, size_t size) = 0;
 	virtual void AppendRawData(uint8 c) = 0;
+	// Called before the keyframe packet of frame is appended
+	virtual void BeginKeyframe(uint32 frame) = 0;
 
 public:
 	GSDumpBase(const std::string& fn);
@@ -64,30 +98,103 @@ public:
 	void ReadFIFO(uint32 size);
 	void Transfer(int index, const uint8* mem, size_t size);
 	bool VSync(int field, bool last, const GSPrivRegSet* regs);
+	bool KeyframeDue() const;
+	void Keyframe(const GSFreezeData& fd, const GSPrivRegSet* regs);
 };
 
 class GSDump final : public GSDumpBase
 {
 	void AppendRawData(const void *data, size_t size) final;
 	void AppendRawData(uint8 c) final;
+	void BeginKeyframe(uint32 frame) final;
 
 public:
 	GSDump(const std::string& fn, uint32 crc, const GSFreezeData& fd, const GSPrivRegSet* regs);
-	virtual ~GSDump() = default;
+	virtual ~GSDump();
 };
 
-class GSDumpXz final : public GSDumpBase
+// Base of the compressed dumps. The GS thread only appends to the current block, full
+// blocks are moved (not copied) to a writer thread which compresses and writes them.
+// Emptied blocks are handed back to the GS thread so their memory gets reused.
+class GSDumpCompressed : public GSDumpBase
 {
-	lzma_stream m_strm;
+	// Amount of data handed to the codec at once
+	static const size_t WRITER_BLOCK_SIZE = 4 * 1024 * 1024;
+	// Blocks waiting for the writer thread. If the codec can't keep up, the GS thread
+	// is stalled rather than letting the dump grow in memory.
+	static const size_t WRITER_MAX_PENDING = 64;
+
+	struct Block
+	{
+		std::vector<uint8> data;
+		int keyframe;  // a keyframe follows the data (frame number, or -1)
+		uint64 offset; // uncompressed size of the dump at the end of the block
+	};
+
+	std::vector<uint8> m_block;
+	uint64 m_size;
+
+	std::thread m_writer;
+	std::mutex m_lock;
+	std::condition_variable m_pending_cv;
+	std::condition_variable m_free_cv;
+	std::deque<Block> m_pending;
+	std::vector<std::vector<uint8>> m_free;
+	bool m_exit;
+
+	void WriterThread();
+	void QueueBlock(int keyframe = -1);
+	void AppendRawData(const void *data, size_t size) final;
+	void AppendRawData(uint8 c) final;
+	void BeginKeyframe(uint32 frame) final;
 
-	std::vector<uint8> m_in_buff;
+protected:
+	// Derived classes start the writer once their codec is ready, and must stop it in
+	// their destructor, before the codec goes away.
+	void StartWriter();
+	void StopWriter();
+
+	// Called from the writer thread only
+	virtual void Compress(const uint8* data, size_t size) = 0;
+	virtual void Finish() = 0;
+	// Ends the compressed stream so a decoder can start at the current file offset.
+	// Returns false if the codec can't do it.
+	virtual bool Restart() { return false; }
+
+public:
+	GSDumpCompressed(const std::string& fn);
+	virtual ~GSDumpCompressed();
+};
+
+class GSDumpXz final : public GSDumpCompressed
+{
+	lzma_stream m_strm;
+	std::vector<uint8> m_out_buff;
 
-	void Flush();
 	void Compress(lzma_action action, lzma_ret expected_status);
-	void AppendRawData(const void *data, size_t size);
-	void AppendRawData(uint8 c);
+	void Compress(const uint8* data, size_t size) final;
+	void Finish() final;
 
 public:
 	GSDumpXz(const std::string& fn, uint32 crc, const GSFreezeData& fd, const GSPrivRegSet* regs);
 	virtual ~GSDumpXz();
 };
+
+#ifdef ENABLE_ZSTD
+// Much faster than xz (at the cost of a bigger file), long dumps can be recorded
+// without slowing the game down.
+class GSDumpZst final : public GSDumpCompressed
+{
+	ZSTD_CStream* m_strm;
+	std::vector<uint8> m_out_buff;
+
+	void Compress(ZSTD_inBuffer& in, ZSTD_EndDirective action);
+	void Compress(const uint8* data, size_t size) final;
+	void Finish() final;
+	bool Restart() final;
+
+public:
+	GSDumpZst(const std::string& fn, uint32 crc, const GSFreezeData& fd, const GSPrivRegSet* regs);
+	virtual ~GSDumpZst();
+};
+#endif
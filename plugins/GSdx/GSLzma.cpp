@@ -20,6 +20,7 @@
 
 #include "stdafx.h"
 #include "GSLzma.h"
+#include "GSDump.h"
 
 GSDumpFile::GSDumpFile(char* filename, const char* repack_filename) {
 	m_fp = fopen(filename, "rb");
@@ -28,6 +29,8 @@ GSDumpFile::GSDumpFile(char* filename, const char* repack_filename) {
 		throw "BAD"; // Just exit the program
 	}
 
+	m_offset = 0;
+
 	m_repack_fp = nullptr;
 	if (repack_filename) {
 		m_repack_fp = fopen(repack_filename, "wb");
@@ -46,6 +49,81 @@ void GSDumpFile::Repack(void* ptr, size_t size) {
 
 }
 
+static bool SeekTo(FILE* fp, uint64 offset) {
+	clearerr(fp);
+#ifdef _WIN32
+	return _fseeki64(fp, offset, SEEK_SET) == 0;
+#else
+	return fseeko(fp, offset, SEEK_SET) == 0;
+#endif
+}
+
+bool GSDumpFile::Read(void* ptr, size_t size) {
+	if (!ReadData(ptr, size))
+		return false;
+
+	Repack(ptr, size);
+	m_offset += size;
+	return true;
+}
+
+bool GSDumpFile::Skip(size_t size) {
+	uint8 buff[4096];
+	while (size) {
+		size_t l = std::min(size, sizeof(buff));
+		if (!Read(buff, l))
+			return false;
+		size -= l;
+	}
+	return true;
+}
+
+bool GSDumpFile::Seek(const GSDumpIndexEntry& entry) {
+	if (entry.file_offset != GSDUMP_NO_FILE_OFFSET && SeekFile(entry.file_offset)) {
+		m_offset = entry.offset;
+		return true;
+	}
+
+	if (entry.offset < m_offset)
+		return false;
+
+	// Skipped data isn't repacked
+	uint8 buff[64 * 1024];
+	while (m_offset < entry.offset) {
+		size_t l = (size_t)std::min<uint64>(entry.offset - m_offset, sizeof(buff));
+		if (!ReadData(buff, l))
+			return false;
+		m_offset += l;
+	}
+	return true;
+}
+
+bool GSDumpFile::ReadIndex(const std::string& filename, std::vector<GSDumpIndexEntry>& index) {
+	index.clear();
+
+	FILE* fp = fopen((filename + ".idx").c_str(), "rb");
+	if (fp == nullptr)
+		return false;
+
+	char magic[8];
+	bool valid = fread(magic, 1, 8, fp) == 8 && memcmp(magic, GSDUMP_INDEX_MAGIC, 8) == 0;
+
+	GSDumpIndexEntry entry;
+	while (valid && fread(&entry, sizeof(entry), 1, fp) == 1)
+		index.push_back(entry);
+
+	fclose(fp);
+
+	// An index without its end entry comes from an interrupted dump
+	if (!valid || index.empty() || !(index.back().flags & GSDUMP_INDEX_END)) {
+		fprintf(stderr, "%s.idx is invalid, ignored\n", filename.c_str());
+		index.clear();
+		return false;
+	}
+
+	return true;
+}
+
 GSDumpFile::~GSDumpFile() {
 	if (m_fp)
 		fclose(m_fp);
@@ -53,6 +131,38 @@ GSDumpFile::~GSDumpFile() {
 		fclose(m_repack_fp);
 }
 
+static bool EndsWith(const std::string& s, const char* suffix) {
+	size_t len = strlen(suffix);
+	return s.size() >= len && s.compare(s.size() - len, len, suffix) == 0;
+}
+
+std::unique_ptr<GSDumpFile> GSDumpFile::Open(char* filename, const char* repack_filename) {
+	std::string f(filename);
+
+	if (EndsWith(f, ".xz"))
+		return std::unique_ptr<GSDumpFile>{std::make_unique<GSDumpLzma>(filename, repack_filename)};
+
+	if (EndsWith(f, ".zst")) {
+#ifdef ENABLE_ZSTD
+		return std::unique_ptr<GSDumpFile>{std::make_unique<GSDumpZstd>(filename, repack_filename)};
+#else
+		fprintf(stderr, "%s: GSdx was built without zstd support\n", filename);
+		throw "BAD"; // Just exit the program
+#endif
+	}
+
+	return std::unique_ptr<GSDumpFile>{std::make_unique<GSDumpRaw>(filename, repack_filename)};
+}
+
+std::string GSDumpFile::RepackName(const std::string& filename) {
+	std::string f(filename);
+	size_t ext = f.rfind(".gs");
+	if (ext == std::string::npos)
+		ext = f.size();
+
+	return f.replace(ext, std::string::npos, "_repack.gs");
+}
+
 /******************************************************************/
 GSDumpLzma::GSDumpLzma(char* filename, const char* repack_filename) : GSDumpFile(filename, repack_filename) {
 
@@ -114,10 +224,9 @@ bool GSDumpLzma::IsEof() {
 	return feof(m_fp) && m_avail == 0 && m_strm.avail_in == 0;
 }
 
-bool GSDumpLzma::Read(void* ptr, size_t size) {
+bool GSDumpLzma::ReadData(void* ptr, size_t size) {
 	size_t off = 0;
 	uint8_t* dst = (uint8_t*)ptr;
-	size_t full_size = size;
 	while (size && !IsEof()) {
 		if (m_avail == 0) {
 			Decompress();
@@ -131,12 +240,7 @@ bool GSDumpLzma::Read(void* ptr, size_t size) {
 		off     += l;
 	}
 
-	if (size == 0) {
-		Repack(ptr, full_size);
-		return true;
-	}
-
-	return false;
+	return size == 0;
 }
 
 GSDumpLzma::~GSDumpLzma() {
@@ -148,6 +252,100 @@ GSDumpLzma::~GSDumpLzma() {
 		_aligned_free(m_area);
 }
 
+/******************************************************************/
+#ifdef ENABLE_ZSTD
+
+GSDumpZstd::GSDumpZstd(char* filename, const char* repack_filename) : GSDumpFile(filename, repack_filename) {
+
+	m_strm = ZSTD_createDStream();
+
+	if (m_strm == nullptr || ZSTD_isError(ZSTD_initDStream(m_strm))) {
+		fprintf(stderr, "Error initializing the zstd decoder!\n");
+		throw "BAD"; // Just exit the program
+	}
+
+	m_buff_size = ZSTD_DStreamOutSize();
+	m_area      = (uint8_t*)_aligned_malloc(m_buff_size, 32);
+	m_inbuf     = (uint8_t*)_aligned_malloc(ZSTD_DStreamInSize(), 32);
+	m_avail     = 0;
+	m_start     = 0;
+	m_flushing  = false;
+
+	m_in = {m_inbuf, 0, 0};
+}
+
+void GSDumpZstd::Decompress() {
+	ZSTD_outBuffer out = {m_area, m_buff_size, 0};
+
+	// Nothing left in the input buffer. Read data from the file
+	if (m_in.pos == m_in.size && !feof(m_fp)) {
+		m_in.pos  = 0;
+		m_in.size = fread(m_inbuf, 1, ZSTD_DStreamInSize(), m_fp);
+
+		if (ferror(m_fp)) {
+			fprintf(stderr, "Read error: %s\n", strerror(errno));
+			throw "BAD"; // Just exit the program
+		}
+	}
+
+	size_t ret = ZSTD_decompressStream(m_strm, &out, &m_in);
+
+	if (ZSTD_isError(ret)) {
+		fprintf(stderr, "Decoder error: %s\n", ZSTD_getErrorName(ret));
+		throw "BAD"; // Just exit the program
+	}
+
+	m_start    = 0;
+	m_avail    = out.pos;
+	m_flushing = out.pos == out.size;
+}
+
+bool GSDumpZstd::IsEof() {
+	return feof(m_fp) && m_avail == 0 && m_in.pos == m_in.size && !m_flushing;
+}
+
+bool GSDumpZstd::ReadData(void* ptr, size_t size) {
+	size_t off = 0;
+	uint8_t* dst = (uint8_t*)ptr;
+	while (size && !IsEof()) {
+		if (m_avail == 0) {
+			Decompress();
+		}
+
+		size_t l = std::min(size, m_avail);
+		memcpy(dst + off, m_area+m_start, l);
+		m_avail -= l;
+		size    -= l;
+		m_start += l;
+		off     += l;
+	}
+
+	return size == 0;
+}
+
+bool GSDumpZstd::SeekFile(uint64 file_offset) {
+	// The dump writer starts a new zstd frame at each keyframe
+	if (!SeekTo(m_fp, file_offset) || ZSTD_isError(ZSTD_initDStream(m_strm)))
+		return false;
+
+	m_in.pos    = 0;
+	m_in.size   = 0;
+	m_avail     = 0;
+	m_start     = 0;
+	m_flushing  = false;
+	return true;
+}
+
+GSDumpZstd::~GSDumpZstd() {
+	ZSTD_freeDStream(m_strm);
+
+	if (m_inbuf)
+		_aligned_free(m_inbuf);
+	if (m_area)
+		_aligned_free(m_area);
+}
+
+#endif
 /******************************************************************/
 
 GSDumpRaw::GSDumpRaw(char* filename, const char* repack_filename) : GSDumpFile(filename, repack_filename) {
@@ -162,17 +360,16 @@ bool GSDumpRaw::IsEof() {
 	return !!feof(m_fp);
 }
 
-bool GSDumpRaw::Read(void* ptr, size_t size) {
+bool GSDumpRaw::ReadData(void* ptr, size_t size) {
 	size_t ret = fread(ptr, 1, size, m_fp);
 	if (ret != size && ferror(m_fp)) {
 		fprintf(stderr, "GSDumpRaw:: Read error (%zu/%zu)\n", ret, size);
 		throw "BAD"; // Just exit the program
 	}
 
-	if (ret == size) {
-		Repack(ptr, size);
-		return true;
-	}
+	return ret == size;
+}
 
-	return false;
+bool GSDumpRaw::SeekFile(uint64 file_offset) {
+	return SeekTo(m_fp, file_offset);
 }
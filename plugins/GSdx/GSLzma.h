@@ -19,21 +19,42 @@
  */
 
 #include <lzma.h>
+#ifdef ENABLE_ZSTD
+#include <zstd.h>
+#endif
+
+struct GSDumpIndexEntry;
 
 class GSDumpFile {
 	FILE*		m_repack_fp;
+	uint64		m_offset; // position in the uncompressed dump
+
+	void Repack(void* ptr, size_t size);
 
 	protected:
 	FILE*		m_fp;
 
-	void Repack(void* ptr, size_t size);
+	virtual bool ReadData(void* ptr, size_t size) = 0;
+	// Restarts the decoding at a file offset of the index, if the format allows it
+	virtual bool SeekFile(uint64 file_offset) { return false; }
 
 	public:
 	virtual bool IsEof() = 0;
-	virtual bool Read(void* ptr, size_t size) = 0;
+	bool Read(void* ptr, size_t size);
+	bool Skip(size_t size);
+	// Moves to a keyframe of the index. Without a file offset the dump is decompressed
+	// up to the keyframe, which only works forward.
+	bool Seek(const GSDumpIndexEntry& entry);
 
 	GSDumpFile(char* filename, const char* repack_filename);
 	virtual ~GSDumpFile();
+
+	// Picks the reader from the extension (.gs, .gs.xz or .gs.zst)
+	static std::unique_ptr<GSDumpFile> Open(char* filename, const char* repack_filename);
+	// Name of the uncompressed dump written by the repack mode
+	static std::string RepackName(const std::string& filename);
+	// Loads <filename>.idx, false if the dump has no index
+	static bool ReadIndex(const std::string& filename, std::vector<GSDumpIndexEntry>& index);
 };
 
 class GSDumpLzma : public GSDumpFile {
@@ -55,9 +76,36 @@ class GSDumpLzma : public GSDumpFile {
 	virtual ~GSDumpLzma();
 
 	bool IsEof() final;
-	bool Read(void* ptr, size_t size) final;
+	bool ReadData(void* ptr, size_t size) final;
 };
 
+#ifdef ENABLE_ZSTD
+class GSDumpZstd : public GSDumpFile {
+
+	ZSTD_DStream* m_strm;
+
+	size_t		m_buff_size;
+	uint8_t*	m_area;
+	uint8_t*	m_inbuf;
+
+	ZSTD_inBuffer	m_in;
+	bool		m_flushing; // the decoder may still hold some output
+	size_t		m_avail;
+	size_t		m_start;
+
+	void Decompress();
+	bool SeekFile(uint64 file_offset) final;
+
+	public:
+
+	GSDumpZstd(char* filename, const char* repack_filename);
+	virtual ~GSDumpZstd();
+
+	bool IsEof() final;
+	bool ReadData(void* ptr, size_t size) final;
+};
+#endif
+
 class GSDumpRaw : public GSDumpFile {
 
 	size_t		m_buff_size;
@@ -67,11 +115,13 @@ class GSDumpRaw : public GSDumpFile {
 	size_t		m_avail;
 	size_t		m_start;
 
+	bool SeekFile(uint64 file_offset) final;
+
 	public:
 
 	GSDumpRaw(char* filename, const char* repack_filename);
 	virtual ~GSDumpRaw() = default;
 
 	bool IsEof() final;
-	bool Read(void* ptr, size_t size) final;
+	bool ReadData(void* ptr, size_t size) final;
 };
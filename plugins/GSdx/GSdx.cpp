@@ -370,12 +370,17 @@ void GSdxApp::Init()
 	m_default_configuration["debug_opengl"]                               = "0";
 	m_default_configuration["disable_hw_gl_draw"]                         = "0";
 	m_default_configuration["dump"]                                       = "0";
+	m_default_configuration["dump_compression"]                           = "0";
+	m_default_configuration["dump_keyframe_interval"]                     = "0";
 	m_default_configuration["extrathreads"]                               = "2";
 	m_default_configuration["extrathreads_height"]                        = "4";
+	m_default_configuration["extrathreads_steal"]                         = "0";
 	m_default_configuration["filter"]                                     = std::to_string(static_cast<int8>(BiFiltering::PS2));
 	m_default_configuration["force_texture_clear"]                        = "0";
 	m_default_configuration["fxaa"]                                       = "0";
 	m_default_configuration["interlace"]                                  = "7";
+	m_default_configuration["jit_cache"]                                  = "0";
+	m_default_configuration["jit_cache_dir"]                              = ""; // GSdx_JitCache next to GSdx.ini
 	m_default_configuration["large_framebuffer"]                          = "1";
 	m_default_configuration["linear_present"]                             = "1";
 	m_default_configuration["MaxAnisotropy"]                              = "0";
@@ -518,6 +523,13 @@ void GSdxApp::SetConfigDir(const char* dir)
 	}
 }
 
+std::string GSdxApp::GetConfigDir()
+{
+	size_t i = m_ini.find_last_of("/\\");
+
+	return i != std::string::npos ? m_ini.substr(0, i) : ".";
+}
+
 std::string GSdxApp::GetConfigS(const char* entry)
 {
 	char buff[4096] = {0};
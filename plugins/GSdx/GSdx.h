@@ -68,6 +68,7 @@ public:
 	GSRendererType GetCurrentRendererType();
 
 	void SetConfigDir(const char* dir);
+	std::string GetConfigDir();
 
 	std::vector<GSSetting> m_gs_renderers;
 	std::vector<GSSetting> m_gs_interlace;
@@ -21,3 +21,189 @@
 
 #include "stdafx.h"
 #include "GSFunctionMap.h"
+#include "GSdx.h"
+#include "GSUtil.h"
+
+GSCodeCache g_code_cache;
+
+GSCodeCache::GSCodeCache()
+	: m_session(0)
+	, m_enabled(false)
+	, m_dirty(false)
+{
+}
+
+void GSCodeCache::Open()
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	m_enabled = theApp.GetConfigB("jit_cache");
+
+	if(!m_enabled)
+		return;
+
+	std::string id = format("%s %s %s", GSUtil::GetLibName(), __DATE__, __TIME__);
+	uint32 hash = crc32(0, (const Bytef*)id.c_str(), id.size());
+
+	std::string dir = theApp.GetConfigS("jit_cache_dir");
+
+	if(dir.empty())
+	{
+		dir = theApp.GetConfigDir() + "/GSdx_JitCache";
+	}
+
+	std::string path = dir + format("/GSdx_jit_%08x.txt", hash);
+
+	if(path == m_path)
+		return;
+
+	GSmkdir(dir.c_str());
+
+	m_path = path;
+	m_keys.clear();
+	m_session = 0;
+	m_dirty = false;
+
+	if(FILE* fp = fopen(m_path.c_str(), "r"))
+	{
+		char line[256];
+
+		while(fgets(line, sizeof(line), fp))
+		{
+			char name[64];
+			unsigned long long key;
+			unsigned int session = 0;
+
+			// the session stamp is missing from the files written before it was added
+
+			if(sscanf(line, "%63s %llx %u", name, &key, &session) >= 2)
+			{
+				m_keys[name][(uint64)key] = session;
+
+				m_session = std::max<uint32>(m_session, session);
+			}
+		}
+
+		fclose(fp);
+	}
+
+	m_session++;
+}
+
+void GSCodeCache::Save()
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	if(!m_enabled || !m_dirty)
+		return;
+
+	if(FILE* fp = fopen(m_path.c_str(), "w"))
+	{
+		for(auto& i : m_keys)
+		{
+			std::map<uint64, uint32>& keys = i.second;
+
+			for(auto j = keys.begin(); j != keys.end(); )
+			{
+				if(m_session - j->second >= MAX_AGE)
+				{
+					j = keys.erase(j);
+				}
+				else
+				{
+					j++;
+				}
+			}
+
+			if(keys.size() > MAX_KEYS)
+			{
+				std::vector<uint32> sessions;
+
+				sessions.reserve(keys.size());
+
+				for(const auto& j : keys)
+				{
+					sessions.push_back(j.second);
+				}
+
+				std::nth_element(sessions.begin(), sessions.begin() + MAX_KEYS - 1, sessions.end(), std::greater<uint32>());
+
+				// keeps the keys of the most recent sessions, the oldest one may only fit in part
+
+				uint32 oldest = sessions[MAX_KEYS - 1];
+				size_t n = std::count_if(sessions.begin(), sessions.end(), [oldest](uint32 s) {return s > oldest;});
+
+				for(auto j = keys.begin(); j != keys.end(); )
+				{
+					if(j->second < oldest || (j->second == oldest && n >= MAX_KEYS))
+					{
+						j = keys.erase(j);
+					}
+					else
+					{
+						if(j->second == oldest)
+						{
+							n++;
+						}
+
+						j++;
+					}
+				}
+			}
+
+			for(const auto& j : keys)
+			{
+				fprintf(fp, "%s %016llx %u\n", i.first.c_str(), (unsigned long long)j.first, j.second);
+			}
+		}
+
+		fclose(fp);
+
+		m_dirty = false;
+	}
+	else
+	{
+		fprintf(stderr, "GSdx: failed to write the JIT cache %s\n", m_path.c_str());
+	}
+}
+
+void GSCodeCache::Add(const std::string& name, uint64 key)
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	if(m_enabled)
+	{
+		uint32& session = m_keys[name][key];
+
+		if(session != m_session)
+		{
+			session = m_session;
+
+			m_dirty = true;
+		}
+	}
+}
+
+std::vector<uint64> GSCodeCache::Get(const std::string& name)
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	std::vector<uint64> keys;
+
+	if(m_enabled)
+	{
+		auto i = m_keys.find(name);
+
+		if(i != m_keys.end())
+		{
+			keys.reserve(i->second.size());
+
+			for(const auto& j : i->second)
+			{
+				keys.push_back(j.first);
+			}
+		}
+	}
+
+	return keys;
+}
@@ -142,6 +142,38 @@ public:
 	}
 };
 
+// Remembers the keys every named code generator map had to emit, so that the next session
+// can generate them while the renderer starts instead of in the middle of a frame.
+// Only the keys are persisted, the emitted code embeds the address of the scanline
+// data of its thread and of g_const, it can't be reused by another process.
+// The file name carries a hash of the build and of the ISA picked at runtime.
+// Every key is stamped with the last session that drew with it, keys left unused for
+// MAX_AGE sessions are dropped and each map keeps at most its MAX_KEYS most recent ones,
+// so the prewarm doesn't grow with every game that was ever run.
+
+class GSCodeCache
+{
+	enum {MAX_AGE = 16, MAX_KEYS = 2048};
+
+	std::mutex m_lock;
+	std::map<std::string, std::map<uint64, uint32>> m_keys;
+	std::string m_path;
+	uint32 m_session;
+	bool m_enabled;
+	bool m_dirty;
+
+public:
+	GSCodeCache();
+
+	void Open();
+	void Save();
+
+	void Add(const std::string& name, uint64 key);
+	std::vector<uint64> Get(const std::string& name);
+};
+
+extern GSCodeCache g_code_cache;
+
 class GSCodeGenerator : public Xbyak::CodeGenerator
 {
 protected:
@@ -162,6 +194,8 @@ class GSCodeGeneratorFunctionMap : public GSFunctionMap<KEY, VALUE>
 	std::unordered_map<uint64, VALUE> m_cgmap;
 	GSCodeBuffer m_cb;
 	size_t m_total_code_size;
+	bool m_cached;
+	bool m_prewarming;
 
 	enum {MAX_SIZE = 8192};
 
@@ -170,6 +204,8 @@ public:
 		: m_name(name)
 		, m_param(param)
 		, m_total_code_size(0)
+		, m_cached(false)
+		, m_prewarming(false)
 	{
 	}
 
@@ -184,6 +220,11 @@ public:
 	{
 		VALUE ret = NULL;
 
+		if(m_cached && !m_prewarming)
+		{
+			g_code_cache.Add(m_name, (uint64)key);
+		}
+
 		auto i = m_cgmap.find(key);
 
 		if(i != m_cgmap.end())
@@ -256,4 +297,21 @@ public:
 
 		return ret;
 	}
+
+	// Only the maps that are prewarmed record their keys in g_code_cache, nothing would
+	// read the keys of the others
+	void Prewarm()
+	{
+		m_cached = true;
+
+		// only the draws refresh the stamp of a key, not the prewarm
+		m_prewarming = true;
+
+		for(uint64 key : g_code_cache.Get(m_name))
+		{
+			GetDefaultFunction((KEY)key);
+		}
+
+		m_prewarming = false;
+	}
 };
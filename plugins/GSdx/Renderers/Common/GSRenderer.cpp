@@ -464,6 +464,10 @@ void GSRenderer::VSync(int field)
 
 			if (m_control_key)
 				m_dump = std::unique_ptr<GSDumpBase>(new GSDump(m_snapshot, m_crc, fd, m_regs));
+#ifdef ENABLE_ZSTD
+			else if (theApp.GetConfigI("dump_compression") == 1)
+				m_dump = std::unique_ptr<GSDumpBase>(new GSDumpZst(m_snapshot, m_crc, fd, m_regs));
+#endif
 			else
 				m_dump = std::unique_ptr<GSDumpBase>(new GSDumpXz(m_snapshot, m_crc, fd, m_regs));
 
@@ -480,7 +484,20 @@ void GSRenderer::VSync(int field)
 	else if(m_dump)
 	{
 		if(m_dump->VSync(field, !m_control_key, m_regs))
+		{
 			m_dump.reset();
+		}
+		else if(m_dump->KeyframeDue())
+		{
+			GSFreezeData fd = {0, nullptr};
+			Freeze(&fd, true);
+			fd.data = new uint8[fd.size];
+			Freeze(&fd, false);
+
+			m_dump->Keyframe(fd, m_regs);
+
+			delete [] fd.data;
+		}
 	}
 
 	// capture
@@ -29,6 +29,7 @@ std::unique_ptr<GSScanlineConstantData> g_const(new GSScanlineConstantData());
 GSDrawScanline::GSDrawScanline()
 	: m_sp_map("GSSetupPrim", &m_local)
 	, m_ds_map("GSDrawScanline", &m_local)
+	, m_prewarmed(false)
 {
 	memset(&m_local, 0, sizeof(m_local));
 
@@ -39,6 +40,16 @@ void GSDrawScanline::BeginDraw(const GSRasterizerData* data)
 {
 	memcpy(&m_global, &((const SharedData*)data)->global, sizeof(m_global));
 
+	if(!m_prewarmed)
+	{
+		// the generated code embeds m_global.vm, it's only valid from the first draw on
+
+		m_sp_map.Prewarm();
+		m_ds_map.Prewarm();
+
+		m_prewarmed = true;
+	}
+
 	if(m_global.sel.mmin && m_global.sel.lcm)
 	{
 #if defined(__GNUC__) && _M_SSE >= 0x501
@@ -53,7 +53,7 @@ GSRasterizer::GSRasterizer(IDrawScanline* ds, int id, int threads, GSPerfMon* pe
 	m_edge.count = 0;
 
 	int rows = (2048 >> m_thread_height) + 16;
-	m_scanline = (uint8*)_aligned_malloc(rows, 64);
+	m_myscanline = (uint8*)_aligned_malloc(rows, 64);
 
 	int row = 0;
 
@@ -61,14 +61,16 @@ GSRasterizer::GSRasterizer(IDrawScanline* ds, int id, int threads, GSPerfMon* pe
 	{
 		for(int i = 0; i < threads; i++, row++)
 		{
-			m_scanline[row] = i == id ? 1 : 0;
+			m_myscanline[row] = i == id ? 1 : 0;
 		}
 	}
+
+	m_scanline = m_myscanline;
 }
 
 GSRasterizer::~GSRasterizer()
 {
-	_aligned_free(m_scanline);
+	_aligned_free(m_myscanline);
 
 	if(m_edge.buff != NULL) vmfree(m_edge.buff, sizeof(GSVertexSW) * 2048);
 
@@ -573,9 +575,11 @@ void GSRasterizer::DrawTriangleSection(int top, int bottom, GSVertexSW2& edge, c
 
 		top++;
 
-		if(!IsOneOfMyScanlines(top))
+		if(top < bottom && !IsOneOfMyScanlines(top))
 		{
-			top += (m_threads - 1) << m_thread_height;
+			// the bands aren't always dealt out every m_threads (see GSRasterizerList),
+			// so look the next one up in the mask
+			top = FindMyNextScanline(top);
 		}
 	}
 
@@ -764,9 +768,11 @@ void GSRasterizer::DrawTriangleSection(int top, int bottom, GSVertexSW& edge, co
 
 		top++;
 
-		if(!IsOneOfMyScanlines(top))
+		if(top < bottom && !IsOneOfMyScanlines(top))
 		{
-			top += (m_threads - 1) << m_thread_height;
+			// the bands aren't always dealt out every m_threads (see GSRasterizerList),
+			// so look the next one up in the mask
+			top = FindMyNextScanline(top);
 		}
 	}
 
@@ -827,7 +833,9 @@ void GSRasterizer::DrawSprite(const GSVertexSW* vertex, const uint32* index)
 				m_pixels.actual += pixels;
 				m_pixels.total += pixels;
 
-				top = r.bottom + ((m_threads - 1) << m_thread_height);
+				if(r.bottom >= bottom) break;
+
+				top = FindMyNextScanline(r.bottom);
 			}
 		}
 
@@ -1137,36 +1145,189 @@ void GSRasterizer::DrawEdge(int pixels, int left, int top, const GSVertexSW& sca
 
 //
 
-GSRasterizerList::GSRasterizerList(int threads, GSPerfMon* perfmon)
+GSRasterizerList::GSRasterizerList(int threads, bool steal, GSPerfMon* perfmon)
 	: m_perfmon(perfmon)
+	, m_pending(0)
+	, m_steals(0)
+	, m_exit(false)
 {
 	m_thread_height = compute_best_thread_height(threads);
 
-	int rows = (2048 >> m_thread_height) + 16;
+	m_steal = steal && threads > 1;
+
+	// Four tiles per thread is enough to even out a full screen quad against a few
+	// small sprites without redoing the primitive setup for too many tiles
+	int tiles = m_steal ? threads * 4 : threads;
+
+	int rows = (2048 >> m_thread_height) + std::max<int>(tiles, 16);
 	m_scanline = (uint8*)_aligned_malloc(rows, 64);
 
 	int row = 0;
 
 	while(row < rows)
 	{
-		for(int i = 0; i < threads; i++, row++)
+		for(int i = 0; i < tiles && row < rows; i++, row++)
 		{
 			m_scanline[row] = (uint8)i;
 		}
 	}
+
+	if(m_steal)
+	{
+		m_tiles.resize(tiles);
+
+		for(int i = 0; i < tiles; i++)
+		{
+			GSTile& t = m_tiles[i];
+
+			t.scanline = (uint8*)_aligned_malloc(rows, 64);
+			t.busy = false;
+
+			for(row = 0; row < rows; row++)
+			{
+				t.scanline[row] = m_scanline[row] == i ? 1 : 0;
+			}
+		}
+	}
 }
 
 GSRasterizerList::~GSRasterizerList()
 {
+	if(m_steal)
+	{
+		{
+			std::lock_guard<std::mutex> l(m_lock);
+			m_exit = true;
+		}
+		m_notempty.notify_all();
+
+		for(auto& t : m_threads)
+		{
+			t.join();
+		}
+
+		for(auto& t : m_tiles)
+		{
+			_aligned_free(t.scanline);
+		}
+	}
+
 	_aligned_free(m_scanline);
 }
 
+void GSRasterizerList::StealThreadProc(int id)
+{
+	GSRasterizer& r = *m_r[id];
+
+	const int threads = (int)m_r.size();
+	const int tiles = (int)m_tiles.size();
+
+	std::vector<std::shared_ptr<GSRasterizerData>> batch;
+
+	std::unique_lock<std::mutex> l(m_lock);
+
+	while(true)
+	{
+		// own tiles first (same split as the static mode when the load is even), then the neighbours'
+
+		int tile = -1;
+
+		for(int i = 0; i < threads && tile < 0; i++)
+		{
+			for(int j = (id + i) % threads; j < tiles; j += threads)
+			{
+				if(!m_tiles[j].busy && !m_tiles[j].queue.empty())
+				{
+					tile = j;
+					break;
+				}
+			}
+		}
+
+		if(tile < 0)
+		{
+			if(m_exit)
+				return;
+
+			m_notempty.wait(l);
+
+			continue;
+		}
+
+		GSTile& t = m_tiles[tile];
+
+		t.busy = true;
+
+		if(tile % threads != id)
+		{
+			m_steals++;
+		}
+
+		r.SetScanlineMask(t.scanline);
+
+		while(!t.queue.empty())
+		{
+			batch.swap(t.queue);
+
+			int count = (int)batch.size();
+
+			l.unlock();
+
+			for(auto& data : batch)
+			{
+				r.Draw(data.get());
+			}
+
+			batch.clear();
+
+			l.lock();
+
+			m_pending -= count;
+		}
+
+		t.busy = false;
+
+		if(m_pending == 0)
+		{
+			m_empty.notify_all();
+		}
+	}
+}
+
 void GSRasterizerList::Queue(const std::shared_ptr<GSRasterizerData>& data)
 {
 	GSVector4i r = data->bbox.rintersect(data->scissor);
 
 	ASSERT(r.top >= 0 && r.top < 2048 && r.bottom >= 0 && r.bottom < 2048);
 
+	if(m_steal)
+	{
+		int top = r.top >> m_thread_height;
+		int bottom = std::min<int>((r.bottom + (1 << m_thread_height) - 1) >> m_thread_height, top + m_tiles.size());
+		int count = bottom - top;
+
+		if(count <= 0)
+			return;
+
+		{
+			std::lock_guard<std::mutex> l(m_lock);
+
+			while(top < bottom)
+			{
+				m_tiles[m_scanline[top++]].queue.push_back(data);
+			}
+
+			m_pending += count;
+		}
+
+		for(int i = std::min<int>(count, m_threads.size()); i > 0; i--)
+		{
+			m_notempty.notify_one();
+		}
+
+		return;
+	}
+
 	int top = r.top >> m_thread_height;
 	int bottom = std::min<int>((r.bottom + (1 << m_thread_height) - 1) >> m_thread_height, top + m_workers.size());
 
@@ -1180,17 +1341,41 @@ void GSRasterizerList::Sync()
 {
 	if(!IsSynced())
 	{
-		for(size_t i = 0; i < m_workers.size(); i++)
+		if(m_steal)
+		{
+			std::unique_lock<std::mutex> l(m_lock);
+
+			while(m_pending > 0)
+				m_empty.wait(l);
+		}
+		else
 		{
-			m_workers[i]->Wait();
+			for(size_t i = 0; i < m_workers.size(); i++)
+			{
+				m_workers[i]->Wait();
+			}
 		}
 
 		m_perfmon->Put(GSPerfMon::SyncPoint, 1);
 	}
+
+	if(m_steal)
+	{
+		std::lock_guard<std::mutex> l(m_lock);
+
+		m_perfmon->Put(GSPerfMon::Steal, m_steals);
+
+		m_steals = 0;
+	}
 }
 
 bool GSRasterizerList::IsSynced() const
 {
+	if(m_steal)
+	{
+		return m_pending == 0;
+	}
+
 	for(size_t i = 0; i < m_workers.size(); i++)
 	{
 		if(!m_workers[i]->IsEmpty())
@@ -1206,10 +1391,201 @@ int GSRasterizerList::GetPixels(bool reset)
 {
 	int pixels = 0;
 
-	for(size_t i = 0; i < m_workers.size(); i++)
+	for(size_t i = 0; i < m_r.size(); i++)
 	{
 		pixels += m_r[i]->GetPixels(reset);
 	}
 
 	return pixels;
 }
+
+// Self-test: a draw scanline which only counts how many times each pixel is drawn
+
+class GSDrawScanlineCoverage : public IDrawScanline
+{
+public:
+	static uint8* s_coverage;
+	static bool s_solid;
+
+	static void SetupPrimCoverage(const GSVertexSW* vertex, const uint32* index, const GSVertexSW& dscan)
+	{
+	}
+
+	static void __fastcall DrawScanlineCoverage(int pixels, int left, int top, const GSVertexSW& scan)
+	{
+		uint8* RESTRICT p = &s_coverage[top * 2048 + left];
+
+		for(int i = 0; i < pixels; i++)
+		{
+			p[i]++;
+		}
+	}
+
+	void DrawRectCoverage(const GSVector4i& r, const GSVertexSW& v)
+	{
+		for(int y = r.top; y < r.bottom; y++)
+		{
+			DrawScanlineCoverage(r.width(), r.left, y, v);
+		}
+	}
+
+	GSDrawScanlineCoverage()
+	{
+		m_sp = SetupPrimCoverage;
+		m_ds = DrawScanlineCoverage;
+		m_dr = s_solid ? static_cast<DrawRectPtr>(&GSDrawScanlineCoverage::DrawRectCoverage) : NULL;
+	}
+
+	void BeginDraw(const GSRasterizerData* data) {}
+	void EndDraw(uint64 frame, uint64 ticks, int actual, int total) {}
+
+#ifndef ENABLE_JIT_RASTERIZER
+
+	void SetupPrim(const GSVertexSW* vertex, const uint32* index, const GSVertexSW& dscan) {}
+	void DrawScanline(int pixels, int left, int top, const GSVertexSW& scan) {DrawScanlineCoverage(pixels, left, top, scan);}
+	void DrawEdge(int pixels, int left, int top, const GSVertexSW& scan) {}
+	void DrawRect(const GSVector4i& r, const GSVertexSW& v) {DrawRectCoverage(r, v);}
+
+#endif
+
+	void PrintStats() {}
+};
+
+uint8* GSDrawScanlineCoverage::s_coverage = NULL;
+bool GSDrawScanlineCoverage::s_solid = false;
+
+static void DrawCoverage(IRasterizer* r, GS_PRIM_CLASS primclass, const GSVertexSW* vertex, int count, int per_draw, uint8* coverage)
+{
+	memset(coverage, 0, 2048 * 2048);
+
+	GSDrawScanlineCoverage::s_coverage = coverage;
+
+	int n = primclass == GS_TRIANGLE_CLASS ? 3 : 2;
+
+	for(int i = 0; i < count; i += per_draw * n)
+	{
+		std::shared_ptr<GSRasterizerData> data(new GSRasterizerData());
+
+		data->primclass = primclass;
+		data->vertex = const_cast<GSVertexSW*>(&vertex[i]);
+		data->vertex_count = std::min<int>(per_draw * n, count - i);
+		data->scissor = GSVector4i(0, 0, 1024, 1024);
+
+		GSVector4 tl = data->vertex[0].p;
+		GSVector4 br = data->vertex[0].p;
+
+		for(int j = 1; j < data->vertex_count; j++)
+		{
+			tl = tl.min(data->vertex[j].p);
+			br = br.max(data->vertex[j].p);
+		}
+
+		data->bbox = GSVector4i(tl.xyxy(br).floor()).add32(GSVector4i(0, 0, 1, 1)).rintersect(data->scissor);
+
+		r->Queue(data);
+	}
+
+	r->Sync();
+}
+
+int GSRasterizerSelfTest()
+{
+	// Triangles and sprites of all heights, with their tops and bottoms anywhere in a band
+
+	const int count = 600;
+
+	GSVertexSW* tri = (GSVertexSW*)_aligned_malloc(sizeof(GSVertexSW) * count * 3, 32);
+	GSVertexSW* sprite = (GSVertexSW*)_aligned_malloc(sizeof(GSVertexSW) * count * 2, 32);
+
+	uint32 seed = 1;
+
+	auto rnd = [&seed](int n) -> float
+	{
+		seed = seed * 1103515245 + 12345;
+
+		return (float)((seed >> 8) % (n * 16)) / 16;
+	};
+
+	for(int i = 0; i < count * 3; i++)
+	{
+		tri[i] = GSVertexSW::zero();
+		tri[i].p = GSVector4(rnd(1024), i % 3 == 1 ? rnd(64) + tri[i - 1].p.y : rnd(1024), 0.0f, 0.0f);
+	}
+
+	for(int i = 0; i < count * 2; i += 2)
+	{
+		float x = rnd(960);
+		float y = rnd(960);
+
+		sprite[i] = GSVertexSW::zero();
+		sprite[i].p = GSVector4(x, y, 0.0f, 0.0f);
+		sprite[i + 1] = GSVertexSW::zero();
+		sprite[i + 1].p = GSVector4(x + rnd(64), y + (i % 3 == 0 ? rnd(512) : rnd(32)), 0.0f, 0.0f);
+	}
+
+	uint8* expected = (uint8*)_aligned_malloc(2048 * 2048, 32);
+	uint8* actual = (uint8*)_aligned_malloc(2048 * 2048, 32);
+
+	static const struct {int threads; bool steal;} modes[] = {{3, false}, {4, false}, {2, true}, {3, true}, {4, true}, {8, true}};
+
+	GSPerfMon perfmon;
+
+	int failed = 0;
+
+	for(int solid = 0; solid < 2; solid++)
+	{
+		GSDrawScanlineCoverage::s_solid = solid != 0;
+
+		for(int prim = 0; prim < 2; prim++)
+		{
+			GS_PRIM_CLASS primclass = prim == 0 ? GS_TRIANGLE_CLASS : GS_SPRITE_CLASS;
+			const GSVertexSW* vertex = prim == 0 ? tri : sprite;
+			int vertex_count = prim == 0 ? count * 3 : count * 2;
+
+			if(primclass == GS_TRIANGLE_CLASS && solid)
+			{
+				continue;
+			}
+
+			IRasterizer* r = GSRasterizerList::Create<GSDrawScanlineCoverage>(0, false, &perfmon);
+			DrawCoverage(r, primclass, vertex, vertex_count, 1, expected);
+			delete r;
+
+			for(const auto& mode : modes)
+			{
+				r = GSRasterizerList::Create<GSDrawScanlineCoverage>(mode.threads, mode.steal, &perfmon);
+
+				// one primitive per draw keeps the tiles busy and the workers stealing, then a few
+				// primitives per draw for the setup shared between the bands
+
+				for(int per_draw = 1; per_draw <= 8; per_draw *= 8)
+				{
+					DrawCoverage(r, primclass, vertex, vertex_count, per_draw, actual);
+
+					if(memcmp(expected, actual, 2048 * 2048) != 0)
+					{
+						int i = 0;
+
+						while(expected[i] == actual[i]) i++;
+
+						fprintf(stderr, "GSRasterizer: %s%s, %d threads%s, %d per draw: pixel %d,%d drawn %d times instead of %d\n",
+							primclass == GS_TRIANGLE_CLASS ? "triangles" : "sprites", solid ? " (solid rect)" : "",
+							mode.threads, mode.steal ? " (work-stealing)" : "", per_draw,
+							i % 2048, i / 2048, actual[i], expected[i]);
+
+						failed++;
+					}
+				}
+
+				delete r;
+			}
+		}
+	}
+
+	_aligned_free(actual);
+	_aligned_free(expected);
+	_aligned_free(sprite);
+	_aligned_free(tri);
+
+	return failed;
+}
@@ -130,7 +130,8 @@ protected:
 	int m_id;
 	int m_threads;
 	int m_thread_height;
-	uint8* m_scanline;
+	uint8* m_myscanline;
+	const uint8* m_scanline;
 	GSVector4i m_scissor;
 	GSVector4 m_fscissor_x;
 	GSVector4 m_fscissor_y;
@@ -167,6 +168,9 @@ public:
 	__forceinline bool IsOneOfMyScanlines(int top, int bottom) const;
 	__forceinline int FindMyNextScanline(int top) const;
 
+	// NULL restores the scanlines this rasterizer was created for
+	void SetScanlineMask(const uint8* scanline) {m_scanline = scanline != NULL ? scanline : m_myscanline;}
+
 	void Draw(GSRasterizerData* data);
 
 	// IRasterizer
@@ -183,6 +187,17 @@ class GSRasterizerList : public IRasterizer
 protected:
 	using GSWorker = GSJobQueue<std::shared_ptr<GSRasterizerData>, 65536>;
 
+	// Work-stealing mode: the scanline bands are interleaved over more tiles than threads,
+	// every tile keeps its jobs in order and is drawn by one worker at a time, but any idle
+	// worker may pick up a tile that isn't its own.
+
+	struct GSTile
+	{
+		std::vector<std::shared_ptr<GSRasterizerData>> queue;
+		uint8* scanline;
+		bool busy;
+	};
+
 	GSPerfMon* m_perfmon;
 	// Worker threads depend on the rasterizers, so don't change the order.
 	std::vector<std::unique_ptr<GSRasterizer>> m_r;
@@ -190,12 +205,24 @@ protected:
 	uint8* m_scanline;
 	int m_thread_height;
 
-	GSRasterizerList(int threads, GSPerfMon* perfmon);
+	bool m_steal;
+	std::vector<GSTile> m_tiles;
+	std::vector<std::thread> m_threads;
+	std::mutex m_lock;
+	std::condition_variable m_notempty;
+	std::condition_variable m_empty;
+	std::atomic<int> m_pending;
+	int m_steals;
+	bool m_exit;
+
+	GSRasterizerList(int threads, bool steal, GSPerfMon* perfmon);
+
+	void StealThreadProc(int id);
 
 public:
 	virtual ~GSRasterizerList();
 
-	template<class DS> static IRasterizer* Create(int threads, GSPerfMon* perfmon)
+	template<class DS> static IRasterizer* Create(int threads, bool steal, GSPerfMon* perfmon)
 	{
 		threads = std::max<int>(threads, 0);
 
@@ -204,14 +231,25 @@ public:
 			return new GSRasterizer(new DS(), 0, 1, perfmon);
 		}
 
-		GSRasterizerList* rl = new GSRasterizerList(threads, perfmon);
+		GSRasterizerList* rl = new GSRasterizerList(threads, steal, perfmon);
 
 		for(int i = 0; i < threads; i++)
 		{
 			rl->m_r.push_back(std::unique_ptr<GSRasterizer>(new GSRasterizer(new DS(), i, threads, perfmon)));
-			auto &r = *rl->m_r[i];
-			rl->m_workers.push_back(std::unique_ptr<GSWorker>(new GSWorker(
-				[&r](std::shared_ptr<GSRasterizerData> &item) { r.Draw(item.get()); })));
+		}
+
+		for(int i = 0; i < threads; i++)
+		{
+			if(rl->m_steal)
+			{
+				rl->m_threads.push_back(std::thread(&GSRasterizerList::StealThreadProc, rl, i));
+			}
+			else
+			{
+				auto &r = *rl->m_r[i];
+				rl->m_workers.push_back(std::unique_ptr<GSWorker>(new GSWorker(
+					[&r](std::shared_ptr<GSRasterizerData> &item) { r.Draw(item.get()); })));
+			}
 		}
 
 		return rl;
@@ -225,3 +263,8 @@ public:
 	int GetPixels(bool reset);
 	void PrintStats() {}
 };
+
+// Draws a few triangles and sprites with a single rasterizer, then with the thread list in
+// its static and work-stealing modes, and compares the pixels covered by both.  Returns the
+// number of modes which don't match.
+int GSRasterizerSelfTest();
@@ -49,7 +49,9 @@ GSRendererSW::GSRendererSW(int threads)
 
 	memset(m_texture, 0, sizeof(m_texture));
 
-	m_rl = GSRasterizerList::Create<GSDrawScanline>(threads, &m_perfmon);
+	g_code_cache.Open();
+
+	m_rl = GSRasterizerList::Create<GSDrawScanline>(threads, theApp.GetConfigB("extrathreads_steal"), &m_perfmon);
 
 	m_output = (uint8*)_aligned_malloc(1024 * 1024 * sizeof(uint32), 32);
 
@@ -97,6 +99,8 @@ GSRendererSW::~GSRendererSW()
 	delete m_rl;
 
 	_aligned_free(m_output);
+
+	g_code_cache.Save();
 }
 
 void GSRendererSW::Reset()
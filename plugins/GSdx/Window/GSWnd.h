@@ -95,3 +95,26 @@ public:
 	virtual void Flip() = 0;
 	virtual void SetVSync(int vsync) final;
 };
+
+// Offscreen stand-in for headless dump replays: reports a fixed client area and never talks to a display server.
+class GSWndNull final : public GSWnd
+{
+	int m_w, m_h;
+
+public:
+	GSWndNull() : m_w(640), m_h(480) {};
+	virtual ~GSWndNull() {};
+
+	bool Create(const std::string& title, int w, int h) {m_w = std::max(w, 1); m_h = std::max(h, 1); return true;}
+	bool Attach(void* handle, bool managed = true) {m_managed = managed; return true;}
+	void Detach() {}
+
+	void* GetDisplay() {return NULL;}
+	void* GetHandle() {return NULL;}
+	GSVector4i GetClientRect() {return GSVector4i(0, 0, m_w, m_h);}
+	bool SetWindowText(const char* title) {return true;}
+
+	void Show() {}
+	void Hide() {}
+	void HideFrame() {}
+};
@@ -19,9 +19,13 @@
  */
 
 #include <dlfcn.h>
+#include <unistd.h>
+#include <sys/wait.h>
 #include <cstdlib>
 #include <cstdio>
+#include <cstring>
 #include <string>
+#include <algorithm>
 
 static void* handle;
 
@@ -31,6 +35,15 @@ void help()
 	fprintf(stderr, "ARG1 GSdx plugin\n");
 	fprintf(stderr, "ARG2 .gs file\n");
 	fprintf(stderr, "ARG3 Ini directory\n");
+	fprintf(stderr, "\nHeadless benchmark options (before the arguments):\n");
+	fprintf(stderr, "-b N      replay the dump N times without a window\n");
+	fprintf(stderr, "-r R      benchmark renderer: sw (default) or null\n");
+	fprintf(stderr, "-o FILE   per-frame report, .json or .csv\n");
+	fprintf(stderr, "-s N      first measured frame (seeks to a keyframe when the dump has an index)\n");
+	fprintf(stderr, "-n N      number of measured frames\n");
+	fprintf(stderr, "-j N      split the frames of an indexed dump between N processes (report FILE.<job>)\n");
+	fprintf(stderr, "A SW replay with jit_cache = 1 in GSdx.ini pre-warms the JIT cache of the next sessions\n");
+	fprintf(stderr, "\n-t        check the SW rasterizer threads against a single thread (ARG1 only), exits with the failure count\n");
 	if (handle) {
 		dlclose(handle);
 	}
@@ -48,7 +61,79 @@ char* read_env(const char* var) {
 
 int main ( int argc, char *argv[] )
 {
-	if (argc < 1) help();
+	int loops = 0;
+	int renderer = 13; // GSRendererType::OGL_SW
+	char* report = NULL;
+	int start = 0;
+	int count = 0;
+	int jobs = 1;
+	bool test = false;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "b:r:o:s:n:j:th")) != -1) {
+		switch (opt) {
+			case 'b':
+				loops = atoi(optarg);
+				if (loops <= 0) help();
+				break;
+			case 'r':
+				if (!strcmp(optarg, "sw"))
+					renderer = 13; // GSRendererType::OGL_SW
+				else if (!strcmp(optarg, "null"))
+					renderer = 11; // GSRendererType::Null
+				else
+					help();
+				break;
+			case 'o':
+				report = optarg;
+				break;
+			case 's':
+				start = atoi(optarg);
+				if (start < 0) help();
+				break;
+			case 'n':
+				count = atoi(optarg);
+				if (count <= 0) help();
+				break;
+			case 'j':
+				jobs = atoi(optarg);
+				if (jobs <= 0) help();
+				break;
+			case 't':
+				test = true;
+				break;
+			default:
+				help();
+		}
+	}
+
+	// Keep the historical positional layout (argv[0] followed by the arguments)
+	argv += optind - 1;
+	argc -= optind - 1;
+
+	if (test) {
+		char* plugin = argc > 1 ? argv[1] : read_env("GSDUMP_SO");
+
+		handle = dlopen(plugin, RTLD_LAZY|RTLD_GLOBAL);
+		if (handle == NULL) {
+			fprintf(stderr, "Failed to dlopen plugin %s\n", plugin);
+			help();
+		}
+
+		__attribute__((stdcall)) int (*GSRasterizerTest_ptr)();
+		GSRasterizerTest_ptr = reinterpret_cast<decltype(GSRasterizerTest_ptr)>(dlsym(handle, "GSRasterizerTest"));
+		if (GSRasterizerTest_ptr == NULL) {
+			fprintf(stderr, "Plugin %s doesn't have the rasterizer self-test\n", plugin);
+			help();
+		}
+
+		int failed = GSRasterizerTest_ptr();
+
+		dlclose(handle);
+		return failed != 0;
+	}
+
+	if (argc < 2) help();
 
 	char* plugin;
 	char* gs;
@@ -68,9 +153,13 @@ int main ( int argc, char *argv[] )
 
 	__attribute__((stdcall)) void (*GSsetSettingsDir_ptr)(const char*);
 	__attribute__((stdcall)) void (*GSReplay_ptr)(char*, int);
+	__attribute__((stdcall)) void (*GSReplayBenchmark_ptr)(char*, int, int, char*, int, int);
+	__attribute__((stdcall)) int (*GSReplayFrameCount_ptr)(char*);
 
 	GSsetSettingsDir_ptr = reinterpret_cast<decltype(GSsetSettingsDir_ptr)>(dlsym(handle, "GSsetSettingsDir"));
 	GSReplay_ptr = reinterpret_cast<decltype(GSReplay_ptr)>(dlsym(handle, "GSReplay"));
+	GSReplayBenchmark_ptr = reinterpret_cast<decltype(GSReplayBenchmark_ptr)>(dlsym(handle, "GSReplayBenchmark"));
+	GSReplayFrameCount_ptr = reinterpret_cast<decltype(GSReplayFrameCount_ptr)>(dlsym(handle, "GSReplayFrameCount"));
 
 	if (argc == 2) {
 		char *ini = read_env("GSDUMP_CONF");
@@ -94,7 +183,64 @@ int main ( int argc, char *argv[] )
 #endif
 	}
 
-	GSReplay_ptr(gs, 12);
+	if (loops > 0) {
+		if (GSReplayBenchmark_ptr == NULL) {
+			fprintf(stderr, "Plugin %s doesn't support benchmark replay\n", plugin);
+			help();
+		}
+
+		if (jobs > 1) {
+			// Every job replays its own slice of the frames, from the closest keyframe
+			int frames = GSReplayFrameCount_ptr ? GSReplayFrameCount_ptr(gs) : -1;
+			if (frames < 0) {
+				fprintf(stderr, "%s has no frame index, can't split it\n", gs);
+				help();
+			}
+			if (count <= 0 || start + count > frames)
+				count = std::max(frames - start, 0);
+			if (count == 0) {
+				fprintf(stderr, "%s has no frame to replay from frame %d\n", gs, start);
+				help();
+			}
+			// A job with an empty slice would replay the dump to its end (count 0)
+			jobs = std::min(jobs, count);
+
+			bool forked = true;
+
+			for (int job = 0; job < jobs; job++) {
+				pid_t pid = fork();
+				if (pid < 0) {
+					perror("fork");
+					fprintf(stderr, "Job %d and the next ones didn't run\n", job);
+					forked = false;
+					break;
+				}
+				if (pid != 0)
+					continue;
+
+				int first = start + (int)((long long)count * job / jobs);
+				int last = start + (int)((long long)count * (job + 1) / jobs);
+				std::string job_report;
+				if (report)
+					job_report = std::string(report) + "." + std::to_string(job);
+
+				GSReplayBenchmark_ptr(gs, renderer, loops, report ? &job_report[0] : NULL, first, last - first);
+				_exit(0);
+			}
+
+			while (wait(NULL) > 0)
+				;
+
+			if (!forked) {
+				dlclose(handle);
+				return 1;
+			}
+		} else {
+			GSReplayBenchmark_ptr(gs, renderer, loops, report, start, count);
+		}
+	} else {
+		GSReplay_ptr(gs, 12);
+	}
 
 	if (handle) {
 		dlclose(handle);
@@ -115,6 +115,7 @@ typedef int64 sint64;
 #include <queue>
 #include <algorithm>
 #include <thread>
+#include <chrono>
 #include <atomic>
 #include <mutex>
 #include <condition_variable>
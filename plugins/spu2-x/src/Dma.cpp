@@ -220,15 +220,9 @@ void V_Core::PlainDMAWrite(u16 *pMem, u32 size)
         buff1end = 0x100000;
     }
 
-    const int cacheIdxStart = TSA / pcm_WordsPerBlock;
-    const int cacheIdxEnd = (buff1end + pcm_WordsPerBlock - 1) / pcm_WordsPerBlock;
-    PcmCacheEntry *cacheLine = &pcm_cache_data[cacheIdxStart];
-    PcmCacheEntry &cacheEnd = pcm_cache_data[cacheIdxEnd];
-
-    do {
-        cacheLine->Validated = false;
-        cacheLine++;
-    } while (cacheLine != &cacheEnd);
+    pcm_InvalidateRange(TSA, buff1end);
+    if (buff2end > 0)
+        pcm_InvalidateRange(0, buff2end);
 
     //ConLog( "* SPU2-X: Cache Clear Range!  TSA=0x%x, TDA=0x%x (low8=0x%x, high8=0x%x, len=0x%x)\n",
     //	TSA, buff1end, flagTSA, flagTDA, clearLen );
@@ -246,11 +240,6 @@ void V_Core::PlainDMAWrite(u16 *pMem, u32 size)
         // second branch needs copied:
         // It starts at the beginning of memory and moves forward to buff2end
 
-        // endpoint cache should be irrelevant, since it's almost certainly dynamic
-        // memory below 0x2800 (registers and such)
-        //const u32 endpt2 = (buff2end + roundUp) / indexer_scalar;
-        //memset( pcm_cache_flags, 0, endpt2 );
-
         // Emulation Grayarea: Should addresses wrap around to zero, or wrap around to
         // 0x2800?  Hard to know for sure (almost no games depend on this)
 
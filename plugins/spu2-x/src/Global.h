@@ -97,6 +97,7 @@ extern void SysMessage(const wchar_t *fmt, ...);
 
 #include "Utilities/Exceptions.h"
 #include "Utilities/SafeArray.h"
+#include "Utilities/General.h" // GetCPUTicks
 
 #include "defs.h"
 #include "regs.h"
@@ -0,0 +1,86 @@
+/* SPU2-X, A plugin for Emulating the Sound Processing Unit of the Playstation 2
+ * Developed and maintained by the Pcsx2 Development Team.
+ *
+ * SPU2-X is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Found-
+ * ation, either version 3 of the License, or (at your option) any later version.
+ *
+ * SPU2-X is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with SPU2-X.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Replays a .s2r log (see Spu2replay.cpp) through the plugin, headless and as fast as
+// possible, and reports the time spent in the mixer.  Also runs the mixer self-test.
+
+#include <dlfcn.h>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+
+static void *handle;
+
+static void help()
+{
+    fprintf(stderr, "Headless SPU2-X replay benchmark\n");
+    fprintf(stderr, "ARG1 SPU2-X plugin\n");
+    fprintf(stderr, "ARG2 .s2r file\n");
+    fprintf(stderr, "ARG3 output .wav file (optional), to compare the output of two builds\n");
+    fprintf(stderr, "or: -t SPU2-X plugin, to check the SIMD mixer against the scalar one\n");
+    if (handle)
+        dlclose(handle);
+    exit(1);
+}
+
+static int selftest(const char *plugin)
+{
+    handle = dlopen(plugin, RTLD_LAZY | RTLD_GLOBAL);
+    if (handle == NULL) {
+        fprintf(stderr, "Failed to dlopen plugin %s: %s\n", plugin, dlerror());
+        help();
+    }
+
+    __attribute__((stdcall)) int (*s2r_selftest_ptr)();
+    s2r_selftest_ptr = reinterpret_cast<decltype(s2r_selftest_ptr)>(dlsym(handle, "s2r_selftest"));
+
+    if (s2r_selftest_ptr == NULL) {
+        fprintf(stderr, "Plugin %s doesn't support the self-test\n", plugin);
+        help();
+    }
+
+    const int failed = s2r_selftest_ptr();
+
+    dlclose(handle);
+    return failed != 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc == 3 && strcmp(argv[1], "-t") == 0)
+        return selftest(argv[2]);
+
+    if (argc < 3 || argc > 4)
+        help();
+
+    handle = dlopen(argv[1], RTLD_LAZY | RTLD_GLOBAL);
+    if (handle == NULL) {
+        fprintf(stderr, "Failed to dlopen plugin %s: %s\n", argv[1], dlerror());
+        help();
+    }
+
+    __attribute__((stdcall)) void (*s2r_benchmark_ptr)(char *, char *);
+    s2r_benchmark_ptr = reinterpret_cast<decltype(s2r_benchmark_ptr)>(dlsym(handle, "s2r_benchmark"));
+
+    if (s2r_benchmark_ptr == NULL) {
+        fprintf(stderr, "Plugin %s doesn't support benchmark replay\n", argv[1]);
+        help();
+    }
+
+    s2r_benchmark_ptr(argv[2], argc > 3 ? argv[3] : NULL);
+
+    dlclose(handle);
+    return 0;
+}
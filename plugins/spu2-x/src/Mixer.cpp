@@ -17,11 +17,20 @@
 
 #include "Global.h"
 
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h> // __rdtsc
+#endif
+
 // Games have turned out to be surprisingly sensitive to whether a parked, silent voice is being fully emulated.
 // With Silent Hill: Shattered Memories requiring full processing for no obvious reason, we've decided to
 // disable the optimisation until we can tie it to the game database.
 #define NEVER_SKIP_VOICES 1
 
+// Mixes the voices of a core a few at a time with SSE (or AVX2), see MixCoreVoicesBatched.
+// 0 falls back on the voice by voice mixer, which gives the same output.
+#define BATCH_VOICE_MIXER 1
+
 void ADMAOutLogWrite(void *lpData, u32 ulSize);
 
 static const s32 tbl_XA_Factor[16][2] =
@@ -133,9 +142,55 @@ static void __forceinline IncrementNextA(V_Core &thiscore, uint voiceidx)
 // invalided when DMA transfers and memory writes are performed.
 PcmCacheEntry *pcm_cache_data = NULL;
 
-int g_counter_cache_hits = 0;
-int g_counter_cache_misses = 0;
-int g_counter_cache_ignores = 0;
+// Bumped by every write to a page, which invalidates all the blocks decoded from it.
+u32 pcm_PageGen[pcm_PageCount];
+
+// Way of each set which the next miss replaces (when none of them is stale).
+static u8 pcm_CacheVictim[pcm_CacheSets];
+
+PcmCacheStats pcm_CacheStats;
+
+void pcm_WipeCache()
+{
+    memset(pcm_cache_data, 0, pcm_CacheSets * pcm_CacheWays * sizeof(PcmCacheEntry));
+    memset(pcm_PageGen, 0, sizeof(pcm_PageGen));
+    memset(pcm_CacheVictim, 0, sizeof(pcm_CacheVictim));
+}
+
+// Copies the decoded block at addr into dest if it's cached, and returns false otherwise.
+// After a miss, *fill is the entry the block should be decoded to.
+static __forceinline bool pcm_CacheLookup(u32 addr, s16 *dest, PcmCacheEntry *&fill)
+{
+    const u32 block = addr / pcm_WordsPerBlock;
+    const u32 gen = pcm_PageGen[addr / pcm_WordsPerPage];
+    const u32 set = block & (pcm_CacheSets - 1);
+    PcmCacheEntry *ways = &pcm_cache_data[set * pcm_CacheWays];
+
+    fill = NULL;
+    for (int i = 0; i < pcm_CacheWays; i++) {
+        PcmCacheEntry &entry(ways[i]);
+
+        if (entry.Block != 0 && entry.PageGen == pcm_PageGen[entry.Block / (pcm_WordsPerPage / pcm_WordsPerBlock)]) {
+            if (entry.Block == block) {
+                memcpy(dest, entry.Sampledata, sizeof(entry.Sampledata));
+                return true;
+            }
+        } else if (fill == NULL)
+            fill = &entry; // stale (or free), the best one to replace
+    }
+
+    if (fill == NULL) {
+        fill = &ways[pcm_CacheVictim[set]];
+        pcm_CacheVictim[set] = (pcm_CacheVictim[set] + 1) & (pcm_CacheWays - 1);
+
+        if (IsDevBuild)
+            pcm_CacheStats.evictions++;
+    }
+
+    fill->Block = block;
+    fill->PageGen = gen;
+    return false;
+}
 
 // LOOP/END sets the ENDX bit and sets NAX to LSA, and the voice is muted if LOOP is not set
 // LOOP seems to only have any effect on the block with LOOP/END set, where it prevents muting the voice
@@ -186,34 +241,29 @@ static __forceinline s32 GetNextDataBuffered(V_Core &thiscore, uint voiceidx)
         if ((vc.LoopFlags & XAFLAG_LOOP_START) && !vc.LoopMode)
             vc.LoopStartA = vc.NextA & 0xFFFF8;
 
-        const int cacheIdx = vc.NextA / pcm_WordsPerBlock;
-        PcmCacheEntry &cacheLine = pcm_cache_data[cacheIdx];
-        vc.SBuffer = cacheLine.Sampledata;
+        PcmCacheEntry *fill;
 
-        if (cacheLine.Validated) {
-            // Cached block!  Read from the cache directly.
+        // Only the non-dynamic memory range is cached.
+        if (vc.NextA < SPU2_DYN_MEMLINE) {
+            if (IsDevBuild)
+                pcm_CacheStats.ignores++;
+
+            XA_decode_block(vc.SBuffer, memptr, vc.Prev1, vc.Prev2);
+        } else if (pcm_CacheLookup(vc.NextA, vc.SBuffer, fill)) {
+            // Cached block!
             // Make sure to propagate the prev1/prev2 ADPCM:
 
             vc.Prev1 = vc.SBuffer[27];
             vc.Prev2 = vc.SBuffer[26];
 
-            //ConLog( "* SPU2-X: Cache Hit! NextA=0x%x, cacheIdx=0x%x\n", vc.NextA, cacheIdx );
-
             if (IsDevBuild)
-                g_counter_cache_hits++;
+                pcm_CacheStats.hits++;
         } else {
-            // Only flag the cache if it's a non-dynamic memory range.
-            if (vc.NextA >= SPU2_DYN_MEMLINE)
-                cacheLine.Validated = true;
-
-            if (IsDevBuild) {
-                if (vc.NextA < SPU2_DYN_MEMLINE)
-                    g_counter_cache_ignores++;
-                else
-                    g_counter_cache_misses++;
-            }
+            if (IsDevBuild)
+                pcm_CacheStats.misses++;
 
             XA_decode_block(vc.SBuffer, memptr, vc.Prev1, vc.Prev2);
+            memcpy(fill->Sampledata, vc.SBuffer, sizeof(vc.SBuffer));
         }
     }
 
@@ -255,22 +305,24 @@ static __forceinline void GetNextDataDummy(V_Core &thiscore, uint voiceidx)
 /////////////////////////////////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////////////////////////////////
 
+// State of the noise generator, shared by all the noise voices.
+static s32 NoiseSeed = 0x41595321;
+
 static s32 __forceinline GetNoiseValues()
 {
-    static s32 Seed = 0x41595321;
     s32 retval = 0x8000;
 
-    if (Seed & 0x100)
-        retval = (Seed & 0xff) << 8;
-    else if (Seed & 0xffff)
+    if (NoiseSeed & 0x100)
+        retval = (NoiseSeed & 0xff) << 8;
+    else if (NoiseSeed & 0xffff)
         retval = 0x7fff;
 
-    s32 x = _rotr(Seed, 0x5);
+    s32 x = _rotr(NoiseSeed, 0x5);
     x ^= 0x9a;
     s32 y = _rotl(x, 0x2);
     y += x;
     y ^= x;
-    Seed = _rotr(y, 0x3);
+    NoiseSeed = _rotr(y, 0x3);
 
     return retval;
 }
@@ -342,36 +394,39 @@ static __forceinline void CalculateADSR(V_Core &thiscore, uint voiceidx)
 /*
    Tension: 65535 is high, 32768 is normal, 0 is low
 */
-template <s32 i_tension>
-__forceinline static s32 HermiteInterpolate(
-    s32 y0, // 16.0
-    s32 y1, // 16.0
-    s32 y2, // 16.0
-    s32 y3, // 16.0
-    s32 mu  //  0.12
+// The interpolations are templated on the sample type, so that the batched mixer (see
+// MixCoreVoicesBatched) runs the very same arithmetic on several voices at once.
+template <s32 i_tension, typename T>
+__forceinline static T HermiteInterpolate(
+    T y0, // 16.0
+    T y1, // 16.0
+    T y2, // 16.0
+    T y3, // 16.0
+    T mu  //  0.12
     )
 {
-    s32 m00 = ((y1 - y0) * i_tension) >> 16; // 16.0
-    s32 m01 = ((y2 - y1) * i_tension) >> 16; // 16.0
-    s32 m0 = m00 + m01;
+    T m00 = ((y1 - y0) * i_tension) >> 16; // 16.0
+    T m01 = ((y2 - y1) * i_tension) >> 16; // 16.0
+    T m0 = m00 + m01;
 
-    s32 m10 = ((y2 - y1) * i_tension) >> 16; // 16.0
-    s32 m11 = ((y3 - y2) * i_tension) >> 16; // 16.0
-    s32 m1 = m10 + m11;
+    T m10 = ((y2 - y1) * i_tension) >> 16; // 16.0
+    T m11 = ((y3 - y2) * i_tension) >> 16; // 16.0
+    T m1 = m10 + m11;
 
-    s32 val = ((2 * y1 + m0 + m1 - 2 * y2) * mu) >> 12;       // 16.0
+    T val = ((2 * y1 + m0 + m1 - 2 * y2) * mu) >> 12;       // 16.0
     val = ((val - 3 * y1 - 2 * m0 - m1 + 3 * y2) * mu) >> 12; // 16.0
     val = ((val + m0) * mu) >> 11;                            // 16.0
 
     return (val + (y1 << 1));
 }
 
-__forceinline static s32 CatmullRomInterpolate(
-    s32 y0, // 16.0
-    s32 y1, // 16.0
-    s32 y2, // 16.0
-    s32 y3, // 16.0
-    s32 mu  //  0.12
+template <typename T>
+__forceinline static T CatmullRomInterpolate(
+    T y0, // 16.0
+    T y1, // 16.0
+    T y2, // 16.0
+    T y3, // 16.0
+    T mu  //  0.12
     )
 {
     //q(t) = 0.5 *(    	(2 * P1) +
@@ -379,42 +434,41 @@ __forceinline static s32 CatmullRomInterpolate(
     //	(2*P0 - 5*P1 + 4*P2 - P3) * t2 +
     //	(-P0 + 3*P1- 3*P2 + P3) * t3)
 
-    s32 a3 = (-y0 + 3 * y1 - 3 * y2 + y3);
-    s32 a2 = (2 * y0 - 5 * y1 + 4 * y2 - y3);
-    s32 a1 = (-y0 + y2);
-    s32 a0 = (2 * y1);
+    T a3 = (-y0 + 3 * y1 - 3 * y2 + y3);
+    T a2 = (2 * y0 - 5 * y1 + 4 * y2 - y3);
+    T a1 = (-y0 + y2);
+    T a0 = (2 * y1);
 
-    s32 val = ((a3)*mu) >> 12;
+    T val = ((a3)*mu) >> 12;
     val = ((a2 + val) * mu) >> 12;
     val = ((a1 + val) * mu) >> 12;
 
     return (a0 + val);
 }
 
-__forceinline static s32 CubicInterpolate(
-    s32 y0, // 16.0
-    s32 y1, // 16.0
-    s32 y2, // 16.0
-    s32 y3, // 16.0
-    s32 mu  //  0.12
+template <typename T>
+__forceinline static T CubicInterpolate(
+    T y0, // 16.0
+    T y1, // 16.0
+    T y2, // 16.0
+    T y3, // 16.0
+    T mu  //  0.12
     )
 {
-    const s32 a0 = y3 - y2 - y0 + y1;
-    const s32 a1 = y0 - y1 - a0;
-    const s32 a2 = y2 - y0;
+    const T a0 = y3 - y2 - y0 + y1;
+    const T a1 = y0 - y1 - a0;
+    const T a2 = y2 - y0;
 
-    s32 val = ((a0)*mu) >> 12;
+    T val = ((a0)*mu) >> 12;
     val = ((val + a1) * mu) >> 12;
     val = ((val + a2) * mu) >> 11;
 
     return (val + (y1 << 1));
 }
 
-// Returns a 16 bit result in Value.
-// Uses standard template-style optimization techniques to statically generate five different
-// versions of this function (one for each type of interpolation).
+// Reads the ADPCM samples the voice has moved past.
 template <int InterpType>
-static __forceinline s32 GetVoiceValues(V_Core &thiscore, uint voiceidx)
+static __forceinline void GetVoiceData(V_Core &thiscore, uint voiceidx)
 {
     V_Voice &vc(thiscore.Voices[voiceidx]);
 
@@ -427,21 +481,29 @@ static __forceinline s32 GetVoiceValues(V_Core &thiscore, uint voiceidx)
         vc.PV1 = GetNextDataBuffered(thiscore, voiceidx);
         vc.SP -= 4096;
     }
+}
 
-    const s32 mu = vc.SP + 4096;
+// Returns a 16 bit result, from the last four samples of a voice and its position (SP)
+// between the two newest ones.
+// Uses standard template-style optimization techniques to statically generate five different
+// versions of this function (one for each type of interpolation).
+template <int InterpType, typename T>
+static __forceinline T InterpolateVoice(T pv4, T pv3, T pv2, T pv1, T sp)
+{
+    const T mu = sp + 4096;
 
     switch (InterpType) {
         case 0:
-            return vc.PV1 << 1;
+            return pv1 << 1;
         case 1:
-            return (vc.PV1 << 1) - (((vc.PV2 - vc.PV1) * vc.SP) >> 11);
+            return (pv1 << 1) - (((pv2 - pv1) * sp) >> 11);
 
         case 2:
-            return CubicInterpolate(vc.PV4, vc.PV3, vc.PV2, vc.PV1, mu);
+            return CubicInterpolate(pv4, pv3, pv2, pv1, mu);
         case 3:
-            return HermiteInterpolate<16384>(vc.PV4, vc.PV3, vc.PV2, vc.PV1, mu);
+            return HermiteInterpolate<16384>(pv4, pv3, pv2, pv1, mu);
         case 4:
-            return CatmullRomInterpolate(vc.PV4, vc.PV3, vc.PV2, vc.PV1, mu);
+            return CatmullRomInterpolate(pv4, pv3, pv2, pv1, mu);
 
             jNO_DEFAULT;
     }
@@ -449,6 +511,12 @@ static __forceinline s32 GetVoiceValues(V_Core &thiscore, uint voiceidx)
     return 0; // technically unreachable!
 }
 
+template <int InterpType>
+static __forceinline s32 InterpolateVoice(const V_Voice &vc)
+{
+    return InterpolateVoice<InterpType, s32>(vc.PV4, vc.PV3, vc.PV2, vc.PV1, vc.SP);
+}
+
 // Noise values need to be mixed without going through interpolation, since it
 // can wreak havoc on the noise (causing muffling or popping).  Not that this noise
 // generator is accurate in its own right.. but eh, ah well :)
@@ -495,7 +563,13 @@ static __forceinline void spu2M_WriteFast(u32 addr, s16 value)
 }
 
 
-static __forceinline StereoOut32 MixVoice(uint coreidx, uint voiceidx)
+// Steps a voice by one sample: volume slides, pitch, ADPCM fetch, ADSR, and the raw voice
+// output of voices 1 and 3.  This runs in voice order, since a voice can be modulated by the
+// previous one, and the noise generator, the IRQs and the SPU2 memory are shared.
+// Returns false when the voice is silent for this sample.  A noise voice gets its value
+// in noise; the interpolation of the others is left to the caller.
+template <int InterpType>
+static __forceinline bool StepVoice(uint coreidx, uint voiceidx, s32 &noise)
 {
     V_Core &thiscore(Cores[coreidx]);
     V_Voice &vc(thiscore.Voices[voiceidx]);
@@ -517,44 +591,13 @@ static __forceinline StereoOut32 MixVoice(uint coreidx, uint voiceidx)
     if (vc.ADSR.Phase > 0) {
         UpdatePitch(coreidx, voiceidx);
 
-        s32 Value = 0;
-
         if (vc.Noise)
-            Value = GetNoiseValues(thiscore, voiceidx);
-        else {
-            // Optimization : Forceinline'd Templated Dispatch Table.  Any halfwit compiler will
-            // turn this into a clever jump dispatch table (no call/rets, no compares, uber-efficient!)
-
-            switch (Interpolation) {
-                case 0:
-                    Value = GetVoiceValues<0>(thiscore, voiceidx);
-                    break;
-                case 1:
-                    Value = GetVoiceValues<1>(thiscore, voiceidx);
-                    break;
-                case 2:
-                    Value = GetVoiceValues<2>(thiscore, voiceidx);
-                    break;
-                case 3:
-                    Value = GetVoiceValues<3>(thiscore, voiceidx);
-                    break;
-                case 4:
-                    Value = GetVoiceValues<4>(thiscore, voiceidx);
-                    break;
-
-                    jNO_DEFAULT;
-            }
-        }
-
-        // Update and Apply ADSR  (applies to normal and noise sources)
-        //
-        // Note!  It's very important that ADSR stay as accurate as possible.  By the way
-        // it is used, various sound effects can end prematurely if we truncate more than
-        // one or two bits.  Best result comes from no truncation at all, which is why we
-        // use a full 64-bit multiply/result here.
+            noise = GetNoiseValues(thiscore, voiceidx);
+        else
+            GetVoiceData<InterpType>(thiscore, voiceidx);
 
+        // Update ADSR  (applies to normal and noise sources)
         CalculateADSR(thiscore, voiceidx);
-        Value = MulShr32(Value, vc.ADSR.Value);
 
         // Store Value for eventual modulation later
         // Pseudonym's Crest calculation idea. Actually calculates a crest, unlike the old code which was just peak.
@@ -576,7 +619,7 @@ static __forceinline StereoOut32 MixVoice(uint coreidx, uint voiceidx)
         else if (voiceidx == 3)
             spu2M_WriteFast(((0 == coreidx) ? 0x600 : 0xe00) + OutPos, vc.OutX);
 
-        return ApplyVolume(StereoOut32(Value, Value), vc.Volume);
+        return true;
     } else {
         // Continue processing voice, even if it's "off". Or else we miss interrupts! (Fatal Frame engine died because of this.)
         if (NEVER_SKIP_VOICES || (*GetMemPtr(vc.NextA & 0xFFFF8) >> 8 & 3) != 3 || vc.LoopStartA != (vc.NextA & ~7)    // not in a tight loop
@@ -595,18 +638,43 @@ static __forceinline StereoOut32 MixVoice(uint coreidx, uint voiceidx)
         else if (voiceidx == 3)
             spu2M_WriteFast(((0 == coreidx) ? 0x600 : 0xe00) + OutPos, 0);
 
-        return StereoOut32(0, 0);
+        return false;
     }
 }
 
+template <int InterpType>
+static __forceinline StereoOut32 MixVoice(uint coreidx, uint voiceidx)
+{
+    V_Voice &vc(Cores[coreidx].Voices[voiceidx]);
+    s32 Value = 0;
+
+    if (!StepVoice<InterpType>(coreidx, voiceidx, Value))
+        return StereoOut32(0, 0);
+
+    if (!vc.Noise)
+        Value = InterpolateVoice<InterpType>(vc);
+
+    // Apply ADSR
+    //
+    // Note!  It's very important that ADSR stay as accurate as possible.  By the way
+    // it is used, various sound effects can end prematurely if we truncate more than
+    // one or two bits.  Best result comes from no truncation at all, which is why we
+    // use a full 64-bit multiply/result here.
+
+    Value = MulShr32(Value, vc.ADSR.Value);
+
+    return ApplyVolume(StereoOut32(Value, Value), vc.Volume);
+}
+
 const VoiceMixSet VoiceMixSet::Empty((StereoOut32()), (StereoOut32())); // Don't use SteroOut32::Empty because C++ doesn't make any dep/order checks on global initializers.
 
-static __forceinline void MixCoreVoices(VoiceMixSet &dest, const uint coreidx)
+template <int InterpType>
+static __forceinline void MixCoreVoicesScalar(VoiceMixSet &dest, const uint coreidx)
 {
     V_Core &thiscore(Cores[coreidx]);
 
     for (uint voiceidx = 0; voiceidx < V_Core::NumVoices; ++voiceidx) {
-        StereoOut32 VVal(MixVoice(coreidx, voiceidx));
+        StereoOut32 VVal(MixVoice<InterpType>(coreidx, voiceidx));
 
         // Note: Results from MixVoice are ranged at 16 bits.
 
@@ -617,6 +685,478 @@ static __forceinline void MixCoreVoices(VoiceMixSet &dest, const uint coreidx)
     }
 }
 
+// --------------------------------------------------------------------------------------
+//  VoiceLanes
+// --------------------------------------------------------------------------------------
+// The s32 arithmetic of the mixer on 4 voices at once (8 with AVX2).  Products wrap around
+// like they do on an s32, and >> is an arithmetic shift, so that the interpolation templates
+// give the very same results on VoiceLanes as on a single voice.
+//
+struct VoiceLanes
+{
+#if defined(__AVX2__)
+    static const uint Count = 8;
+    __m256i m;
+
+    VoiceLanes(__m256i v) : m(v) {}
+    VoiceLanes(s32 v) : m(_mm256_set1_epi32(v)) {}
+    static VoiceLanes Load(const s32 *src) { return _mm256_loadu_si256((const __m256i *)src); }
+    void Store(s32 *dest) const { _mm256_storeu_si256((__m256i *)dest, m); }
+#else
+    static const uint Count = 4;
+    __m128i m;
+
+    VoiceLanes(__m128i v) : m(v) {}
+    VoiceLanes(s32 v) : m(_mm_set1_epi32(v)) {}
+    static VoiceLanes Load(const s32 *src) { return _mm_loadu_si128((const __m128i *)src); }
+    void Store(s32 *dest) const { _mm_storeu_si128((__m128i *)dest, m); }
+#endif
+
+    s32 Sum() const
+    {
+        s32 lanes[Count];
+        Store(lanes);
+
+        s32 sum = 0;
+        for (uint i = 0; i < Count; ++i)
+            sum += lanes[i];
+        return sum;
+    }
+};
+
+#if defined(__AVX2__)
+static __forceinline VoiceLanes operator+(const VoiceLanes &a, const VoiceLanes &b) { return _mm256_add_epi32(a.m, b.m); }
+static __forceinline VoiceLanes operator-(const VoiceLanes &a, const VoiceLanes &b) { return _mm256_sub_epi32(a.m, b.m); }
+static __forceinline VoiceLanes operator-(const VoiceLanes &a) { return _mm256_sub_epi32(_mm256_setzero_si256(), a.m); }
+static __forceinline VoiceLanes operator*(const VoiceLanes &a, const VoiceLanes &b) { return _mm256_mullo_epi32(a.m, b.m); }
+static __forceinline VoiceLanes operator&(const VoiceLanes &a, const VoiceLanes &b) { return _mm256_and_si256(a.m, b.m); }
+static __forceinline VoiceLanes operator<<(const VoiceLanes &a, int shift) { return _mm256_slli_epi32(a.m, shift); }
+static __forceinline VoiceLanes operator>>(const VoiceLanes &a, int shift) { return _mm256_srai_epi32(a.m, shift); }
+
+// Takes the lanes of a where mask is set, and the lanes of b elsewhere.
+static __forceinline VoiceLanes Select(const VoiceLanes &mask, const VoiceLanes &a, const VoiceLanes &b)
+{
+    return _mm256_or_si256(_mm256_and_si256(mask.m, a.m), _mm256_andnot_si256(mask.m, b.m));
+}
+
+static __forceinline VoiceLanes MulShr32(const VoiceLanes &a, const VoiceLanes &b)
+{
+    const __m256i even = _mm256_mul_epi32(a.m, b.m);
+    const __m256i odd = _mm256_mul_epi32(_mm256_srli_epi64(a.m, 32), _mm256_srli_epi64(b.m, 32));
+    return _mm256_unpacklo_epi32(_mm256_shuffle_epi32(even, _MM_SHUFFLE(3, 1, 3, 1)), _mm256_shuffle_epi32(odd, _MM_SHUFFLE(3, 1, 3, 1)));
+}
+#else
+static __forceinline VoiceLanes operator+(const VoiceLanes &a, const VoiceLanes &b) { return _mm_add_epi32(a.m, b.m); }
+static __forceinline VoiceLanes operator-(const VoiceLanes &a, const VoiceLanes &b) { return _mm_sub_epi32(a.m, b.m); }
+static __forceinline VoiceLanes operator-(const VoiceLanes &a) { return _mm_sub_epi32(_mm_setzero_si128(), a.m); }
+static __forceinline VoiceLanes operator&(const VoiceLanes &a, const VoiceLanes &b) { return _mm_and_si128(a.m, b.m); }
+static __forceinline VoiceLanes operator<<(const VoiceLanes &a, int shift) { return _mm_slli_epi32(a.m, shift); }
+static __forceinline VoiceLanes operator>>(const VoiceLanes &a, int shift) { return _mm_srai_epi32(a.m, shift); }
+
+static __forceinline VoiceLanes operator*(const VoiceLanes &a, const VoiceLanes &b)
+{
+#if defined(__SSE4_1__) || defined(__AVX__)
+    return _mm_mullo_epi32(a.m, b.m);
+#else
+    // The low 32 bits of a product are the same whether it's signed or not.
+    const __m128i even = _mm_mul_epu32(a.m, b.m);
+    const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a.m, 32), _mm_srli_epi64(b.m, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+#endif
+}
+
+// Takes the lanes of a where mask is set, and the lanes of b elsewhere.
+static __forceinline VoiceLanes Select(const VoiceLanes &mask, const VoiceLanes &a, const VoiceLanes &b)
+{
+    return _mm_or_si128(_mm_and_si128(mask.m, a.m), _mm_andnot_si128(mask.m, b.m));
+}
+
+static __forceinline VoiceLanes MulShr32(const VoiceLanes &a, const VoiceLanes &b)
+{
+#if defined(__SSE4_1__) || defined(__AVX__)
+    const __m128i even = _mm_mul_epi32(a.m, b.m);
+    const __m128i odd = _mm_mul_epi32(_mm_srli_epi64(a.m, 32), _mm_srli_epi64(b.m, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(3, 1, 3, 1)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(3, 1, 3, 1)));
+#else
+    // SSE2 only has the unsigned multiply; the high half of the signed product is the
+    // unsigned one minus b for a negative a, and minus a for a negative b.
+    const __m128i even = _mm_mul_epu32(a.m, b.m);
+    const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a.m, 32), _mm_srli_epi64(b.m, 32));
+    const __m128i hi = _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(3, 1, 3, 1)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(3, 1, 3, 1)));
+    const __m128i fix = _mm_add_epi32(_mm_and_si128(_mm_srai_epi32(a.m, 31), b.m), _mm_and_si128(_mm_srai_epi32(b.m, 31), a.m));
+    return _mm_sub_epi32(hi, fix);
+#endif
+}
+#endif
+
+// The state MixVoice works from, for all the voices of a core.
+struct VoiceBatch
+{
+    s32 PV4[V_Core::NumVoices];
+    s32 PV3[V_Core::NumVoices];
+    s32 PV2[V_Core::NumVoices];
+    s32 PV1[V_Core::NumVoices];
+    s32 SP[V_Core::NumVoices];
+    s32 Noise[V_Core::NumVoices];
+    s32 NoiseMask[V_Core::NumVoices]; // -1 for the noise voices
+    s32 ADSR[V_Core::NumVoices];      // 0 for the silent voices
+    s32 VolL[V_Core::NumVoices];
+    s32 VolR[V_Core::NumVoices];
+    s32 DryL[V_Core::NumVoices];
+    s32 DryR[V_Core::NumVoices];
+    s32 WetL[V_Core::NumVoices];
+    s32 WetR[V_Core::NumVoices];
+};
+
+// Interpolates, envelopes, pans and gates the voices of a batch, VoiceLanes::Count at a time.
+template <int InterpType>
+static __forceinline void MixVoiceBatch(VoiceMixSet &dest, const VoiceBatch &batch)
+{
+    VoiceLanes dryL(0), dryR(0), wetL(0), wetR(0);
+
+    for (uint i = 0; i < V_Core::NumVoices; i += VoiceLanes::Count) {
+        VoiceLanes value = InterpolateVoice<InterpType, VoiceLanes>(
+            VoiceLanes::Load(&batch.PV4[i]), VoiceLanes::Load(&batch.PV3[i]),
+            VoiceLanes::Load(&batch.PV2[i]), VoiceLanes::Load(&batch.PV1[i]),
+            VoiceLanes::Load(&batch.SP[i]));
+
+        value = Select(VoiceLanes::Load(&batch.NoiseMask[i]), VoiceLanes::Load(&batch.Noise[i]), value);
+        value = MulShr32(value, VoiceLanes::Load(&batch.ADSR[i])) << 1;
+
+        const VoiceLanes left(MulShr32(value, VoiceLanes::Load(&batch.VolL[i])));
+        const VoiceLanes right(MulShr32(value, VoiceLanes::Load(&batch.VolR[i])));
+
+        dryL = dryL + (left & VoiceLanes::Load(&batch.DryL[i]));
+        dryR = dryR + (right & VoiceLanes::Load(&batch.DryR[i]));
+        wetL = wetL + (left & VoiceLanes::Load(&batch.WetL[i]));
+        wetR = wetR + (right & VoiceLanes::Load(&batch.WetR[i]));
+    }
+
+    dest.Dry.Left += dryL.Sum();
+    dest.Dry.Right += dryR.Sum();
+    dest.Wet.Left += wetL.Sum();
+    dest.Wet.Right += wetR.Sum();
+}
+
+// Same result as MixCoreVoicesScalar, to the bit: the voices are stepped one at a time in
+// order (see StepVoice), then interpolated, enveloped, panned and gated together.
+template <int InterpType>
+static __forceinline void MixCoreVoicesBatched(VoiceMixSet &dest, const uint coreidx)
+{
+    static_assert(V_Core::NumVoices % VoiceLanes::Count == 0, "Voices don't fill the lanes");
+
+    V_Core &thiscore(Cores[coreidx]);
+    VoiceBatch batch;
+
+    for (uint voiceidx = 0; voiceidx < V_Core::NumVoices; ++voiceidx) {
+        const V_Voice &vc(thiscore.Voices[voiceidx]);
+        const V_VoiceGates &gates(thiscore.VoiceGates[voiceidx]);
+        s32 noise = 0;
+
+        batch.ADSR[voiceidx] = StepVoice<InterpType>(coreidx, voiceidx, noise) ? vc.ADSR.Value : 0;
+        batch.PV4[voiceidx] = vc.PV4;
+        batch.PV3[voiceidx] = vc.PV3;
+        batch.PV2[voiceidx] = vc.PV2;
+        batch.PV1[voiceidx] = vc.PV1;
+        batch.SP[voiceidx] = vc.SP;
+        batch.Noise[voiceidx] = noise;
+        batch.NoiseMask[voiceidx] = vc.Noise ? -1 : 0;
+        batch.VolL[voiceidx] = vc.Volume.Left.Value;
+        batch.VolR[voiceidx] = vc.Volume.Right.Value;
+        batch.DryL[voiceidx] = gates.DryL;
+        batch.DryR[voiceidx] = gates.DryR;
+        batch.WetL[voiceidx] = gates.WetL;
+        batch.WetR[voiceidx] = gates.WetR;
+    }
+
+    MixVoiceBatch<InterpType>(dest, batch);
+}
+
+static __forceinline void MixCoreVoices(VoiceMixSet &dest, const uint coreidx)
+{
+    // Optimization : Forceinline'd Templated Dispatch Table.  Any halfwit compiler will
+    // turn this into a clever jump dispatch table (no call/rets, no compares, uber-efficient!)
+
+    switch (Interpolation) {
+#if BATCH_VOICE_MIXER
+        case 0:
+            MixCoreVoicesBatched<0>(dest, coreidx);
+            break;
+        case 1:
+            MixCoreVoicesBatched<1>(dest, coreidx);
+            break;
+        case 2:
+            MixCoreVoicesBatched<2>(dest, coreidx);
+            break;
+        case 3:
+            MixCoreVoicesBatched<3>(dest, coreidx);
+            break;
+        case 4:
+            MixCoreVoicesBatched<4>(dest, coreidx);
+            break;
+#else
+        case 0:
+            MixCoreVoicesScalar<0>(dest, coreidx);
+            break;
+        case 1:
+            MixCoreVoicesScalar<1>(dest, coreidx);
+            break;
+        case 2:
+            MixCoreVoicesScalar<2>(dest, coreidx);
+            break;
+        case 3:
+            MixCoreVoicesScalar<3>(dest, coreidx);
+            break;
+        case 4:
+            MixCoreVoicesScalar<4>(dest, coreidx);
+            break;
+#endif
+
+            jNO_DEFAULT;
+    }
+}
+
+// --------------------------------------------------------------------------------------
+//  MixerSelfTest
+// --------------------------------------------------------------------------------------
+// Checks that MixCoreVoicesBatched gives the very same output as MixCoreVoicesScalar, and
+// leaves the very same state behind, for the 5 interpolations.  Returns the number of
+// mismatches.  Overwrites the cores and the SPU2 memory, so it must run before SPU2open.
+
+static u32 MixerTestSeed;
+
+static s32 MixerTestRand(s32 min, s32 max)
+{
+    MixerTestSeed = MixerTestSeed * 1103515245 + 12345;
+    const u32 r = (MixerTestSeed >> 16) | (MixerTestSeed << 16);
+    const u32 range = (u32)max - (u32)min;
+    return (s32)((u32)min + (range == 0xffffffff ? r : r % (range + 1)));
+}
+
+static s32 MixerTestValue()
+{
+    // The extremes half of the time, anything otherwise.
+    switch (MixerTestRand(0, 7)) {
+        case 0:
+            return 0x7fffffff;
+        case 1:
+            return -0x7fffffff - 1;
+        case 2:
+            return -1;
+        case 3:
+            return 0;
+        default:
+            return MixerTestRand(-0x7fffffff - 1, 0x7fffffff);
+    }
+}
+
+// Voices of all kinds: noise, silent (Phase 0), modulated, with negative volumes, and
+// reading from anywhere in memory (with the IRQ address of both cores on their way).
+static void MixerTestRandomizeCore(uint coreidx)
+{
+    V_Core &thiscore(Cores[coreidx]);
+
+    thiscore.IRQEnable = MixerTestRand(0, 1);
+    thiscore.IRQA = MixerTestRand(0, 0xfffff);
+    thiscore.Regs.ENDX = MixerTestRand(0, 0xffffff);
+
+    for (uint voiceidx = 0; voiceidx < V_Core::NumVoices; ++voiceidx) {
+        V_Voice &vc(thiscore.Voices[voiceidx]);
+        V_VoiceGates &gates(thiscore.VoiceGates[voiceidx]);
+
+        vc.Volume.Left.Value = MixerTestValue();
+        vc.Volume.Right.Value = MixerTestValue();
+        vc.Volume.Left.Mode = vc.Volume.Right.Mode = 0;
+
+        vc.ADSR.reg32 = MixerTestRand(-0x7fffffff - 1, 0x7fffffff);
+        vc.ADSR.Value = MixerTestRand(0, 0x7fffffff);
+        vc.ADSR.Phase = MixerTestRand(0, 5);
+        vc.ADSR.Releasing = MixerTestRand(0, 1);
+
+        vc.Pitch = MixerTestRand(0, 0x3fff);
+        vc.Modulated = MixerTestRand(0, 3) == 0;
+        vc.Noise = MixerTestRand(0, 3) == 0;
+        vc.LoopMode = MixerTestRand(0, 1);
+        vc.LoopFlags = MixerTestRand(0, 7);
+
+        vc.StartA = MixerTestRand(0, 0xfffff) & ~7;
+        vc.LoopStartA = MixerTestRand(0, 0xfffff) & ~7;
+        vc.NextA = MixerTestRand(0, 0xfffff);
+        vc.Prev1 = MixerTestRand(-0x8000, 0x7fff);
+        vc.Prev2 = MixerTestRand(-0x8000, 0x7fff);
+
+        vc.SP = MixerTestRand(-4095, 0);
+        vc.PV4 = MixerTestRand(-0x8000, 0x7fff);
+        vc.PV3 = MixerTestRand(-0x8000, 0x7fff);
+        vc.PV2 = MixerTestRand(-0x8000, 0x7fff);
+        vc.PV1 = MixerTestRand(-0x8000, 0x7fff);
+        vc.OutX = MixerTestRand(-0x8000, 0x7fff);
+        vc.NextCrest = MixerTestRand(-0x8000, 0x7fff);
+
+        for (uint i = 0; i < ArraySize(vc.SBuffer); ++i)
+            vc.SBuffer[i] = MixerTestRand(-0x8000, 0x7fff);
+        vc.SCurrent = MixerTestRand(1, 28);
+
+        gates.DryL = -MixerTestRand(0, 1);
+        gates.DryR = -MixerTestRand(0, 1);
+        gates.WetL = -MixerTestRand(0, 1);
+        gates.WetR = -MixerTestRand(0, 1);
+    }
+
+    if (MixerTestRand(0, 1))
+        Cores[MixerTestRand(0, 1)].IRQA = thiscore.Voices[MixerTestRand(0, V_Core::NumVoices - 1)].NextA + MixerTestRand(0, 8);
+}
+
+// The lanes alone, on values StepVoice never gives them (negative envelopes, full range
+// volumes), against the arithmetic of MixVoice.
+template <int InterpType>
+static int MixerTestLanes()
+{
+    int failed = 0;
+
+    for (int pass = 0; pass < 1000; ++pass) {
+        VoiceBatch batch;
+        VoiceMixSet expected(VoiceMixSet::Empty), actual(VoiceMixSet::Empty);
+
+        for (uint v = 0; v < V_Core::NumVoices; ++v) {
+            batch.PV4[v] = MixerTestRand(-0x8000, 0x7fff);
+            batch.PV3[v] = MixerTestRand(-0x8000, 0x7fff);
+            batch.PV2[v] = MixerTestRand(-0x8000, 0x7fff);
+            batch.PV1[v] = MixerTestRand(-0x8000, 0x7fff);
+            batch.SP[v] = MixerTestRand(-4095, 0);
+            batch.Noise[v] = MixerTestRand(-0x8000, 0x8000);
+            batch.NoiseMask[v] = -MixerTestRand(0, 1);
+            batch.ADSR[v] = MixerTestValue();
+            batch.VolL[v] = MixerTestValue();
+            batch.VolR[v] = MixerTestValue();
+            batch.DryL[v] = -MixerTestRand(0, 1);
+            batch.DryR[v] = -MixerTestRand(0, 1);
+            batch.WetL[v] = -MixerTestRand(0, 1);
+            batch.WetR[v] = -MixerTestRand(0, 1);
+
+            s32 Value = batch.NoiseMask[v] ? batch.Noise[v] : InterpolateVoice<InterpType, s32>(batch.PV4[v], batch.PV3[v], batch.PV2[v], batch.PV1[v], batch.SP[v]);
+            Value = MulShr32(Value, batch.ADSR[v]);
+
+            const s32 left = ApplyVolume(Value, batch.VolL[v]);
+            const s32 right = ApplyVolume(Value, batch.VolR[v]);
+
+            expected.Dry.Left += left & batch.DryL[v];
+            expected.Dry.Right += right & batch.DryR[v];
+            expected.Wet.Left += left & batch.WetL[v];
+            expected.Wet.Right += right & batch.WetR[v];
+        }
+
+        MixVoiceBatch<InterpType>(actual, batch);
+
+        if (memcmp(&expected, &actual, sizeof(expected)) != 0) {
+            if (failed++ == 0)
+                ConLog("* SPU2-X: Mixer self-test: lanes differ for interpolation %d: dry %d,%d wet %d,%d instead of dry %d,%d wet %d,%d\n",
+                       InterpType, actual.Dry.Left, actual.Dry.Right, actual.Wet.Left, actual.Wet.Right,
+                       expected.Dry.Left, expected.Dry.Right, expected.Wet.Left, expected.Wet.Right);
+        }
+    }
+
+    return failed;
+}
+
+// Both mixers from the same state of the cores, for a few hundred samples in a row.
+template <int InterpType>
+static int MixerTestCores()
+{
+    static const int Samples = 256;
+
+    std::vector<u8> cores(sizeof(Cores)), mem(0x200000);
+    std::vector<u8> scalarCores(sizeof(Cores)), scalarMem(0x200000);
+    std::vector<VoiceMixSet> scalarOut(Samples * 2, VoiceMixSet::Empty), batchedOut(Samples * 2, VoiceMixSet::Empty);
+
+    int failed = 0;
+
+    for (int pass = 0; pass < 20; ++pass) {
+        for (uint i = 0; i < 0x100000; ++i)
+            _spu2mem[i] = MixerTestRand(-0x8000, 0x7fff);
+        pcm_WipeCache();
+        MixerTestRandomizeCore(0);
+        MixerTestRandomizeCore(1);
+
+        memcpy(&cores[0], Cores, sizeof(Cores));
+        memcpy(&mem[0], _spu2mem, 0x200000);
+        const s32 seed = NoiseSeed;
+        const V_SPDIF spdif = Spdif;
+        const s16 outpos = OutPos;
+
+        for (int i = 0; i < Samples; ++i) {
+            OutPos = (outpos + i) & 0x1ff;
+            MixCoreVoicesScalar<InterpType>(scalarOut[i * 2], 0);
+            MixCoreVoicesScalar<InterpType>(scalarOut[i * 2 + 1], 1);
+        }
+
+        memcpy(&scalarCores[0], Cores, sizeof(Cores));
+        memcpy(&scalarMem[0], _spu2mem, 0x200000);
+        const s32 scalarSeed = NoiseSeed;
+        const u16 scalarInfo = Spdif.Info;
+
+        memcpy(Cores, &cores[0], sizeof(Cores));
+        memcpy(_spu2mem, &mem[0], 0x200000);
+        NoiseSeed = seed;
+        Spdif = spdif;
+        pcm_WipeCache();
+
+        for (int i = 0; i < Samples; ++i) {
+            OutPos = (outpos + i) & 0x1ff;
+            MixCoreVoicesBatched<InterpType>(batchedOut[i * 2], 0);
+            MixCoreVoicesBatched<InterpType>(batchedOut[i * 2 + 1], 1);
+        }
+
+        OutPos = outpos;
+
+        int sample = 0;
+        while (sample < Samples * 2 && memcmp(&scalarOut[sample], &batchedOut[sample], sizeof(VoiceMixSet)) == 0)
+            sample++;
+
+        const char *what = NULL;
+        if (sample < Samples * 2)
+            what = "output";
+        else if (memcmp(&scalarCores[0], Cores, sizeof(Cores)) != 0)
+            what = "voice state";
+        else if (memcmp(&scalarMem[0], _spu2mem, 0x200000) != 0)
+            what = "SPU2 memory";
+        else if (scalarSeed != NoiseSeed)
+            what = "noise";
+        else if (scalarInfo != Spdif.Info)
+            what = "IRQ";
+
+        if (what) {
+            if (failed++ == 0)
+                ConLog("* SPU2-X: Mixer self-test: %s differs for interpolation %d (pass %d, sample %d)\n", what, InterpType, pass, sample / 2);
+        }
+    }
+
+    return failed;
+}
+
+int MixerSelfTest()
+{
+    MixerTestSeed = 1;
+
+    const s32 seed = NoiseSeed;
+    const V_SPDIF spdif = Spdif;
+    const bool irq = has_to_call_irq;
+
+    int failed = 0;
+
+    failed += MixerTestLanes<0>() + MixerTestCores<0>();
+    failed += MixerTestLanes<1>() + MixerTestCores<1>();
+    failed += MixerTestLanes<2>() + MixerTestCores<2>();
+    failed += MixerTestLanes<3>() + MixerTestCores<3>();
+    failed += MixerTestLanes<4>() + MixerTestCores<4>();
+
+    NoiseSeed = seed;
+    Spdif = spdif;
+    has_to_call_irq = irq;
+
+    return failed;
+}
+
 StereoOut32 V_Core::Mix(const VoiceMixSet &inVoices, const StereoOut32 &Input, const StereoOut32 &Ext)
 {
     MasterVol.Update();
@@ -694,7 +1234,10 @@ StereoOut32 V_Core::Mix(const VoiceMixSet &inVoices, const StereoOut32 &Input, c
 
     WaveDump::WriteCore(Index, CoreSrc_PreReverb, TW);
 
+    const u64 reverbStart = g_MixerProfile.enabled ? __rdtsc() : 0;
     StereoOut32 RV = DoReverb(TW);
+    if (g_MixerProfile.enabled)
+        g_MixerProfile.reverb += __rdtsc() - reverbStart;
 
     WaveDump::WriteCore(Index, CoreSrc_PostReverb, RV);
 
@@ -792,6 +1335,8 @@ __forceinline
     void
     Mix()
 {
+    const u64 mixStart = g_MixerProfile.enabled ? __rdtsc() : 0;
+
     // Note: Playmode 4 is SPDIF, which overrides other inputs.
     StereoOut32 InputData[2] =
         {
@@ -809,8 +1354,11 @@ __forceinline
 
     // Todo: Replace me with memzero initializer!
     VoiceMixSet VoiceData[2] = {VoiceMixSet::Empty, VoiceMixSet::Empty}; // mixed voice data for each core.
+    const u64 voicesStart = g_MixerProfile.enabled ? __rdtsc() : 0;
     MixCoreVoices(VoiceData[0], 0);
     MixCoreVoices(VoiceData[1], 1);
+    if (g_MixerProfile.enabled)
+        g_MixerProfile.voices += __rdtsc() - voicesStart;
 
     StereoOut32 Ext(Cores[0].Mix(VoiceData[0], InputData[0], StereoOut32::Empty));
 
@@ -865,6 +1413,11 @@ __forceinline
     Out.Left *= FinalVolume;
     Out.Right *= FinalVolume;
 
+    if (g_MixerProfile.enabled) {
+        g_MixerProfile.mix += __rdtsc() - mixStart;
+        g_MixerProfile.samples++;
+    }
+
     SndBuffer::Write(Out);
 
     // Update AutoDMA output positioning
@@ -876,15 +1429,15 @@ __forceinline
         p_cachestat_counter++;
         if (p_cachestat_counter > (48000 * 10)) {
             p_cachestat_counter = 0;
-            if (MsgCache())
-                ConLog(" * SPU2 > CacheStats > Hits: %d  Misses: %d  Ignores: %d\n",
-                       g_counter_cache_hits,
-                       g_counter_cache_misses,
-                       g_counter_cache_ignores);
-
-            g_counter_cache_hits =
-                g_counter_cache_misses =
-                    g_counter_cache_ignores = 0;
+            if (MsgCache()) {
+                const PcmCacheStats &stats(pcm_CacheStats);
+                const u32 lookups = stats.hits + stats.misses;
+                ConLog(" * SPU2 > CacheStats > Hits: %u  Misses: %u  Ignores: %u  Evictions: %u  (%.1f%% hit rate)\n",
+                       stats.hits, stats.misses, stats.ignores, stats.evictions,
+                       lookups ? stats.hits * 100.0 / lookups : 0.0);
+            }
+
+            memset(&pcm_CacheStats, 0, sizeof(pcm_CacheStats));
         }
     }
 }
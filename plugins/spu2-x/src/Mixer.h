@@ -133,3 +133,7 @@ extern void Mix();
 extern s32 clamp_mix(s32 x, u8 bitshift = 0);
 
 extern StereoOut32 clamp_mix(const StereoOut32 &sample, u8 bitshift = 0);
+
+// Compare the SIMD mixer and reverb with the scalar code, return the number of mismatches.
+extern int MixerSelfTest();
+extern int ReverbSelfTest();
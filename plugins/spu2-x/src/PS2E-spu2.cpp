@@ -327,13 +327,10 @@ SPU2init()
     _spu2mem = (s16 *)malloc(0x200000);
 
     // adpcm decoder cache:
-    //  the cache data size is determined by taking the number of adpcm blocks
-    //  (2MB / 16) and multiplying it by the decoded block size (28 samples).
-    //  Thus: pcm_cache_data = 7,340,032 bytes (ouch!)
-    //  Expanded: 16 bytes expands to 56 bytes [3.5:1 ratio]
-    //    Resulting in 2MB * 3.5.
+    //  only the blocks being played are kept decoded, see pcm_CacheSets.  Covering the
+    //  whole of the 2MB of SPU2 ram would take 2MB / 16 blocks of 28 samples (7MB).
 
-    pcm_cache_data = (PcmCacheEntry *)calloc(pcm_BlockCount, sizeof(PcmCacheEntry));
+    pcm_cache_data = (PcmCacheEntry *)calloc(pcm_CacheSets * pcm_CacheWays, sizeof(PcmCacheEntry));
 
     if ((spu2regs == NULL) || (_spu2mem == NULL) || (pcm_cache_data == NULL)) {
         SysMessage("SPU2-X: Error allocating Memory\n");
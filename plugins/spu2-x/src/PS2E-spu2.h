@@ -48,9 +48,9 @@ SPU2write(u32 mem, u16 value);
 EXPORT_C_(u16)
 SPU2read(u32 mem);
 
-// These defines are useless and gcc-4.6 complain about redefinition
-// so we remove them on linux
-#ifndef __POSIX__
+// These are already declared by PS2Edefs.h (with an int size) when the plugin is built
+// into pcsx2 on linux, and gcc complains about the redefinition.
+#if !defined(__POSIX__) || !defined(BUILTIN_SPU2_PLUGIN)
 EXPORT_C_(void)
 SPU2readDMA4Mem(u16 *pMem, u32 size);
 EXPORT_C_(void)
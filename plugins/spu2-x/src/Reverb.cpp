@@ -17,6 +17,31 @@
 
 #include "Global.h"
 
+#include <emmintrin.h>
+
+// Works out the reverb buffer addresses of a sample with SSE2, 4 taps at a time, see
+// DoReverb.  0 falls back on RevbGetIndexer for each tap, which gives the same output.
+#define SIMD_REVERB_TAPS 1
+
+// The buffer addresses one channel of DoReverb works with, see V_ReverbBuffers::Taps.
+enum RevbTap {
+    Tap_SameSrc,
+    Tap_SameDst,
+    Tap_SamePrv,
+    Tap_DiffSrc,
+    Tap_DiffDst,
+    Tap_DiffPrv,
+    Tap_Comb1Src,
+    Tap_Comb2Src,
+    Tap_Comb3Src,
+    Tap_Comb4Src,
+    Tap_Apf1Src,
+    Tap_Apf1Dst,
+    Tap_Apf2Src,
+    Tap_Apf2Dst,
+    Tap_Count
+};
+
 __forceinline s32 V_Core::RevbGetIndexer(s32 offset)
 {
     u32 pos = ReverbX + offset;
@@ -33,6 +58,35 @@ __forceinline s32 V_Core::RevbGetIndexer(s32 offset)
     return pos;
 }
 
+void V_Core::Reverb_UpdateTaps()
+{
+    for (int ch = 0; ch < 2; ch++) {
+        const bool R = ch;
+        s32 *taps = RevBuffers.Taps[ch];
+
+        taps[Tap_SameSrc] = R ? RevBuffers.SAME_R_SRC : RevBuffers.SAME_L_SRC;
+        taps[Tap_SameDst] = R ? RevBuffers.SAME_R_DST : RevBuffers.SAME_L_DST;
+        taps[Tap_SamePrv] = R ? RevBuffers.SAME_R_PRV : RevBuffers.SAME_L_PRV;
+
+        taps[Tap_DiffSrc] = R ? RevBuffers.DIFF_L_SRC : RevBuffers.DIFF_R_SRC;
+        taps[Tap_DiffDst] = R ? RevBuffers.DIFF_R_DST : RevBuffers.DIFF_L_DST;
+        taps[Tap_DiffPrv] = R ? RevBuffers.DIFF_R_PRV : RevBuffers.DIFF_L_PRV;
+
+        taps[Tap_Comb1Src] = R ? RevBuffers.COMB1_R_SRC : RevBuffers.COMB1_L_SRC;
+        taps[Tap_Comb2Src] = R ? RevBuffers.COMB2_R_SRC : RevBuffers.COMB2_L_SRC;
+        taps[Tap_Comb3Src] = R ? RevBuffers.COMB3_R_SRC : RevBuffers.COMB3_L_SRC;
+        taps[Tap_Comb4Src] = R ? RevBuffers.COMB4_R_SRC : RevBuffers.COMB4_L_SRC;
+
+        taps[Tap_Apf1Src] = R ? RevBuffers.APF1_R_SRC : RevBuffers.APF1_L_SRC;
+        taps[Tap_Apf1Dst] = R ? RevBuffers.APF1_R_DST : RevBuffers.APF1_L_DST;
+        taps[Tap_Apf2Src] = R ? RevBuffers.APF2_R_SRC : RevBuffers.APF2_L_SRC;
+        taps[Tap_Apf2Dst] = R ? RevBuffers.APF2_R_DST : RevBuffers.APF2_L_DST;
+
+        for (int i = Tap_Count; i < 16; i++)
+            taps[i] = taps[0];
+    }
+}
+
 void V_Core::Reverb_AdvanceBuffer()
 {
     if (RevBuffers.NeedsUpdated)
@@ -45,6 +99,33 @@ void V_Core::Reverb_AdvanceBuffer()
     }
 }
 
+#if SIMD_REVERB_TAPS
+// Same single step wrapping as RevbGetIndexer, for the 16 taps of a channel, with the
+// unsigned compare done on signed lanes by flipping the sign bits.
+static __forceinline void GetTapPositions(__m128i (&vpos)[4], const s32 *taps, u32 reverbX, u32 startA, u32 endA)
+{
+    const __m128i sign = _mm_set1_epi32(0x80000000);
+    const __m128i x = _mm_set1_epi32(reverbX);
+    const __m128i end = _mm_set1_epi32(endA ^ 0x80000000);
+    const __m128i wrap = _mm_set1_epi32(endA + 1 - startA);
+
+    for (int i = 0; i < 4; i++) {
+        const __m128i p = _mm_add_epi32(x, _mm_loadu_si128((const __m128i *)&taps[i * 4]));
+        const __m128i over = _mm_cmpgt_epi32(_mm_xor_si128(p, sign), end);
+        vpos[i] = _mm_sub_epi32(p, _mm_and_si128(over, wrap));
+    }
+}
+
+// Whether addr is one of the tap positions (the padding only repeats the first tap).
+static __forceinline bool IsTapPosition(const __m128i (&vpos)[4], u32 addr)
+{
+    const __m128i a = _mm_set1_epi32(addr);
+    const __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi32(vpos[0], a), _mm_cmpeq_epi32(vpos[1], a)),
+                                     _mm_or_si128(_mm_cmpeq_epi32(vpos[2], a), _mm_cmpeq_epi32(vpos[3], a)));
+    return _mm_movemask_epi8(hit) != 0;
+}
+#endif
+
 /////////////////////////////////////////////////////////////////////////////////////////
 
 StereoOut32 V_Core::DoReverb(const StereoOut32 &Input)
@@ -56,24 +137,21 @@ StereoOut32 V_Core::DoReverb(const StereoOut32 &Input)
     bool R = Cycles & 1;
 
     // Calculate the read/write addresses we'll be needing for this session of reverb.
+    // The reverb feeds back through SPU2 memory from one sample to the next, so only the
+    // addresses (and the IRQ test on them) are worth doing in parallel; the reads and
+    // writes below keep their order.
 
-    const u32 same_src = RevbGetIndexer(R ? RevBuffers.SAME_R_SRC : RevBuffers.SAME_L_SRC);
-    const u32 same_dst = RevbGetIndexer(R ? RevBuffers.SAME_R_DST : RevBuffers.SAME_L_DST);
-    const u32 same_prv = RevbGetIndexer(R ? RevBuffers.SAME_R_PRV : RevBuffers.SAME_L_PRV);
-
-    const u32 diff_src = RevbGetIndexer(R ? RevBuffers.DIFF_L_SRC : RevBuffers.DIFF_R_SRC);
-    const u32 diff_dst = RevbGetIndexer(R ? RevBuffers.DIFF_R_DST : RevBuffers.DIFF_L_DST);
-    const u32 diff_prv = RevbGetIndexer(R ? RevBuffers.DIFF_R_PRV : RevBuffers.DIFF_L_PRV);
-
-    const u32 comb1_src = RevbGetIndexer(R ? RevBuffers.COMB1_R_SRC : RevBuffers.COMB1_L_SRC);
-    const u32 comb2_src = RevbGetIndexer(R ? RevBuffers.COMB2_R_SRC : RevBuffers.COMB2_L_SRC);
-    const u32 comb3_src = RevbGetIndexer(R ? RevBuffers.COMB3_R_SRC : RevBuffers.COMB3_L_SRC);
-    const u32 comb4_src = RevbGetIndexer(R ? RevBuffers.COMB4_R_SRC : RevBuffers.COMB4_L_SRC);
+    __aligned16 u32 pos[16];
 
-    const u32 apf1_src = RevbGetIndexer(R ? RevBuffers.APF1_R_SRC : RevBuffers.APF1_L_SRC);
-    const u32 apf1_dst = RevbGetIndexer(R ? RevBuffers.APF1_R_DST : RevBuffers.APF1_L_DST);
-    const u32 apf2_src = RevbGetIndexer(R ? RevBuffers.APF2_R_SRC : RevBuffers.APF2_L_SRC);
-    const u32 apf2_dst = RevbGetIndexer(R ? RevBuffers.APF2_R_DST : RevBuffers.APF2_L_DST);
+#if SIMD_REVERB_TAPS
+    __m128i vpos[4];
+    GetTapPositions(vpos, RevBuffers.Taps[R], ReverbX, EffectsStartA, EffectsEndA);
+    for (int i = 0; i < 4; i++)
+        _mm_store_si128((__m128i *)&pos[i * 4], vpos[i]);
+#else
+    for (int i = 0; i < Tap_Count; i++)
+        pos[i] = RevbGetIndexer(RevBuffers.Taps[R][i]);
+#endif
 
     // -----------------------------------------
     //          Optimized IRQ Testing !
@@ -86,21 +164,38 @@ StereoOut32 V_Core::DoReverb(const StereoOut32 &Input)
 
     for (int i = 0; i < 2; i++) {
         if (Cores[i].IRQEnable && ((Cores[i].IRQA >= EffectsStartA) && (Cores[i].IRQA <= EffectsEndA))) {
-            if ((Cores[i].IRQA == same_src) || (Cores[i].IRQA == diff_src) ||
-                (Cores[i].IRQA == same_dst) || (Cores[i].IRQA == diff_dst) ||
-                (Cores[i].IRQA == same_prv) || (Cores[i].IRQA == diff_prv) ||
-
-                (Cores[i].IRQA == comb1_src) || (Cores[i].IRQA == comb2_src) ||
-                (Cores[i].IRQA == comb3_src) || (Cores[i].IRQA == comb4_src) ||
-
-                (Cores[i].IRQA == apf1_dst) || (Cores[i].IRQA == apf1_src) ||
-                (Cores[i].IRQA == apf2_dst) || (Cores[i].IRQA == apf2_src)) {
+#if SIMD_REVERB_TAPS
+            if (IsTapPosition(vpos, Cores[i].IRQA)) {
+#else
+            bool hit = false;
+            for (int t = 0; t < Tap_Count; t++)
+                hit |= Cores[i].IRQA == pos[t];
+            if (hit) {
+#endif
                 //printf("Core %d IRQ Called (Reverb). IRQA = %x\n",i,addr);
                 SetIrqCall(i);
             }
         }
     }
 
+    const u32 same_src = pos[Tap_SameSrc];
+    const u32 same_dst = pos[Tap_SameDst];
+    const u32 same_prv = pos[Tap_SamePrv];
+
+    const u32 diff_src = pos[Tap_DiffSrc];
+    const u32 diff_dst = pos[Tap_DiffDst];
+    const u32 diff_prv = pos[Tap_DiffPrv];
+
+    const u32 comb1_src = pos[Tap_Comb1Src];
+    const u32 comb2_src = pos[Tap_Comb2Src];
+    const u32 comb3_src = pos[Tap_Comb3Src];
+    const u32 comb4_src = pos[Tap_Comb4Src];
+
+    const u32 apf1_src = pos[Tap_Apf1Src];
+    const u32 apf1_dst = pos[Tap_Apf1Dst];
+    const u32 apf2_src = pos[Tap_Apf2Src];
+    const u32 apf2_dst = pos[Tap_Apf2Dst];
+
     // Reverb algorithm pretty much directly ripped from http://drhell.web.fc2.com/ps1/
     // minus the 35 step FIR which just seems to break things.
 
@@ -131,3 +226,105 @@ StereoOut32 V_Core::DoReverb(const StereoOut32 &Input)
 
     return LastEffect;
 }
+
+// --------------------------------------------------------------------------------------
+//  ReverbSelfTest
+// --------------------------------------------------------------------------------------
+// Checks the tap positions DoReverb works out with SSE2, and its IRQ test on them,
+// against RevbGetIndexer.  Returns the number of mismatches.
+
+static u32 ReverbTestSeed;
+
+static u32 ReverbTestRand(u32 range)
+{
+    ReverbTestSeed = ReverbTestSeed * 1103515245 + 12345;
+    return ((ReverbTestSeed >> 16) | (ReverbTestSeed << 16)) % range;
+}
+
+int ReverbSelfTest()
+{
+    int failed = 0;
+
+#if SIMD_REVERB_TAPS
+    V_Core &core(Cores[0]);
+    const u32 reverbX = core.ReverbX;
+    const u32 startA = core.EffectsStartA;
+    const u32 endA = core.EffectsEndA;
+
+    ReverbTestSeed = 1;
+
+    for (int pass = 0; pass < 100000; pass++) {
+        // From a few words up to all of the memory, sometimes right at its end.
+        const u32 size = 1 + ReverbTestRand(pass & 1 ? 32 : 0x100000);
+        core.EffectsStartA = pass % 8 == 0 ? 0x100000 - size : ReverbTestRand(0x100000 - size + 1);
+        core.EffectsEndA = core.EffectsStartA + size - 1;
+        core.ReverbX = pass % 4 == 2 ? size - 1 : ReverbTestRand(size);
+
+        // The taps are addresses in the buffer (see UpdateEffectsBufferSize), and plenty
+        // of them are right where their position wraps at EffectsEndA.
+        const u32 wrapA = core.EffectsEndA + 1 - core.ReverbX;
+        __aligned16 s32 taps[16];
+
+        for (int t = 0; t < Tap_Count; t++) {
+            switch (ReverbTestRand(4)) {
+                case 0:
+                    taps[t] = core.ReverbX ? wrapA : core.EffectsStartA;
+                    break;
+                case 1:
+                    taps[t] = wrapA - 1;
+                    break;
+                default:
+                    taps[t] = core.EffectsStartA + ReverbTestRand(size);
+                    break;
+            }
+        }
+
+        for (int t = Tap_Count; t < 16; t++)
+            taps[t] = taps[0];
+
+        __m128i vpos[4];
+        __aligned16 u32 pos[16];
+
+        GetTapPositions(vpos, taps, core.ReverbX, core.EffectsStartA, core.EffectsEndA);
+        for (int i = 0; i < 4; i++)
+            _mm_store_si128((__m128i *)&pos[i * 4], vpos[i]);
+
+        for (int t = 0; t < 16; t++) {
+            const u32 expected = core.RevbGetIndexer(taps[t < Tap_Count ? t : 0]);
+            if (pos[t] != expected) {
+                if (failed++ == 0)
+                    ConLog("* SPU2-X: Reverb self-test: tap %d at %x instead of %x (buffer %x-%x, offset %x)\n",
+                           t, pos[t], expected, core.EffectsStartA, core.EffectsEndA, core.ReverbX);
+            }
+        }
+
+        // IRQA on a tap, on the first one (which the padding repeats), next to one, where
+        // a zero padding would be, and anywhere.
+        const u32 irqa[] = {
+            pos[ReverbTestRand(Tap_Count)],
+            pos[0],
+            pos[ReverbTestRand(Tap_Count)] + 1,
+            core.ReverbX,
+            core.EffectsStartA + ReverbTestRand(size),
+        };
+
+        for (uint i = 0; i < ArraySize(irqa); i++) {
+            bool expected = false;
+            for (int t = 0; t < Tap_Count; t++)
+                expected |= (u32)core.RevbGetIndexer(taps[t]) == irqa[i];
+
+            if (IsTapPosition(vpos, irqa[i]) != expected) {
+                if (failed++ == 0)
+                    ConLog("* SPU2-X: Reverb self-test: IRQ at %x %s (buffer %x-%x, offset %x)\n",
+                           irqa[i], expected ? "missed" : "called for nothing", core.EffectsStartA, core.EffectsEndA, core.ReverbX);
+            }
+        }
+    }
+
+    core.ReverbX = reverbX;
+    core.EffectsStartA = startA;
+    core.EffectsEndA = endA;
+#endif
+
+    return failed;
+}
@@ -111,11 +111,16 @@ int FindOutputModuleById(const wchar_t *omodid)
 
 StereoOut32 *SndBuffer::m_buffer;
 s32 SndBuffer::m_size;
-__aligned(4) volatile s32 SndBuffer::m_rpos;
-__aligned(4) volatile s32 SndBuffer::m_wpos;
+std::atomic<s32> SndBuffer::m_rpos;
+std::atomic<s32> SndBuffer::m_wpos;
+
+u64 *SndBuffer::m_stamps = NULL;
+SndBufferStats SndBuffer::m_stats;
+std::atomic<u32> SndBuffer::m_overruns;
 
 bool SndBuffer::m_underrun_freeze;
 StereoOut32 *SndBuffer::sndTempBuffer = NULL;
+StereoOut32 *SndBuffer::sndStretchBuffer = NULL;
 StereoOut16 *SndBuffer::sndTempBuffer16 = NULL;
 int SndBuffer::sndTempProgress = 0;
 
@@ -150,6 +155,7 @@ bool SndBuffer::CheckUnderrunStatus(int &nSamples, int &quietSampleCount)
         nSamples = data;
         quietSampleCount = SndOutPacketSize - data;
         m_underrun_freeze = true;
+        m_stats.underruns++;
 
         if (SynchMode == 0) // TimeStrech on
             timeStretchUnderrun();
@@ -171,57 +177,61 @@ void SndBuffer::_InitFail()
 int SndBuffer::_GetApproximateDataInBuffer()
 {
     // WARNING: not necessarily 100% up to date by the time it's used, but it will have to do.
-    return (m_wpos + m_size - m_rpos) % m_size;
+    return (m_wpos.load(std::memory_order_acquire) + m_size - m_rpos.load(std::memory_order_acquire)) % m_size;
 }
 
-void SndBuffer::_WriteSamples_Internal(StereoOut32 *bData, int nSamples)
+void SndBuffer::_WriteSamples_Safe(StereoOut32 *bData, int nSamples)
 {
-    // WARNING: This assumes the write will NOT wrap around,
-    // and also assumes there's enough free space in the buffer.
-
-    memcpy(m_buffer + m_wpos, bData, nSamples * sizeof(StereoOut32));
-    m_wpos = (m_wpos + nSamples) % m_size;
+    // WARNING: This code assumes there's only ONE writing process, and that there's
+    // enough free space in the buffer.
+    const s32 wpos = m_wpos.load(std::memory_order_relaxed);
+    const int b1 = std::min(m_size - wpos, nSamples);
+    const int b2 = nSamples - b1;
+
+    memcpy(m_buffer + wpos, bData, b1 * sizeof(StereoOut32));
+    memcpy(m_buffer, bData + b1, b2 * sizeof(StereoOut32));
+
+    // Stamp the packets which start in this batch.  A packet is stamped once per lap, so the
+    // reader never sees a stamp being written.
+    const u64 now = GetCPUTicks();
+    for (int pos = (wpos + SndOutPacketSize - 1) & ~(SndOutPacketSize - 1); pos < wpos + nSamples; pos += SndOutPacketSize)
+        m_stamps[(pos % m_size) / SndOutPacketSize] = now;
+
+    // Publish the samples (and stamps) to the reader.
+    m_wpos.store((wpos + nSamples) % m_size, std::memory_order_release);
 }
 
 void SndBuffer::_DropSamples_Internal(int nSamples)
 {
-    m_rpos = (m_rpos + nSamples) % m_size;
+    m_rpos.store((m_rpos.load(std::memory_order_relaxed) + nSamples) % m_size, std::memory_order_release);
 }
 
-void SndBuffer::_ReadSamples_Internal(StereoOut32 *bData, int nSamples)
+void SndBuffer::_UpdateLatencyStats(s32 rpos, int nSamples)
 {
-    // WARNING: This assumes the read will NOT wrap around,
-    // and also assumes there's enough data in the buffer.
-    memcpy(bData, m_buffer + m_rpos, nSamples * sizeof(StereoOut32));
-    _DropSamples_Internal(nSamples);
-}
+    // Uses the stamp of the first packet which starts in what is being read.  The writer
+    // can't stamp it again before the read is done, unlike the packet rpos is in when a
+    // short read (an underrun) left it in the middle of one.
+    const s32 packet = (rpos + SndOutPacketSize - 1) & ~(SndOutPacketSize - 1);
+    if (packet >= rpos + nSamples)
+        return;
 
-void SndBuffer::_WriteSamples_Safe(StereoOut32 *bData, int nSamples)
-{
-    // WARNING: This code assumes there's only ONE writing process.
-    if ((m_size - m_wpos) < nSamples) {
-        int b1 = m_size - m_wpos;
-        int b2 = nSamples - b1;
-
-        _WriteSamples_Internal(bData, b1);
-        _WriteSamples_Internal(bData + b1, b2);
-    } else {
-        _WriteSamples_Internal(bData, nSamples);
-    }
-}
+    const u64 latency = GetCPUTicks() - m_stamps[(packet % m_size) / SndOutPacketSize];
+    m_stats.latency += latency;
+    m_stats.latencyMax = std::max(m_stats.latencyMax, latency);
 
-void SndBuffer::_ReadSamples_Safe(StereoOut32 *bData, int nSamples)
-{
-    // WARNING: This code assumes there's only ONE reading process.
-    if ((m_size - m_rpos) < nSamples) {
-        int b1 = m_size - m_rpos;
-        int b2 = nSamples - b1;
-
-        _ReadSamples_Internal(bData, b1);
-        _ReadSamples_Internal(bData + b1, b2);
-    } else {
-        _ReadSamples_Internal(bData, nSamples);
+    // Every 10 seconds or so.
+    if (++m_stats.packets < SampleRate * 10 / SndOutPacketSize)
+        return;
+
+    const u32 overruns = m_overruns.exchange(0, std::memory_order_relaxed);
+    if (MsgOverruns()) {
+        const double ms = 1000.0 / GetTickFrequency();
+        ConLog(" * SPU2 > Output latency: %.2f ms avg (%.2f ms max) at %d ms, %u underruns, %u overruns\n",
+               m_stats.latency * ms / m_stats.packets, m_stats.latencyMax * ms,
+               SndOutLatencyMS, m_stats.underruns, overruns);
     }
+
+    memset(&m_stats, 0, sizeof(m_stats));
 }
 
 // Note: When using with 32 bit output buffers, the user of this function is responsible
@@ -251,7 +261,8 @@ void SndBuffer::ReadSamples(T *bData)
         pxAssume(nSamples <= SndOutPacketSize);
 
         // WARNING: This code assumes there's only ONE reading process.
-        int b1 = m_size - m_rpos;
+        const s32 rpos = m_rpos.load(std::memory_order_relaxed);
+        int b1 = m_size - rpos;
 
         if (b1 > nSamples)
             b1 = nSamples;
@@ -259,7 +270,7 @@ void SndBuffer::ReadSamples(T *bData)
         if (AdvancedVolumeControl) {
             // First part
             for (int i = 0; i < b1; i++)
-                bData[i].AdjustFrom(m_buffer[i + m_rpos]);
+                bData[i].AdjustFrom(m_buffer[i + rpos]);
 
             // Second part
             int b2 = nSamples - b1;
@@ -268,7 +279,7 @@ void SndBuffer::ReadSamples(T *bData)
         } else {
             // First part
             for (int i = 0; i < b1; i++)
-                bData[i].ResampleFrom(m_buffer[i + m_rpos]);
+                bData[i].ResampleFrom(m_buffer[i + rpos]);
 
             // Second part
             int b2 = nSamples - b1;
@@ -276,6 +287,7 @@ void SndBuffer::ReadSamples(T *bData)
                 bData[i + b1].ResampleFrom(m_buffer[i]);
         }
 
+        _UpdateLatencyStats(rpos, nSamples);
         _DropSamples_Internal(nSamples);
     }
 
@@ -348,10 +360,17 @@ void SndBuffer::_WriteSamples(StereoOut32 *bData, int nSamples)
 			ConLog(" * SPU2 > Overrun Compensation (%d packets tossed)\n", comp / SndOutPacketSize );
 		lastPct = 0.0;		// normalize the timestretcher
 #else
+        // Toss the packets which don't fit.
+        const int fit = (free - 1) & ~(SndOutPacketSize - 1);
+
+        m_overruns.fetch_add(1, std::memory_order_relaxed);
         if (MsgOverruns())
-            ConLog(" * SPU2 > Overrun! 1 packet tossed)\n");
+            ConLog(" * SPU2 > Overrun! %d packet(s) tossed\n", (nSamples - fit + SndOutPacketSize - 1) / SndOutPacketSize);
         lastPct = 0.0; // normalize the timestretcher
-        return;
+
+        if (fit == 0)
+            return;
+        nSamples = fit;
 #endif
     }
 
@@ -372,13 +391,19 @@ void SndBuffer::Init()
     m_rpos = 0;
     m_wpos = 0;
 
+    InitCPUTicks();
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_overruns = 0;
+
     try {
         const float latencyMS = SndOutLatencyMS * 16;
         m_size = GetAlignedBufferSize((int)(latencyMS * SampleRate / 1000.0f));
         m_buffer = new StereoOut32[m_size];
+        m_stamps = new u64[m_size / SndOutPacketSize]();
         m_underrun_freeze = false;
 
-        sndTempBuffer = new StereoOut32[SndOutPacketSize];
+        sndTempBuffer = new StereoOut32[SndOutPacketSize * SndOutWriteBatch];
+        sndStretchBuffer = new StereoOut32[SndOutPacketSize * SndOutWriteBatch];
         sndTempBuffer16 = new StereoOut16[SndOutPacketSize * 2]; // in case of leftovers.
     } catch (std::bad_alloc &) {
         // out of memory exception (most likely)
@@ -404,7 +429,9 @@ void SndBuffer::Cleanup()
     soundtouchCleanup();
 
     safe_delete_array(m_buffer);
+    safe_delete_array(m_stamps);
     safe_delete_array(sndTempBuffer);
+    safe_delete_array(sndStretchBuffer);
     safe_delete_array(sndTempBuffer16);
 }
 
@@ -432,55 +459,78 @@ void SndBuffer::Write(const StereoOut32 &Sample)
 
     sndTempBuffer[sndTempProgress++] = Sample;
 
-    // If we haven't accumulated a full packet yet, do nothing more:
-    if (sndTempProgress < SndOutPacketSize)
+    // The samples are passed on a batch of packets at a time, by TimeUpdate once it's done
+    // mixing, or here when the batch is full.
+    if (sndTempProgress == SndOutPacketSize * SndOutWriteBatch)
+        Flush();
+}
+
+// Passes on all the complete packets Write() gathered, and keeps the rest for later.
+void SndBuffer::Flush()
+{
+    const int packets = sndTempProgress / SndOutPacketSize;
+    if (packets == 0)
         return;
-    sndTempProgress = 0;
 
+    _WritePackets(sndTempBuffer, packets);
+
+    sndTempProgress -= packets * SndOutPacketSize;
+    memmove(sndTempBuffer, sndTempBuffer + packets * SndOutPacketSize, sndTempProgress * sizeof(StereoOut32));
+}
+
+void SndBuffer::_WritePackets(StereoOut32 *bData, int nPackets)
+{
     //Don't play anything directly after loading a savestate, avoids static killing your speakers.
-    if (ssFreeze > 0) {
+    for (int i = 0; i < nPackets && ssFreeze > 0; i++) {
         ssFreeze--;
         // Play silence
-        std::fill_n(sndTempBuffer, SndOutPacketSize, StereoOut32{});
+        std::fill_n(bData + i * SndOutPacketSize, SndOutPacketSize, StereoOut32{});
     }
 #ifndef __POSIX__
     if (dspPluginEnabled) {
-        // Convert in, send to winamp DSP, and convert out.
+        for (int p = 0; p < nPackets; p++) {
+            StereoOut32 *packet = bData + p * SndOutPacketSize;
 
-        int ei = m_dsp_progress;
-        for (int i = 0; i < SndOutPacketSize; ++i, ++ei) {
-            sndTempBuffer16[ei] = sndTempBuffer[i].DownSample();
-        }
-        m_dsp_progress += DspProcess((s16 *)sndTempBuffer16 + m_dsp_progress, SndOutPacketSize);
+            // Convert in, send to winamp DSP, and convert out.
 
-        // Some ugly code to ensure full packet handling:
-        ei = 0;
-        while (m_dsp_progress >= SndOutPacketSize) {
+            int ei = m_dsp_progress;
             for (int i = 0; i < SndOutPacketSize; ++i, ++ei) {
-                sndTempBuffer[i] = sndTempBuffer16[ei].UpSample();
+                sndTempBuffer16[ei] = packet[i].DownSample();
+            }
+            m_dsp_progress += DspProcess((s16 *)sndTempBuffer16 + m_dsp_progress, SndOutPacketSize);
+
+            // Some ugly code to ensure full packet handling (the input packet is
+            // converted already, so it holds the output):
+            ei = 0;
+            while (m_dsp_progress >= SndOutPacketSize) {
+                for (int i = 0; i < SndOutPacketSize; ++i, ++ei) {
+                    packet[i] = sndTempBuffer16[ei].UpSample();
+                }
+
+                if (SynchMode == 0) // TimeStrech on
+                    timeStretchWrite(packet);
+                else
+                    _WriteSamples(packet, SndOutPacketSize);
+
+                m_dsp_progress -= SndOutPacketSize;
             }
 
-            if (SynchMode == 0) // TimeStrech on
-                timeStretchWrite();
-            else
-                _WriteSamples(sndTempBuffer, SndOutPacketSize);
-
-            m_dsp_progress -= SndOutPacketSize;
-        }
-
-        // copy any leftovers to the front of the dsp buffer.
-        if (m_dsp_progress > 0) {
-            memcpy(sndTempBuffer16, &sndTempBuffer16[ei],
-                   sizeof(sndTempBuffer16[0]) * m_dsp_progress);
+            // copy any leftovers to the front of the dsp buffer.
+            if (m_dsp_progress > 0) {
+                memcpy(sndTempBuffer16, &sndTempBuffer16[ei],
+                       sizeof(sndTempBuffer16[0]) * m_dsp_progress);
+            }
         }
+        return;
     }
 #endif
-    else {
-        if (SynchMode == 0) // TimeStrech on
-            timeStretchWrite();
-        else
-            _WriteSamples(sndTempBuffer, SndOutPacketSize);
-    }
+
+    // The stretcher adjusts its tempo for each packet, anything else goes in at once.
+    if (SynchMode == 0) { // TimeStrech on
+        for (int p = 0; p < nPackets; p++)
+            timeStretchWrite(bData + p * SndOutPacketSize);
+    } else
+        _WriteSamples(bData, nPackets * SndOutPacketSize);
 }
 
 s32 SndBuffer::Test()
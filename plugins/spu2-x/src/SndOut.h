@@ -17,11 +17,17 @@
 
 #pragma once
 
+#include <atomic>
+
 // Number of stereo samples per SndOut block.
 // All drivers must work in units of this size when communicating with
 // SndOut.
 static const int SndOutPacketSize = 64;
 
+// Number of packets SndBuffer::Write gathers at most before passing them on together
+// (TimeUpdate flushes them sooner, see SndBuffer::Flush).
+static const int SndOutWriteBatch = 16;
+
 // Overall master volume shift; this is meant to be a precision value and does not affect
 // actual output volumes.  It converts SPU2 16 bit volumes to 32-bit volumes, and likewise
 // downsamples 32 bit samples to 16 bit sound driver output (this way timestretching and
@@ -561,7 +567,20 @@ struct Stereo51Out32
     }
 };
 
+// Counted by the reading (output module) thread, see SndBuffer::ReadSamples.
+struct SndBufferStats
+{
+    u64 latency;    // sum of the time the packets read spent in the buffer, in GetCPUTicks() units
+    u64 latencyMax;
+    u32 packets;
+    u32 underruns;
+};
+
 // Developer Note: This is a static class only (all static members).
+//
+// The buffer is a single producer / single consumer ring: the SPU2 thread writes, and the
+// output module's thread reads.  Each end only ever stores its own position, with release
+// semantics once the samples are copied, and loads the other one with acquire semantics.
 class SndBuffer
 {
 private:
@@ -569,7 +588,8 @@ private:
     static s32 m_predictData;
     static float lastPct;
 
-    static StereoOut32 *sndTempBuffer;
+    static StereoOut32 *sndTempBuffer;    // samples gathered by Write, SndOutWriteBatch packets
+    static StereoOut32 *sndStretchBuffer; // output of timeStretchWrite, SndOutWriteBatch packets
     static StereoOut16 *sndTempBuffer16;
 
     static int sndTempProgress;
@@ -581,8 +601,13 @@ private:
     static StereoOut32 *m_buffer;
     static s32 m_size;
 
-    static __aligned(4) volatile s32 m_rpos;
-    static __aligned(4) volatile s32 m_wpos;
+    static std::atomic<s32> m_rpos;
+    static std::atomic<s32> m_wpos;
+
+    // GetCPUTicks() of the last write to each packet of m_buffer, for the latency stats.
+    static u64 *m_stamps;
+    static SndBufferStats m_stats;
+    static std::atomic<u32> m_overruns;
 
     static float lastEmergencyAdj;
     static float cTempo;
@@ -595,7 +620,7 @@ private:
     static void soundtouchInit();
     static void soundtouchClearContents();
     static void soundtouchCleanup();
-    static void timeStretchWrite();
+    static void timeStretchWrite(StereoOut32 *packet);
     static void timeStretchUnderrun();
     static s32 timeStretchOverrun();
 
@@ -604,14 +629,12 @@ private:
     static void UpdateTempoChangeSoundTouch();
     static void UpdateTempoChangeSoundTouch2();
 
+    // Writes a batch of samples, which the reader sees all at once.
     static void _WriteSamples(StereoOut32 *bData, int nSamples);
-
     static void _WriteSamples_Safe(StereoOut32 *bData, int nSamples);
-    static void _ReadSamples_Safe(StereoOut32 *bData, int nSamples);
-
-    static void _WriteSamples_Internal(StereoOut32 *bData, int nSamples);
+    static void _WritePackets(StereoOut32 *bData, int nPackets);
     static void _DropSamples_Internal(int nSamples);
-    static void _ReadSamples_Internal(StereoOut32 *bData, int nSamples);
+    static void _UpdateLatencyStats(s32 rpos, int nSamples);
 
     static int _GetApproximateDataInBuffer();
 
@@ -620,6 +643,7 @@ public:
     static void Init();
     static void Cleanup();
     static void Write(const StereoOut32 &Sample);
+    static void Flush();
     static s32 Test();
     static void ClearContents();
 
@@ -687,7 +711,7 @@ extern SndOutModule *mods[];
 
 extern bool WavRecordEnabled;
 
-extern void RecordStart();
+extern void RecordStart(const char *filename = "recording.wav");
 extern void RecordStop();
 extern void RecordWrite(const StereoOut16 &sample);
 
@@ -113,6 +113,149 @@ double HighResScale;
 
 bool Running = false;
 
+MixerProfile g_MixerProfile;
+
+void dummy1()
+{
+}
+
+void dummy4()
+{
+    SPU2interruptDMA4();
+}
+
+void dummy7()
+{
+    SPU2interruptDMA7();
+}
+
+// Replays a log as fast as possible, without an audio backend, and reports the time spent
+// in the mixer.  The mixed output goes to wavfile (unless NULL), so that two builds can be
+// compared sample for sample.
+EXPORT_C_(void)
+s2r_benchmark(char *filename, char *wavfile)
+{
+    FILE *file = fopen(filename, "rb");
+    u32 ticks = 0;
+
+    if (!file || fread(&ticks, 4, 1, file) < 1) {
+        fprintf(stderr, "Could not open the replay file %s.\n", filename);
+        if (file)
+            fclose(file);
+        return;
+    }
+
+    replay_mode = true;
+
+    SPU2init();
+    SPU2irqCallback(dummy1, dummy4, dummy7);
+    SPU2setClockPtr(&CurrentIOPCycle);
+
+    // The null output neither buffers nor waits for a sound card.
+    OutputModule = FindOutputModuleById(L"nullout");
+    CurrentIOPCycle = 0;
+    SPU2open(NULL);
+
+    if (wavfile)
+        RecordStart(wavfile);
+
+    memset(&g_MixerProfile, 0, sizeof(g_MixerProfile));
+    g_MixerProfile.enabled = true;
+
+    const u64 start = GetCPUTicks();
+    int events = 0;
+
+    while (true) {
+        u32 ccycle = 0;
+        u32 sval = 0;
+        u32 tval = 0;
+
+        if (fread(&ccycle, 4, 1, file) < 1 || fread(&sval, 4, 1, file) < 1)
+            break;
+
+        const u32 evid = sval >> 29;
+        sval &= 0x1FFFFFFF;
+
+        // Catch up one packet at a time, the same way whatever the gap between events
+        // (a single big step would hit the sanity check of TimeUpdate).
+        const u32 TargetCycle = ccycle * 768;
+        while (TargetCycle > CurrentIOPCycle) {
+            CurrentIOPCycle += std::min<u32>(TargetCycle - CurrentIOPCycle, 768 * SndOutPacketSize);
+            SPU2async(0);
+        }
+
+        bool ok = true;
+        switch (evid) {
+            case 0:
+                SPU2read(sval);
+                break;
+            case 1:
+                ok = fread(&tval, 2, 1, file) == 1;
+                if (ok)
+                    SPU2write(sval, tval);
+                break;
+            case 2:
+                ok = sval <= ArraySize(dmabuffer) && fread(dmabuffer, 2, sval, file) == sval;
+                if (ok)
+                    SPU2writeDMA4Mem(dmabuffer, sval);
+                break;
+            case 3:
+                ok = sval <= ArraySize(dmabuffer) && fread(dmabuffer, 2, sval, file) == sval;
+                if (ok)
+                    SPU2writeDMA7Mem(dmabuffer, sval);
+                break;
+            default:
+                ok = false;
+                break;
+        }
+
+        if (!ok) {
+            fprintf(stderr, "Bad or truncated event %d (type %u), stopping there.\n", events, evid);
+            break;
+        }
+        events++;
+    }
+
+    const u64 elapsed = GetCPUTicks() - start;
+    const MixerProfile profile = g_MixerProfile;
+    g_MixerProfile.enabled = false;
+
+    RecordStop();
+    SPU2close();
+    SPU2shutdown();
+    fclose(file);
+
+    replay_mode = false;
+
+    const double seconds = (double)elapsed / GetTickFrequency();
+    const double samples = std::max<double>(profile.samples, 1);
+    printf("Replayed %s: %d events, %llu samples (%.2f s of audio) in %.2f s, %.1fx real time\n",
+           filename, events, (unsigned long long)profile.samples, profile.samples / 48000.0,
+           seconds, seconds > 0 ? profile.samples / 48000.0 / seconds : 0.0);
+    printf("Cycles per sample: %.0f mix, %.0f voices, %.0f reverb\n",
+           profile.mix / samples, profile.voices / samples, profile.reverb / samples);
+    if (wavfile)
+        printf("Output written to %s\n", wavfile);
+}
+
+// Checks the SIMD paths of the mixer against the scalar ones, and returns the number of
+// mismatches.
+EXPORT_C_(int)
+s2r_selftest()
+{
+    if (SPU2init() != 0) {
+        fprintf(stderr, "Could not initialize SPU2-X.\n");
+        return 1;
+    }
+
+    const int failed = MixerSelfTest() + ReverbSelfTest();
+
+    SPU2shutdown();
+
+    printf("SPU2-X self-test %s (%d mismatches)\n", failed ? "FAILED" : "passed", failed);
+    return failed;
+}
+
 #ifdef _MSC_VER
 
 int conprintf(const char *fmt, ...)
@@ -143,20 +286,6 @@ int conprintf(const char *fmt, ...)
 #endif
 }
 
-void dummy1()
-{
-}
-
-void dummy4()
-{
-    SPU2interruptDMA4();
-}
-
-void dummy7()
-{
-    SPU2interruptDMA7();
-}
-
 u64 HighResFrequency()
 {
     u64 freq;
@@ -215,6 +344,36 @@ BOOL WINAPI HandlerRoutine(DWORD dwCtrlType)
 }
 #endif
 
+// rundll32 entry point of s2r_benchmark, which writes the output next to the log.
+EXPORT_C_(void)
+s2r_benchmark_cmd(HWND hwnd, HINSTANCE hinst, LPSTR filename, int nCmdShow)
+{
+    AllocConsole();
+    freopen("CONOUT$", "w", stdout);
+    freopen("CONOUT$", "w", stderr);
+
+    std::string wavfile(filename);
+    wavfile += ".wav";
+    s2r_benchmark(filename, &wavfile[0]);
+
+    system("pause");
+    FreeConsole();
+}
+
+// rundll32 entry point of s2r_selftest.
+EXPORT_C_(void)
+s2r_selftest_cmd(HWND hwnd, HINSTANCE hinst, LPSTR filename, int nCmdShow)
+{
+    AllocConsole();
+    freopen("CONOUT$", "w", stdout);
+    freopen("CONOUT$", "w", stderr);
+
+    s2r_selftest();
+
+    system("pause");
+    FreeConsole();
+}
+
 #include "Windows/Dialogs.h"
 EXPORT_C_(void)
 s2r_replay(HWND hwnd, HINSTANCE hinst, LPSTR filename, int nCmdShow)
@@ -29,3 +29,15 @@ void s2r_writedma7(u32 ticks, u16 *data, u32 len);
 void s2r_close();
 
 extern bool replay_mode;
+
+// Time spent in Mix(), in rdtsc cycles.  Only counted while s2r_benchmark runs.
+struct MixerProfile
+{
+    bool enabled;
+    u64 samples;
+    u64 mix;    // all of Mix(), but the output buffering
+    u64 voices; // MixCoreVoices of both cores
+    u64 reverb; // DoReverb of both cores
+};
+
+extern MixerProfile g_MixerProfile;
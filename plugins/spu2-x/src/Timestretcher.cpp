@@ -464,7 +464,7 @@ static void CvtPacketToInt(StereoOut32 *srcdest, uint size)
         *dest = (StereoOut32)*src;
 }
 
-void SndBuffer::timeStretchWrite()
+void SndBuffer::timeStretchWrite(StereoOut32 *packet)
 {
     // data prediction helps keep the tempo adjustments more accurate.
     // The timestretcher returns packets in belated "clump" form.
@@ -473,20 +473,30 @@ void SndBuffer::timeStretchWrite()
     // data prediction to make the timestretcher more responsive.
 
     PredictDataWrite((int)(SndOutPacketSize / eTempo));
-    CvtPacketToFloat(sndTempBuffer);
+    CvtPacketToFloat(packet);
 
-    pSoundTouch->putSamples((float *)sndTempBuffer, SndOutPacketSize);
+    pSoundTouch->putSamples((float *)packet, SndOutPacketSize);
 
+    // A clump is written at once (up to a batch of packets).
+    int progress = 0;
     int tempProgress;
-    while (tempProgress = pSoundTouch->receiveSamples((float *)sndTempBuffer, SndOutPacketSize),
+    while (tempProgress = pSoundTouch->receiveSamples((float *)&sndStretchBuffer[progress], SndOutPacketSize),
            tempProgress != 0) {
         // Hint: It's assumed that pSoundTouch will return chunks of 128 bytes (it always does as
         // long as the SSE optimizations are enabled), which means we can do our own SSE opts here.
 
-        CvtPacketToInt(sndTempBuffer, tempProgress);
-        _WriteSamples(sndTempBuffer, tempProgress);
+        CvtPacketToInt(&sndStretchBuffer[progress], tempProgress);
+        progress += tempProgress;
+
+        if (progress > SndOutPacketSize * (SndOutWriteBatch - 1)) {
+            _WriteSamples(sndStretchBuffer, progress);
+            progress = 0;
+        }
     }
 
+    if (progress > 0)
+        _WriteSamples(sndStretchBuffer, progress);
+
 #ifdef SPU2X_USE_OLD_STRETCHER
     UpdateTempoChangeSoundTouch();
 #else
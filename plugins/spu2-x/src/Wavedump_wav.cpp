@@ -104,18 +104,18 @@ bool WavRecordEnabled = false;
 static WavOutFile *m_wavrecord = NULL;
 static Mutex WavRecordMutex;
 
-void RecordStart()
+void RecordStart(const char *filename)
 {
     WavRecordEnabled = false;
 
     try {
         ScopedLock lock(WavRecordMutex);
         safe_delete(m_wavrecord);
-        m_wavrecord = new WavOutFile("recording.wav", 48000, 16, 2);
+        m_wavrecord = new WavOutFile(filename, 48000, 16, 2);
         WavRecordEnabled = true;
     } catch (std::runtime_error &) {
         m_wavrecord = NULL; // not needed, but what the heck. :)
-        SysMessage("SPU2-X couldn't open file for recording: %s.\nRecording to wavfile disabled.", "recording.wav");
+        SysMessage("SPU2-X couldn't open file for recording: %s.\nRecording to wavfile disabled.", filename);
     }
 }
 
@@ -183,8 +183,9 @@ struct V_Voice
     s32 OutX;
     s32 NextCrest; // temp value for Crest calculation
 
-    // SBuffer now points directly to an ADPCM cache entry.
-    s16 *SBuffer;
+    // The decoded ADPCM block being played (a copy of its cache entry, which may be
+    // replaced by another voice in the meantime).
+    s16 SBuffer[28];
 
     // sample position within the current decoded packet.
     s32 SCurrent;
@@ -302,6 +303,11 @@ struct V_ReverbBuffers
     s32 APF2_L_SRC;
     s32 APF2_R_SRC;
 
+    // The same buffer pointers per channel ([0] left, [1] right), in the order of
+    // RevbTap, so that DoReverb can wrap all of them at once.  The padding repeats the
+    // first tap.
+    s32 Taps[2][16];
+
     bool NeedsUpdated;
 };
 
@@ -482,6 +488,7 @@ struct V_Core
     void Reverb_AdvanceBuffer();
     StereoOut32 DoReverb(const StereoOut32 &Input);
     s32 RevbGetIndexer(s32 offset);
+    void Reverb_UpdateTaps();
 
     StereoOut32 ReadInput();
     StereoOut32 ReadInput_HiFi();
@@ -547,6 +554,7 @@ extern s16 *_spu2mem;
 extern int PlayMode;
 
 extern void SetIrqCall(int core);
+extern bool has_to_call_irq;
 extern void StartVoices(int core, u32 value);
 extern void StopVoices(int core, u32 value);
 extern void InitADSR();
@@ -574,16 +582,45 @@ static const s32 SPU2_DYN_MEMLINE = 0x2800;
 // 8 short words per encoded PCM block. (as stored in SPU2 ram)
 static const int pcm_WordsPerBlock = 8;
 
-// number of cachable ADPCM blocks (any blocks above the SPU2_DYN_MEMLINE)
-static const int pcm_BlockCount = 0x100000 / pcm_WordsPerBlock;
-
 // 28 samples per decoded PCM block (as stored in our cache)
 static const int pcm_DecodedSamplesPerBlock = 28;
 
+// The cache only holds the blocks which are actually played, 4-way set associative: 8192
+// blocks (512KB) instead of one entry for each of the 2MB / 16 blocks of SPU2 ram (7MB).
+static const int pcm_CacheWays = 4;
+static const int pcm_CacheSets = 2048;
+
+// Writes invalidate the cache by pages of SPU2 ram (512 bytes), see pcm_InvalidateRange.
+static const int pcm_WordsPerPage = 0x100;
+static const int pcm_PageCount = 0x100000 / pcm_WordsPerPage;
+
 struct PcmCacheEntry
 {
-    bool Validated;
+    u32 Block;   // NextA / pcm_WordsPerBlock (0 is never cached, so it marks free entries)
+    u32 PageGen; // pcm_PageGen of the block's page when it was decoded
     s16 Sampledata[pcm_DecodedSamplesPerBlock];
 };
 
-extern PcmCacheEntry *pcm_cache_data;
+struct PcmCacheStats
+{
+    u32 hits;
+    u32 misses;
+    u32 ignores;   // blocks in the dynamic memory range, which are never cached
+    u32 evictions; // misses which replaced a block still valid
+};
+
+extern PcmCacheEntry *pcm_cache_data; // [pcm_CacheSets][pcm_CacheWays]
+extern u32 pcm_PageGen[pcm_PageCount];
+extern PcmCacheStats pcm_CacheStats;
+
+// Invalidates the decoded blocks of SPU2 ram words [start, end) (at least the one at start).
+static __forceinline void pcm_InvalidateRange(u32 start, u32 end)
+{
+    if (end <= start)
+        end = start + 1;
+
+    for (u32 page = start / pcm_WordsPerPage; page <= (end - 1) / pcm_WordsPerPage; ++page)
+        pcm_PageGen[page]++;
+}
+
+extern void pcm_WipeCache();
@@ -25,11 +25,11 @@ static const u32 SAVE_ID = 0x1227521;
 
 // versioning for saves.
 // Increment this when changes to the savestate system are made.
-static const u32 SAVE_VERSION = 0x000e;
+static const u32 SAVE_VERSION = 0x0010;
 
 static void wipe_the_cache()
 {
-    memset(pcm_cache_data, 0, pcm_BlockCount * sizeof(PcmCacheEntry));
+    pcm_WipeCache();
 }
 }
 
@@ -121,16 +121,6 @@ s32 __fastcall Savestate::ThawIt(DataBlock &spud)
 
         wipe_the_cache();
 
-        // Go through the V_Voice structs and recalculate SBuffer pointer from
-        // the NextA setting.
-
-        for (int c = 0; c < 2; c++) {
-            for (int v = 0; v < 24; v++) {
-                const int cacheIdx = Cores[c].Voices[v].NextA / pcm_WordsPerBlock;
-                Cores[c].Voices[v].SBuffer = pcm_cache_data[cacheIdx].Sampledata;
-            }
-        }
-
         // HACKFIX!! DMAPtr can be invalid after a savestate load, so force it to NULL and
         // ignore it on any pending ADMA writes.  (the DMAPtr concept used to work in old VM
         // editions of PCSX2 with fixed addressing, but new PCSX2s have dynamic memory
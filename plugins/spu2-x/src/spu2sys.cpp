@@ -78,11 +78,10 @@ __forceinline void spu2M_Write(u32 addr, s16 value)
 
     addr &= 0xfffff;
     if (addr >= SPU2_DYN_MEMLINE) {
-        const int cacheIdx = addr / pcm_WordsPerBlock;
-        pcm_cache_data[cacheIdx].Validated = false;
+        pcm_PageGen[addr / pcm_WordsPerPage]++;
 
         if (MsgToConsole() && MsgCache())
-            ConLog("* SPU2-X: PcmCache Block Clear at 0x%x (cacheIdx=0x%x)\n", addr, cacheIdx);
+            ConLog("* SPU2-X: PcmCache Page Clear at 0x%x (page=0x%x)\n", addr, addr / pcm_WordsPerPage);
     }
     *GetMemPtr(addr) = value;
 }
@@ -322,6 +321,8 @@ void V_Core::UpdateEffectsBufferSize()
     RevBuffers.APF1_R_SRC = EffectsBufferIndexer(Revb.APF1_R_DST - Revb.APF1_SIZE);
     RevBuffers.APF2_L_SRC = EffectsBufferIndexer(Revb.APF2_L_DST - Revb.APF2_SIZE);
     RevBuffers.APF2_R_SRC = EffectsBufferIndexer(Revb.APF2_R_DST - Revb.APF2_SIZE);
+
+    Reverb_UpdateTaps();
 }
 
 void V_Voice::QueueStart()
@@ -455,6 +456,9 @@ __forceinline void TimeUpdate(u32 cClocks)
         Mix();
         //RestoreMMXRegs();
     }
+
+    // Pass on everything mixed above at once.
+    SndBuffer::Flush();
 }
 
 __forceinline void UpdateSpdifMode()
@@ -0,0 +1,434 @@
+/*  PCSX2 - PS2 Emulator for PCs
+*  Copyright (C) 2002-2014  PCSX2 Dev Team
+*
+*  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+*  of the GNU Lesser General Public License as published by the Free Software Found-
+*  ation, either version 3 of the License, or (at your option) any later version.
+*
+*  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+*  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+*  PURPOSE.  See the GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License along with PCSX2.
+*  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// isozstd - converts ISOs to the zstd seekable format read by ZstdFileReader, and
+// measures the sector read throughput of the compressed formats PCSX2 supports.
+//
+//   isozstd [-l level] [-f frame KB] [-t threads] image.iso image.zst
+//   isozstd -b [-n random reads] image.zst image.cso image.gz ...
+//
+// The benchmark decompresses the same way the PCSX2 readers do (whole frame for zst
+// and cso, zlib_indexed.h for gz), but without their caches, so the numbers are the
+// raw cost of a sequential pass and of random sector accesses.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+#include <zstd.h>
+
+// Defines __POSIX__, which zlib_indexed.h needs to pick the system zlib
+#include "Pcsx2Defs.h"
+
+#include "zlib_indexed.h"
+#include "zstd_seekable.h"
+
+static const int SECTOR = 2048;
+
+// ------------------------------------------------------------------------------------
+//  Converter
+// ------------------------------------------------------------------------------------
+
+static int Convert(const char* inName, const char* outName, int level, u32 frameSize, int threads)
+{
+	FILE* in = fopen(inName, "rb");
+	if (!in) {
+		fprintf(stderr, "Can't open %s\n", inName);
+		return 1;
+	}
+	FILE* out = fopen(outName, "wb");
+	if (!out) {
+		fprintf(stderr, "Can't create %s\n", outName);
+		fclose(in);
+		return 1;
+	}
+
+	// Each thread compresses one frame of the batch, the batch is then written in order.
+	struct Frame
+	{
+		std::vector<u8> src;
+		std::vector<u8> dst;
+		size_t rawSize;
+		size_t size;
+	};
+	std::vector<Frame> batch(threads);
+	for (Frame& f : batch) {
+		f.src.resize(frameSize);
+		f.dst.resize(ZSTD_compressBound(frameSize));
+	}
+
+	ZstdSeekTable table;
+	auto start = std::chrono::steady_clock::now();
+	bool ok = true;
+	bool eof = false;
+	while (ok && !eof) {
+		int count = 0;
+		while (count < threads && !eof) {
+			Frame& f = batch[count];
+			f.rawSize = fread(f.src.data(), 1, frameSize, in);
+			eof = f.rawSize < frameSize; // the last frame may be partial
+			if (f.rawSize)
+				count++;
+		}
+
+		std::vector<std::thread> workers;
+		for (int i = 0; i < count; i++) {
+			workers.emplace_back([&batch, i, level]() {
+				Frame& f = batch[i];
+				f.size = ZSTD_compress(f.dst.data(), f.dst.size(), f.src.data(), f.rawSize, level);
+			});
+		}
+		for (std::thread& w : workers)
+			w.join();
+
+		for (int i = 0; i < count && ok; i++) {
+			Frame& f = batch[i];
+			if (ZSTD_isError(f.size)) {
+				fprintf(stderr, "zstd: %s\n", ZSTD_getErrorName(f.size));
+				ok = false;
+			} else {
+				ok = fwrite(f.dst.data(), 1, f.size, out) == f.size;
+				table.Add((u32)f.size, (u32)f.rawSize);
+			}
+		}
+
+		if (table.Frames() % 256 < count)
+			fprintf(stderr, "\r%d MB", (int)(table.UncompressedSize() >> 20));
+	}
+
+	ok = ok && !ferror(in) && table.Frames() > 0 && ZstdSeekableWriteTable(out, table);
+	const PX_off_t compressed = PX_ftello(out);
+	fclose(in);
+	ok = fclose(out) == 0 && ok;
+
+	if (!ok) {
+		fprintf(stderr, "\nConversion failed.\n");
+		remove(outName);
+		return 1;
+	}
+
+	double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	fprintf(stderr, "\r%s: %d frames, %.1f MB -> %.1f MB (%.1f%%) in %.1f s\n", outName, table.Frames(),
+		table.UncompressedSize() / 1048576.0, compressed / 1048576.0,
+		100.0 * compressed / std::max<PX_off_t>(1, table.UncompressedSize()), s);
+	return 0;
+}
+
+// ------------------------------------------------------------------------------------
+//  Benchmark readers
+// ------------------------------------------------------------------------------------
+
+class Image
+{
+public:
+	virtual ~Image() {}
+	virtual PX_off_t Size() const = 0;
+	// Reads one sector, returns false on error.
+	virtual bool Read(u8* dest, PX_off_t pos) = 0;
+};
+
+// Only the most recently decompressed frame is kept, like CsoFileReader.
+class ZstdImage : public Image
+{
+	FILE* m_in;
+	ZstdSeekTable m_table;
+	ZSTD_DCtx* m_dctx;
+	std::vector<u8> m_src, m_frame;
+	int m_current;
+
+public:
+	ZstdImage(FILE* in) : m_in(in), m_dctx(ZSTD_createDCtx()), m_current(-1) {}
+	~ZstdImage() { ZSTD_freeDCtx(m_dctx); fclose(m_in); }
+
+	bool Open()
+	{
+		if (!ZstdSeekableReadTable(m_in, m_table))
+			return false;
+		m_src.resize(m_table.maxCompressedSize);
+		m_frame.resize(m_table.maxFrameSize);
+		return true;
+	}
+
+	PX_off_t Size() const { return m_table.UncompressedSize(); }
+
+	bool Read(u8* dest, PX_off_t pos)
+	{
+		const int frame = m_table.FindFrame(pos);
+		if (frame != m_current) {
+			const u32 size = (u32)(m_table.in[frame + 1] - m_table.in[frame]);
+			PX_fseeko(m_in, m_table.in[frame], SEEK_SET);
+			if (fread(m_src.data(), 1, size, m_in) != size)
+				return false;
+			size_t res = ZSTD_decompressDCtx(m_dctx, m_frame.data(), m_frame.size(), m_src.data(), size);
+			if (ZSTD_isError(res))
+				return false;
+			m_current = frame;
+		}
+		const PX_off_t offset = pos - m_table.out[frame];
+		const PX_off_t bytes = std::min<PX_off_t>(SECTOR, m_table.out[frame + 1] - pos);
+		memcpy(dest, &m_frame[offset], bytes);
+		if (bytes < SECTOR && pos + bytes < Size())
+			return Read(dest + bytes, pos + bytes);
+		return true;
+	}
+};
+
+class CsoImage : public Image
+{
+	FILE* m_in;
+	z_stream m_z;
+	std::vector<u32> m_index;
+	std::vector<u8> m_src, m_frame;
+	u64 m_size;
+	u32 m_frameSize;
+	int m_align;
+	s64 m_current;
+
+public:
+	CsoImage(FILE* in) : m_in(in), m_size(0), m_frameSize(0), m_align(0), m_current(-1)
+	{
+		memset(&m_z, 0, sizeof(m_z));
+		inflateInit2(&m_z, -15);
+	}
+	~CsoImage() { inflateEnd(&m_z); fclose(m_in); }
+
+	bool Open()
+	{
+		u8 h[24];
+		if (fread(h, 1, 24, m_in) != 24 || memcmp(h, "CISO", 4) != 0)
+			return false;
+		memcpy(&m_size, h + 8, 8);
+		memcpy(&m_frameSize, h + 16, 4);
+		m_align = h[21];
+		if (m_frameSize < SECTOR || (m_frameSize & (m_frameSize - 1)))
+			return false;
+		m_index.resize((m_size + m_frameSize - 1) / m_frameSize + 1);
+		if (fread(m_index.data(), 4, m_index.size(), m_in) != m_index.size())
+			return false;
+		m_src.resize(m_frameSize + (1 << m_align) + 1024);
+		m_frame.resize(m_frameSize);
+		return true;
+	}
+
+	PX_off_t Size() const { return m_size; }
+
+	bool Read(u8* dest, PX_off_t pos)
+	{
+		const s64 frame = pos / m_frameSize;
+		if (frame != m_current) {
+			const u32 i0 = m_index[frame] & 0x7FFFFFFF, i1 = m_index[frame + 1] & 0x7FFFFFFF;
+			const size_t size = std::min<size_t>((size_t)(i1 - i0) << m_align, m_src.size());
+			PX_fseeko(m_in, (PX_off_t)i0 << m_align, SEEK_SET);
+			size_t got = fread(m_src.data(), 1, size, m_in);
+			if (m_index[frame] & 0x80000000) {
+				memcpy(m_frame.data(), m_src.data(), std::min<size_t>(got, m_frameSize));
+			} else {
+				m_z.next_in = m_src.data();
+				m_z.avail_in = got;
+				m_z.next_out = m_frame.data();
+				m_z.avail_out = m_frameSize;
+				int ret = inflate(&m_z, Z_FINISH);
+				inflateReset(&m_z);
+				if (ret != Z_STREAM_END)
+					return false;
+			}
+			m_current = frame;
+		}
+		memcpy(dest, &m_frame[pos % m_frameSize], SECTOR);
+		return true;
+	}
+};
+
+// Like GzippedFileReader, sequential reads resume from the previous state, random ones
+// start from the closest access point.
+class GzImage : public Image
+{
+	FILE* m_in;
+	Access* m_index;
+	Zstate m_state;
+
+public:
+	GzImage(FILE* in) : m_in(in), m_index(NULL) { m_state.isValid = 0; }
+	~GzImage()
+	{
+		if (m_state.isValid)
+			inflateEnd(&m_state.strm);
+		free_index(m_index);
+		fclose(m_in);
+	}
+
+	bool Open()
+	{
+		fprintf(stderr, "building gzip index... ");
+		bool ok = build_index(m_in, 1048576L * 4, &m_index) > 0;
+		fprintf(stderr, "\n");
+		return ok;
+	}
+
+	PX_off_t Size() const { return m_index->uncompressed_size; }
+
+	bool Read(u8* dest, PX_off_t pos)
+	{
+		return extract(m_in, m_index, pos, dest, SECTOR, &m_state) == SECTOR;
+	}
+};
+
+class FlatImage : public Image
+{
+	FILE* m_in;
+	PX_off_t m_size;
+
+public:
+	FlatImage(FILE* in) : m_in(in)
+	{
+		PX_fseeko(m_in, 0, SEEK_END);
+		m_size = PX_ftello(m_in);
+	}
+	~FlatImage() { fclose(m_in); }
+
+	PX_off_t Size() const { return m_size; }
+
+	bool Read(u8* dest, PX_off_t pos)
+	{
+		PX_fseeko(m_in, pos, SEEK_SET);
+		return fread(dest, 1, SECTOR, m_in) == SECTOR;
+	}
+};
+
+static std::unique_ptr<Image> OpenImage(const std::string& name)
+{
+	FILE* in = fopen(name.c_str(), "rb");
+	if (!in)
+		return nullptr;
+
+	u8 magic[4] = {};
+	size_t got = fread(magic, 1, 4, in);
+	rewind(in);
+
+	if (got == 4 && !memcmp(magic, "CISO", 4)) {
+		CsoImage* cso = new CsoImage(in);
+		if (cso->Open())
+			return std::unique_ptr<Image>(cso);
+		delete cso;
+	} else if (got == 4 && magic[0] == 0x1f && magic[1] == 0x8b) {
+		GzImage* gz = new GzImage(in);
+		if (gz->Open())
+			return std::unique_ptr<Image>(gz);
+		delete gz;
+	} else if (got == 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) {
+		ZstdImage* zst = new ZstdImage(in);
+		if (zst->Open())
+			return std::unique_ptr<Image>(zst);
+		delete zst;
+	} else {
+		return std::unique_ptr<Image>(new FlatImage(in));
+	}
+	return nullptr;
+}
+
+static int Benchmark(const std::vector<std::string>& names, int randomReads)
+{
+	u8 sector[SECTOR];
+
+	printf("%-40s %12s %12s %14s\n", "image", "size (MB)", "seq (MB/s)", "random (IOPS)");
+	for (const std::string& name : names) {
+		std::unique_ptr<Image> image = OpenImage(name);
+		if (!image) {
+			fprintf(stderr, "%s: unsupported or invalid image\n", name.c_str());
+			return 1;
+		}
+
+		const PX_off_t sectors = image->Size() / SECTOR;
+		auto start = std::chrono::steady_clock::now();
+		for (PX_off_t i = 0; i < sectors; i++) {
+			if (!image->Read(sector, i * SECTOR)) {
+				fprintf(stderr, "%s: read error at sector %lld\n", name.c_str(), (long long)i);
+				return 1;
+			}
+		}
+		double seq = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		// Same sequence of sectors for every image.
+		srand(1);
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < randomReads && sectors; i++) {
+			PX_off_t s = ((PX_off_t)rand() * RAND_MAX + rand()) % sectors;
+			if (!image->Read(sector, s * SECTOR)) {
+				fprintf(stderr, "%s: read error at sector %lld\n", name.c_str(), (long long)s);
+				return 1;
+			}
+		}
+		double rnd = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		printf("%-40s %12.1f %12.1f %14.0f\n", name.c_str(), image->Size() / 1048576.0,
+			image->Size() / 1048576.0 / std::max(seq, 1e-9), randomReads / std::max(rnd, 1e-9));
+	}
+	return 0;
+}
+
+static void Usage()
+{
+	fprintf(stderr,
+		"Usage:\n"
+		"  isozstd [-l level] [-f frame KB] [-t threads] image.iso image.zst\n"
+		"      Converts an ISO to the seekable zstd format (default: level 19,\n"
+		"      256 KB frames, one thread per core).\n"
+		"  isozstd -b [-n count] image...\n"
+		"      Measures sequential and random (count sectors, default 2000) read\n"
+		"      throughput of iso, zst, cso and gz images.\n");
+}
+
+int main(int argc, char* argv[])
+{
+	int level = 19;
+	int frameKB = 256;
+	int threads = std::max(1u, std::thread::hardware_concurrency());
+	int randomReads = 2000;
+	bool bench = false;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "l:f:t:bn:h")) != -1) {
+		switch (opt) {
+			case 'l': level = atoi(optarg); break;
+			case 'f': frameKB = atoi(optarg); break;
+			case 't': threads = std::max(1, atoi(optarg)); break;
+			case 'b': bench = true; break;
+			case 'n': randomReads = atoi(optarg); break;
+			default: Usage(); return 1;
+		}
+	}
+
+	if (bench) {
+		if (optind >= argc) {
+			Usage();
+			return 1;
+		}
+		return Benchmark(std::vector<std::string>(argv + optind, argv + argc), randomReads);
+	}
+
+	// Frames must hold whole sectors, so that a sector is never split between two frames.
+	if (argc - optind != 2 || frameKB <= 0 || (frameKB * 1024) % SECTOR) {
+		Usage();
+		return 1;
+	}
+	return Convert(argv[optind], argv[optind + 1], level, frameKB * 1024, threads);
+}